@@ -0,0 +1,67 @@
+#ifndef BENCH_DATA
+#define BENCH_DATA
+
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace bench {
+  /** \brief Seed of the random datasets, fixed so that runs are comparable */
+  constexpr uint64_t kSeed = 1;
+  /** \brief Vectors - N points of dimension D, stored sequentially */
+  struct Vectors {
+    std::vector<int> points;
+    std::vector<int> ids;
+  };
+  /** \brief Curves - N curves stored sequentially as in the drivers */
+  struct Curves {
+    std::vector<std::pair<double,double>> points;
+    std::vector<int> ids;
+    std::vector<int> lengths;
+    std::vector<int> offsets;
+  };
+  /** \brief N points of dimension D, uniform in [0, 256) like the
+    vectors datasets
+  */
+  inline Vectors RandomVectors(const uint32_t N, const uint16_t D,
+    const uint64_t seed = kSeed) {
+
+    std::mt19937_64 generator(seed);
+    std::uniform_int_distribution<int> coordinate(0, 255);
+    Vectors vectors;
+    vectors.points.resize((size_t) N * D);
+    for (auto& x: vectors.points) {
+      x = coordinate(generator);
+    }
+    for (size_t i = 0; i < N; ++i) {
+      vectors.ids.push_back(i + 1);
+    }
+    return vectors;
+  }
+  /** \brief N random walks with length points each, starting in the
+    unit square like the trajectories datasets
+  */
+  inline Curves RandomCurves(const uint32_t N, const uint32_t length,
+    const uint64_t seed = kSeed) {
+
+    std::mt19937_64 generator(seed);
+    std::uniform_real_distribution<double> start(0.0, 1.0);
+    std::normal_distribution<double> step(0.0, 0.01);
+    Curves curves;
+    for (size_t i = 0; i < N; ++i) {
+      curves.ids.push_back(i + 1);
+      curves.lengths.push_back(length);
+      curves.offsets.push_back(curves.points.size());
+      std::pair<double,double> point(start(generator), start(generator));
+      for (size_t j = 0; j < length; ++j) {
+        curves.points.push_back(point);
+        point.first += step(generator);
+        point.second += step(generator);
+      }
+    }
+    return curves;
+  }
+}
+
+#endif
@@ -0,0 +1,147 @@
+#ifndef BENCH_HARNESS
+#define BENCH_HARNESS
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace bench {
+  /** \brief Parameters of a benchmark, e.g N, D or K, as name value pairs */
+  typedef std::vector<std::pair<std::string,double>> Parameters;
+  /** \brief Result - seconds taken by every measured run of a benchmark
+    @par name - name of the benchmark, e.g kernel/dtw or lsh/query
+    @par parameters - parameters the benchmark was run with
+    @par samples - seconds of every measured run, per operation
+  */
+  struct Result {
+    std::string name;
+    Parameters parameters;
+    std::vector<double> samples;
+  };
+  /** \brief Statistics of the samples of a result */
+  struct Summary {
+    double min;
+    double mean;
+    double median;
+    double p99;
+    double max;
+  };
+  /** \brief Harness - runs benchmarks with warm-up runs and repetitions,
+    and collects their results
+  */
+  class Harness {
+    private:
+      const uint32_t warmup;
+      const uint32_t repetitions;
+      const std::string filter;
+      std::vector<Result> results;
+    public:
+      /** \brief class Harness constructor
+        @par const uint32_t warmup - unmeasured runs of every benchmark
+        @par const uint32_t repetitions - measured runs of every benchmark
+        @par const std::string& filter - run only benchmarks whose name
+          contains filter
+      */
+      Harness(const uint32_t warmup, const uint32_t repetitions,
+        const std::string& filter) :
+        warmup(warmup), repetitions(repetitions), filter(filter) {};
+      /**
+        \brief class Harness default destructor
+      */
+      ~Harness() = default;
+      /**
+        \brief returns: true if benchmark name is selected by the filter
+      */
+      bool Enabled(const std::string& name) const {
+        return filter.empty() || name.find(filter) != std::string::npos;
+      };
+      /** \brief Run f warmup times, then time repetitions runs of it. A run
+        executes operations operations, so that kernels faster than the
+        clock resolution are timed in batches.
+        @par const uint32_t operations - operations of a run of f
+        @par F f - the benchmark, called with no arguments
+      */
+      template <typename F>
+      void Measure(const std::string& name, const Parameters& parameters,
+        const uint32_t operations, F f) {
+
+        if (!Enabled(name)) {
+          return;
+        }
+        for (size_t i = 0; i < warmup; ++i) {
+          f();
+        }
+        Result result{name, parameters, {}};
+        for (size_t i = 0; i < repetitions; ++i) {
+          auto start = std::chrono::high_resolution_clock::now();
+          f();
+          auto stop = std::chrono::high_resolution_clock::now();
+          std::chrono::duration<double> seconds = stop - start;
+          result.samples.push_back(seconds.count() / operations);
+        }
+        Add(result);
+      };
+      /** \brief As Measure, but time every call f(i) of a run over
+        i = 0...n-1 separately, e.g to get the latency of every query
+        @par const uint32_t n - calls of a run of f
+        @par F f - the benchmark, called with the index of the call
+      */
+      template <typename F>
+      void MeasureEach(const std::string& name, const Parameters& parameters,
+        const uint32_t n, F f) {
+
+        if (!Enabled(name)) {
+          return;
+        }
+        for (size_t i = 0; i < warmup; ++i) {
+          for (size_t j = 0; j < n; ++j) {
+            f(j);
+          }
+        }
+        Result result{name, parameters, {}};
+        for (size_t i = 0; i < repetitions; ++i) {
+          for (size_t j = 0; j < n; ++j) {
+            auto start = std::chrono::high_resolution_clock::now();
+            f(j);
+            auto stop = std::chrono::high_resolution_clock::now();
+            std::chrono::duration<double> seconds = stop - start;
+            result.samples.push_back(seconds.count());
+          }
+        }
+        Add(result);
+      };
+      /** \brief Add a result timed by the benchmark itself
+      */
+      void Add(const Result& result);
+      uint32_t GetWarmup(void) const { return warmup; };
+      uint32_t GetRepetitions(void) const { return repetitions; };
+      const std::vector<Result>& GetResults(void) const { return results; };
+  };
+  /** \brief Summary of samples, percentiles by nearest rank
+  */
+  Summary Summarize(std::vector<double> samples);
+  /** \brief Print a table of the results to stdout
+  */
+  void Print(const Harness& harness);
+  /** \brief Write the results and the machine they were run on as JSON.
+    @par const std::string& file_name - Path to the output file
+    returns: false if the file can not be written
+  */
+  bool WriteJson(const Harness& harness, const std::string& file_name);
+  /** \brief Consume a value, so that the computation of a benchmark is
+    not optimized away
+  */
+  void DoNotOptimize(const double value);
+  /** \brief Benchmarks of the metric kernels, hash functions and
+    vectorizers on random data
+  */
+  void RunMicro(Harness& harness);
+  /** \brief Benchmarks of the build and the queries of every engine on
+    random datasets of several sizes and dimensions
+  */
+  void RunMacro(Harness& harness);
+}
+
+#endif
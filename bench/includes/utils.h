@@ -0,0 +1,34 @@
+#ifndef BENCH_UTILS
+#define BENCH_UTILS
+
+#include <cstdint>
+#include <string>
+
+namespace utils {
+  /* enumerated exit codes */
+  typedef enum ExitCode{
+    SUCCESS,
+    FAIL,
+    INVALID_SUITE,
+    INVALID_REPETITIONS,
+    INVALID_OUTPUT
+  } ExitCode;
+  /**
+    InputInfo - Group all input parameters of bench in a struct
+  */
+  struct InputInfo {
+    std::string json_file;       // machine readable results, empty for none
+    std::string suite = "all";   // micro, macro or all
+    std::string filter;          // run only benchmarks whose name contains it
+    uint32_t warmup = 2;         // unmeasured runs before the repetitions
+    uint32_t repetitions = 10;   // measured runs of every benchmark
+    void Print(void);            // print method of the InputInfo struct
+  };
+  /** \brief ShowUsage - Prints the usage of the program
+    @par const std::string& name - Pass by reference the name of the program
+    @par const struct InputInfo &input_info - Pass by reference the input parameters
+  */
+  void ShowUsage(const std::string& name, const struct InputInfo& input_info);
+}
+
+#endif
@@ -0,0 +1,75 @@
+#include <iostream>
+#include <cstdlib>
+#include <getopt.h>
+#include <unistd.h>
+#include <string>
+#include <string.h>
+
+#include "../includes/utils.h"
+#include "../includes/args_utils.h"
+
+int utils::args::ReadArguments(int argc, char **argv,
+  struct InputInfo &input_info, utils::ExitCode &status) {
+
+  if (argc == 2) {
+    if (!strcmp(argv[1],"--help")) {
+      ShowUsage(argv[0], input_info);
+    }
+  }
+
+  const char * const short_opts = "j:s:f:w:n:";
+  const option long_opts[] = {
+           {"json", required_argument, nullptr, 'j'},
+           {"suite", required_argument, nullptr, 's'},
+           {"filter", required_argument, nullptr, 'f'},
+           {"warmup", required_argument, nullptr, 'w'},
+           {"repetitions", required_argument, nullptr, 'n'},
+           {nullptr, no_argument, nullptr, 0}
+   };
+
+   while (true) {
+
+     const auto opt = getopt_long(argc, argv, short_opts, long_opts, nullptr);
+
+     if (-1 == opt) {
+       break;
+     }
+
+     switch (opt) {
+      case 'j': {
+        input_info.json_file = optarg;
+        break;
+      }
+      case 's': {
+        input_info.suite = optarg;
+        if (input_info.suite != "micro" && input_info.suite != "macro" &&
+            input_info.suite != "all") {
+          status = INVALID_SUITE;
+          return FAIL;
+        }
+        break;
+      }
+      case 'f': {
+        input_info.filter = optarg;
+        break;
+      }
+      case 'w': {
+        input_info.warmup = atoi(optarg);
+        break;
+      }
+      case 'n': {
+        if (atoi(optarg) <= 0) {
+          status = INVALID_REPETITIONS;
+          return FAIL;
+        }
+        input_info.repetitions = atoi(optarg);
+        break;
+      }
+      case '?':
+        break;
+      default:
+        abort();
+    }
+  }
+  return SUCCESS;
+}
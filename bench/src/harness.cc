@@ -0,0 +1,117 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../includes/harness.h"
+
+namespace {
+  volatile double sink;
+
+  /* Quote a string as a JSON string */
+  std::string Quote(const std::string& str) {
+    std::string quoted = "\"";
+    for (const auto& c: str) {
+      if (c == '"' || c == '\\') {
+        quoted += '\\';
+      }
+      quoted += c;
+    }
+    return quoted + "\"";
+  }
+
+  std::string Format(const bench::Parameters& parameters) {
+    std::ostringstream ss;
+    for (size_t i = 0; i < parameters.size(); ++i) {
+      ss << (i ? " " : "") << parameters[i].first << "=" << parameters[i].second;
+    }
+    return ss.str();
+  }
+}
+
+void bench::Harness::Add(const Result& result) {
+  if (Enabled(result.name) && !result.samples.empty()) {
+    results.push_back(result);
+  }
+}
+
+bench::Summary bench::Summarize(std::vector<double> samples) {
+  Summary summary{};
+  if (samples.empty()) {
+    return summary;
+  }
+  std::sort(samples.begin(), samples.end());
+  // nearest rank of percentile p is ceil(p * n)
+  auto percentile = [&](const double p) {
+    const size_t rank = std::ceil(p * samples.size());
+    return samples[std::max<size_t>(rank, 1) - 1];
+  };
+  double sum{};
+  for (const auto& sample: samples) {
+    sum += sample;
+  }
+  summary.min = samples.front();
+  summary.mean = sum / samples.size();
+  summary.median = percentile(0.5);
+  summary.p99 = percentile(0.99);
+  summary.max = samples.back();
+  return summary;
+}
+
+void bench::Print(const Harness& harness) {
+  std::cout << std::endl << std::left << std::setw(28) << "benchmark"
+            << std::setw(30) << "parameters" << std::right
+            << std::setw(14) << "median (s)" << std::setw(14) << "p99 (s)"
+            << std::setw(10) << "samples" << std::endl;
+  for (const auto& result: harness.GetResults()) {
+    const Summary summary = Summarize(result.samples);
+    std::cout << std::left << std::setw(28) << result.name
+              << std::setw(30) << Format(result.parameters) << std::right
+              << std::setw(14) << std::setprecision(4) << summary.median
+              << std::setw(14) << summary.p99
+              << std::setw(10) << result.samples.size() << std::endl;
+  }
+}
+
+bool bench::WriteJson(const Harness& harness, const std::string& file_name) {
+  std::ofstream file(file_name);
+  if (!file) {
+    return false;
+  }
+  file << std::setprecision(9);
+  file << "{\n"
+       << "  \"machine\": {\"threads\": " << std::thread::hardware_concurrency()
+       << ", \"compiler\": " << Quote(__VERSION__) << "},\n"
+       << "  \"timestamp\": " << std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count() << ",\n"
+       << "  \"warmup\": " << harness.GetWarmup() << ",\n"
+       << "  \"repetitions\": " << harness.GetRepetitions() << ",\n"
+       << "  \"unit\": \"seconds\",\n"
+       << "  \"results\": [";
+  const std::vector<Result>& results = harness.GetResults();
+  for (size_t i = 0; i < results.size(); ++i) {
+    const Summary summary = Summarize(results[i].samples);
+    file << (i ? "," : "") << "\n    {\"name\": " << Quote(results[i].name)
+         << ", \"parameters\": {";
+    for (size_t j = 0; j < results[i].parameters.size(); ++j) {
+      file << (j ? ", " : "") << Quote(results[i].parameters[j].first) << ": "
+           << results[i].parameters[j].second;
+    }
+    file << "}, \"samples\": " << results[i].samples.size()
+         << ", \"min\": " << summary.min << ", \"mean\": " << summary.mean
+         << ", \"median\": " << summary.median << ", \"p99\": " << summary.p99
+         << ", \"max\": " << summary.max << "}";
+  }
+  file << "\n  ]\n}\n";
+  return static_cast<bool>(file.flush());
+}
+
+void bench::DoNotOptimize(const double value) {
+  sink = value;
+}
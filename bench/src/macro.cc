@@ -0,0 +1,291 @@
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "../../core/search/hypercube.h"
+#include "../../core/search/lsh.h"
+#include "../../core/utils/estimate.h"
+#include "../../core/utils/utils.h"
+
+#include "../../curves/core/vectorization/vectorization.h"
+#include "../../curves/core/search/grid_search.h"
+#include "../../curves/core/search/projection_search.h"
+
+#include "../includes/data.h"
+#include "../includes/harness.h"
+
+namespace {
+  /* number of queries of every query benchmark */
+  constexpr uint32_t kQueries = 100;
+  /* dataset points sampled to estimate R */
+  constexpr uint32_t kRSamples = 200;
+  /* seed of the queries, so that they differ from the dataset */
+  constexpr uint64_t kQuerySeed = bench::kSeed + 1;
+
+  /* Parameters of the engines, the defaults of their drivers */
+  constexpr uint8_t kK = 4;
+  constexpr uint8_t kL = 5;
+  constexpr uint16_t kk = 3;
+  constexpr uint16_t kM = 10;
+  constexpr uint8_t kProbes = 2;
+  constexpr uint8_t kGrids = 5;
+  constexpr int kProjectionK = 8;
+  constexpr uint32_t kProjectionLengths[] = {4, 6};
+
+  void VectorEngines(bench::Harness& harness) {
+    for (const uint32_t N: {2000, 10000}) {
+      for (const uint16_t D: {32, 128}) {
+        const bench::Parameters parameters{{"N", N}, {"D", D}};
+        const bench::Vectors dataset = bench::RandomVectors(N, D);
+        const bench::Vectors queries = bench::RandomVectors(kQueries, D,
+                                                            kQuerySeed);
+        const double r = utils::EstimateParameterR(
+          utils::RaggedView<int>(dataset.points, D), N, kRSamples).first;
+
+        harness.Measure("lsh/build", parameters, 1, [&]() {
+          search::vectors::LSH<int,int> lsh(kK, kL, D, N, r, dataset.points,
+                                            dataset.ids);
+        });
+        if (harness.Enabled("lsh/query")) {
+          search::vectors::LSH<int,int> lsh(kK, kL, D, N, r, dataset.points,
+                                            dataset.ids);
+          harness.MeasureEach("lsh/query", parameters, kQueries,
+                              [&](const size_t i) {
+            bench::DoNotOptimize(std::get<0>(lsh.NearestNeighbor(queries.points,
+                                                                 i)));
+          });
+        }
+        harness.Measure("hypercube/build", parameters, 1, [&]() {
+          search::vectors::HyperCube<int,int> cube(kk, kM, D, N, kProbes, r,
+                                                   dataset.points, dataset.ids);
+        });
+        if (harness.Enabled("hypercube/query")) {
+          search::vectors::HyperCube<int,int> cube(kk, kM, D, N, kProbes, r,
+                                                   dataset.points, dataset.ids);
+          harness.MeasureEach("hypercube/query", parameters, kQueries,
+                              [&](const size_t i) {
+            bench::DoNotOptimize(std::get<0>(cube.NearestNeighbor(queries.points,
+                                                                  i)));
+          });
+        }
+      }
+    }
+  }
+
+  /* Grids, vectors and one structure per grid, as built by the grid drivers */
+  template <typename Structure>
+  struct GridEngine {
+    std::vector<vectorization::Grid<double>> grids;
+    std::vector<utils::Ragged<double>> vectors;
+    std::vector<Structure> structures;
+  };
+
+  template <typename Structure, typename Make>
+  void BuildGrids(GridEngine<Structure>& engine, bench::Curves& dataset,
+    Make make) {
+
+    const uint32_t N = dataset.lengths.size();
+    const double delta = utils::ComputeDelta(dataset.points, dataset.lengths,
+                                             dataset.offsets);
+    const uint32_t D = 2 * dataset.lengths[0];
+    for (size_t i = 0; i < kGrids; ++i) {
+      engine.grids.push_back(vectorization::Grid<double>(dataset.points,
+                                                         dataset.lengths,
+                                                         dataset.offsets, N, D,
+                                                         10 * delta));
+    }
+    engine.vectors = vectorization::Vectorize(engine.grids, N, dataset.points,
+                                              dataset.lengths, dataset.offsets);
+    for (size_t i = 0; i < kGrids; ++i) {
+      const double r = utils::EstimateParameterR(
+        utils::RaggedView<double>(engine.vectors[i]), N, kRSamples).first;
+      engine.structures.push_back(make(engine.vectors[i], r));
+    }
+  }
+
+  template <typename Structure, typename Make>
+  void GridBenchmarks(bench::Harness& harness, const std::string& engine_name,
+    const bench::Parameters& parameters, bench::Curves& dataset,
+    bench::Curves& queries, Make make) {
+
+    harness.Measure(engine_name + "/build", parameters, 1, [&]() {
+      GridEngine<Structure> engine;
+      BuildGrids(engine, dataset, make);
+    });
+    if (!harness.Enabled(engine_name + "/query")) {
+      return;
+    }
+    GridEngine<Structure> engine;
+    BuildGrids(engine, dataset, make);
+    const std::vector<utils::Ragged<double>> query_vectors =
+      vectorization::Vectorize(engine.grids, kQueries, queries.points,
+                               queries.lengths, queries.offsets);
+    harness.MeasureEach(engine_name + "/query", parameters, kQueries,
+                        [&](const size_t i) {
+      bench::DoNotOptimize(std::get<0>(search::curves::grid_search(kGrids,
+                             engine.structures, queries.points, queries.lengths,
+                             queries.offsets, query_vectors, i)));
+    });
+  }
+
+  /* Projection and its structures grouped by column, as built by the
+     projection drivers */
+  template <typename Structures>
+  struct ProjectionEngine {
+    std::unique_ptr<vectorization::Projection<double,int>> rp;
+    Structures structures;
+  };
+
+  template <typename Structures, typename Add>
+  void BuildProjection(ProjectionEngine<Structures>& engine,
+    bench::Curves& dataset, Add add) {
+
+    engine.rp.reset(new vectorization::Projection<double,int>(dataset.points,
+                      dataset.offsets, dataset.lengths, dataset.ids,
+                      dataset.lengths.size(), kProjectionK));
+    engine.rp->Vectorize();
+    for (uint32_t s = 0; s < engine.rp->GetSlots(); ++s) {
+      add(engine, s);
+    }
+  }
+
+  template <typename Structures, typename Make, typename Add, typename Search>
+  void ProjectionBenchmarks(bench::Harness& harness,
+    const std::string& engine_name, const bench::Parameters& parameters,
+    bench::Curves& dataset, bench::Curves& queries, Make make, Add add,
+    Search search) {
+
+    harness.Measure(engine_name + "/build", parameters, 1, [&]() {
+      ProjectionEngine<Structures> engine{nullptr, make()};
+      BuildProjection(engine, dataset, add);
+    });
+    if (!harness.Enabled(engine_name + "/query")) {
+      return;
+    }
+    ProjectionEngine<Structures> engine{nullptr, make()};
+    BuildProjection(engine, dataset, add);
+    engine.rp->Vectorize(kQueries, queries.points, queries.lengths,
+                         queries.offsets);
+    harness.MeasureEach(engine_name + "/query", parameters, kQueries,
+                        [&](const size_t i) {
+      bench::DoNotOptimize(std::get<0>(search(engine, i)));
+    });
+  }
+
+  void CurveEngines(bench::Harness& harness) {
+    typedef search::curves::LSH<double,int> LSH;
+    typedef search::curves::HyperCube<double,int> HyperCube;
+    typedef search::curves::SharedLSH<double,int> SharedLSH;
+    typedef std::unordered_map<int,std::vector<LSH>> LSHs;
+    typedef std::unordered_map<int,std::vector<HyperCube>> HyperCubes;
+    typedef std::unordered_map<int,std::vector<uint32_t>> Tenants;
+    typedef std::pair<std::unique_ptr<SharedLSH>,Tenants> Shared;
+
+    for (const uint32_t N: {500, 2000}) {
+      for (const uint32_t length: {20, 50}) {
+        const bench::Parameters parameters{{"N", N}, {"length", length}};
+        bench::Curves dataset = bench::RandomCurves(N, length);
+        bench::Curves queries = bench::RandomCurves(kQueries, length,
+                                                    kQuerySeed);
+
+        GridBenchmarks<LSH>(harness, "grid_lsh", parameters, dataset, queries,
+                            [&](const utils::Ragged<double>& vectors,
+                                const double r) {
+          return LSH(kK, 1, N, r, dataset.points, dataset.ids, dataset.lengths,
+                     dataset.offsets, vectors);
+        });
+        GridBenchmarks<HyperCube>(harness, "grid_hypercube", parameters,
+                                  dataset, queries,
+                                  [&](const utils::Ragged<double>& vectors,
+                                      const double r) {
+          return HyperCube(kk, kM, N, kProbes, r, dataset.points, dataset.ids,
+                           dataset.lengths, dataset.offsets, vectors);
+        });
+      }
+      /* the relevant traversals grow exponentially with the length, so
+         projection is benchmarked on short curves like its datasets */
+      for (const uint32_t length: kProjectionLengths) {
+        bool enabled = false;
+        for (const std::string engine_name: {"projection_lsh",
+                                             "projection_shared_lsh",
+                                             "projection_hypercube"}) {
+          enabled = enabled || harness.Enabled(engine_name + "/build") ||
+                    harness.Enabled(engine_name + "/query");
+        }
+        if (!enabled) {
+          continue;
+        }
+        const bench::Parameters parameters{{"N", N}, {"length", length}};
+        bench::Curves dataset = bench::RandomCurves(N, length);
+        bench::Curves queries = bench::RandomCurves(kQueries, length,
+                                                    kQuerySeed);
+        const double r = utils::EstimateParameterR(dataset.points,
+          dataset.lengths, dataset.offsets, kRSamples).first;
+        auto vectors_of = [](const vectorization::Projection<double,int>& rp,
+                             const uint32_t s) {
+          return utils::RaggedView<double>(rp.GetVectors(s).data(),
+                                           kProjectionK);
+        };
+        ProjectionBenchmarks<LSHs>(harness, "projection_lsh", parameters,
+                                   dataset, queries, []() { return LSHs(); },
+                                   [&](ProjectionEngine<LSHs>& engine,
+                                       const uint32_t s) {
+          const auto& rp = *engine.rp;
+          engine.structures[std::get<1>(rp.GetSlot(s))]
+            .push_back(LSH(kK, 1, rp.GetVectors(s).size() / kProjectionK,
+                           100 * r, dataset.points, rp.GetVectorsIds(s),
+                           rp.GetVectorsLengths(s), rp.GetVectorsOffsets(s),
+                           vectors_of(rp, s)));
+        }, [&](ProjectionEngine<LSHs>& engine, const size_t i) {
+          return search::curves::projection_search(engine.structures,
+                   queries.points, engine.rp->qGetVectorsLengths(i),
+                   engine.rp->qGetVectorsOffsets(i), engine.rp->qGetVectors(i),
+                   queries.lengths[i] - 1, kM, queries.ids[i]);
+        });
+        ProjectionBenchmarks<Shared>(harness, "projection_shared_lsh",
+                                     parameters, dataset, queries, [&]() {
+          return Shared(std::unique_ptr<SharedLSH>(new SharedLSH(kK, 1,
+                          kProjectionK, 100 * r, dataset.points)), Tenants());
+        }, [&](ProjectionEngine<Shared>& engine, const uint32_t s) {
+          const auto& rp = *engine.rp;
+          engine.structures.second[std::get<1>(rp.GetSlot(s))]
+            .push_back(engine.structures.first->Add(
+                         rp.GetVectors(s).size() / kProjectionK,
+                         rp.GetVectorsIds(s), rp.GetVectorsLengths(s),
+                         rp.GetVectorsOffsets(s), vectors_of(rp, s)));
+        }, [&](ProjectionEngine<Shared>& engine, const size_t i) {
+          return search::curves::projection_search(*engine.structures.first,
+                   engine.structures.second, queries.points,
+                   engine.rp->qGetVectorsLengths(i),
+                   engine.rp->qGetVectorsOffsets(i), engine.rp->qGetVectors(i),
+                   queries.lengths[i] - 1, kM, queries.ids[i]);
+        });
+        ProjectionBenchmarks<HyperCubes>(harness, "projection_hypercube",
+                                         parameters, dataset, queries,
+                                         []() { return HyperCubes(); },
+                                         [&](ProjectionEngine<HyperCubes>& engine,
+                                             const uint32_t s) {
+          const auto& rp = *engine.rp;
+          engine.structures[std::get<1>(rp.GetSlot(s))]
+            .push_back(HyperCube(kk, kM, rp.GetVectors(s).size() / kProjectionK,
+                                 kProbes, r, dataset.points, rp.GetVectorsIds(s),
+                                 rp.GetVectorsLengths(s), rp.GetVectorsOffsets(s),
+                                 vectors_of(rp, s)));
+        }, [&](ProjectionEngine<HyperCubes>& engine, const size_t i) {
+          return search::curves::projection_search(engine.structures,
+                   queries.points, engine.rp->qGetVectorsLengths(i),
+                   engine.rp->qGetVectorsOffsets(i), engine.rp->qGetVectors(i),
+                   queries.lengths[i] - 1, kM, queries.ids[i]);
+        });
+      }
+    }
+  }
+}
+
+void bench::RunMacro(Harness& harness) {
+  VectorEngines(harness);
+  CurveEngines(harness);
+}
@@ -0,0 +1,64 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include "../includes/args_utils.h"
+#include "../includes/harness.h"
+#include "../includes/report_utils.h"
+#include "../includes/utils.h"
+
+using namespace std::chrono;
+
+int main(int argc, char **argv) {
+  utils::InputInfo input_info;
+  utils::ExitCode status;
+  int exit_code;
+
+  /* Get arguments */
+  exit_code = utils::args::ReadArguments(argc, argv, input_info, status);
+  if (exit_code != utils::SUCCESS) {
+    utils::report::ReportError(status);
+  }
+  input_info.Print();
+
+  bench::Harness harness(input_info.warmup, input_info.repetitions,
+                         input_info.filter);
+
+  /* Running micro-benchmarks of the kernels */
+  if (input_info.suite != "macro") {
+    auto start = high_resolution_clock::now();
+    std::cout << "\nRunning micro-benchmarks.." << std::endl;
+    bench::RunMicro(harness);
+    auto stop = high_resolution_clock::now();
+    duration <double> total_time = duration_cast<duration<double>>(stop - start);
+    std::cout << "Running micro-benchmarks completed successfully." << std::endl;
+    std::cout << "Time elapsed: " << total_time.count() << " seconds"
+              << std::endl;
+  }
+
+  /* Running macro-benchmarks of the engines */
+  if (input_info.suite != "micro") {
+    auto start = high_resolution_clock::now();
+    std::cout << "\nRunning macro-benchmarks.." << std::endl;
+    bench::RunMacro(harness);
+    auto stop = high_resolution_clock::now();
+    duration <double> total_time = duration_cast<duration<double>>(stop - start);
+    std::cout << "Running macro-benchmarks completed successfully." << std::endl;
+    std::cout << "Time elapsed: " << total_time.count() << " seconds"
+              << std::endl;
+  }
+
+  bench::Print(harness);
+
+  /* Writing results to the JSON file */
+  if (!input_info.json_file.empty()) {
+    std::cout << "\nWriting results to " << input_info.json_file << ".."
+              << std::endl;
+    if (!bench::WriteJson(harness, input_info.json_file)) {
+      utils::report::ReportError(utils::INVALID_OUTPUT);
+    }
+    std::cout << "Writing results completed successfully." << std::endl;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,173 @@
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <tuple>
+#include <vector>
+
+#include "../../core/hash/hash_function.h"
+#include "../../core/metric/metric.h"
+#include "../../core/utils/results.h"
+#include "../../core/utils/utils.h"
+
+#include "../../curves/core/vectorization/vectorization.h"
+
+#include "../includes/data.h"
+#include "../includes/harness.h"
+
+namespace {
+  /* number of point pairs a run of a kernel benchmark goes through */
+  constexpr uint32_t kPairs = 256;
+
+  void ManhattanKernel(bench::Harness& harness) {
+    for (const uint16_t D: {32, 128, 512}) {
+      const bench::Vectors vectors = bench::RandomVectors(2 * kPairs, D);
+      harness.Measure("kernel/manhattan", {{"D", D}}, kPairs, [&]() {
+        int sum{};
+        for (size_t i = 0; i < kPairs; ++i) {
+          auto p = std::next(vectors.points.begin(), 2 * i * D);
+          sum += metric::ManhattanDistance<int>(p, std::next(p, D),
+                                                std::next(p, 2 * D));
+        }
+        bench::DoNotOptimize(sum);
+      });
+    }
+  }
+
+  void DTWKernel(bench::Harness& harness) {
+    for (const uint32_t length: {20, 50, 100}) {
+      const bench::Curves curves = bench::RandomCurves(2 * kPairs, length);
+      auto curve = [&](const size_t i) {
+        return std::next(curves.points.begin(), curves.offsets[i]);
+      };
+      harness.Measure("kernel/dtw", {{"length", length}}, kPairs, [&]() {
+        double sum{};
+        for (size_t i = 0; i < kPairs; ++i) {
+          sum += metric::DTWDistance<double>(curve(2 * i), curve(2 * i + 1),
+                                             curve(2 * i + 1),
+                                             std::next(curve(2 * i + 1), length));
+        }
+        bench::DoNotOptimize(sum);
+      });
+      /* bound by the closest pair, like the best distance of a scan that
+         has already found the nearest neighbor */
+      double bound = std::numeric_limits<double>::max();
+      for (size_t i = 0; i < kPairs; ++i) {
+        bound = std::min(bound, metric::DTWDistance<double>(curve(2 * i),
+                                  curve(2 * i + 1), curve(2 * i + 1),
+                                  std::next(curve(2 * i + 1), length)));
+      }
+      harness.Measure("kernel/dtw_bounded", {{"length", length}}, kPairs, [&]() {
+        double sum{};
+        for (size_t i = 0; i < kPairs; ++i) {
+          sum += std::min(bound, metric::DTWDistance<double>(curve(2 * i),
+                                   curve(2 * i + 1), curve(2 * i + 1),
+                                   std::next(curve(2 * i + 1), length), bound));
+        }
+        bench::DoNotOptimize(sum);
+      });
+    }
+  }
+
+  void HashFunctions(bench::Harness& harness) {
+    const uint32_t N = 1024;
+    const uint32_t m = (1ULL << 32) - 5;
+    const double w = 200;
+    for (const uint16_t D: {32, 128, 512}) {
+      const bench::Vectors vectors = bench::RandomVectors(N, D);
+      hash::HashFunction<int> h(D, m, 1ULL << 8, w);
+      harness.Measure("hash/h", {{"D", D}}, N, [&]() {
+        uint64_t sum{};
+        for (size_t i = 0; i < N; ++i) {
+          sum += h.Hash(vectors.points, i);
+        }
+        bench::DoNotOptimize(sum);
+      });
+      for (const uint8_t K: {4, 8}) {
+        hash::AmplifiedHashFunction<int> g(K, D, m, 1ULL << (32 / K), w);
+        harness.Measure("hash/g", {{"K", K}, {"D", D}}, N, [&]() {
+          uint64_t sum{};
+          for (size_t i = 0; i < N; ++i) {
+            sum += g.Hash(vectors.points, i);
+          }
+          bench::DoNotOptimize(sum);
+        });
+      }
+    }
+  }
+
+  void Vectorizers(bench::Harness& harness) {
+    const uint32_t N = 1000;
+    for (const uint32_t length: {20, 50}) {
+      bench::Curves curves = bench::RandomCurves(N, length);
+      const double delta = utils::ComputeDelta(curves.points, curves.lengths,
+                                               curves.offsets);
+      std::vector<vectorization::Grid<double>> grids;
+      grids.push_back(vectorization::Grid<double>(curves.points, curves.lengths,
+                                                  curves.offsets, N, 2 * length,
+                                                  10 * delta));
+      harness.Measure("vectorize/grid", {{"N", N}, {"length", length}}, N,
+                      [&]() {
+        std::vector<utils::Ragged<double>> vectors =
+          vectorization::Vectorize(grids, N, curves.points, curves.lengths,
+                                   curves.offsets);
+        bench::DoNotOptimize(vectors[0].Size());
+      });
+    }
+    /* the relevant traversals grow exponentially with the length, so
+       projection is benchmarked on short curves like its datasets */
+    for (const uint32_t length: {4, 6}) {
+      bench::Curves curves = bench::RandomCurves(N, length);
+      // K as computed by the projection drivers for the default e = 0.5
+      const int K = 8;
+      harness.Measure("vectorize/projection", {{"N", N}, {"length", length}}, N,
+                      [&]() {
+        vectorization::Projection<double,int> rp{curves.points, curves.offsets,
+                                                 curves.lengths, curves.ids,
+                                                 N, K};
+        rp.Vectorize();
+        bench::DoNotOptimize(rp.GetSlots());
+      });
+    }
+  }
+
+  /* results are written to /dev/null, so that formatting and buffering
+     are measured and not the disk */
+  void ResultWriters(bench::Harness& harness) {
+    const uint32_t Q = 10000;
+    std::vector<std::tuple<double,int,double>> results;
+    for (size_t i = 0; i < Q; ++i) {
+      results.push_back(std::make_tuple(1000.0 / (i + 1), i, 1e-4 / (i + 1)));
+    }
+    harness.Measure("write/stream_endl", {{"Q", Q}}, Q, [&]() {
+      std::ofstream out("/dev/null");
+      for (size_t i = 0; i < Q; ++i) {
+        out << "Query: " << i << std::endl;
+        out << "Nearest neighbor: " << std::get<1>(results[i]) << std::endl;
+        out << "distance: " << std::get<0>(results[i]) << std::endl;
+        out << "t: " << std::get<2>(results[i]) << " seconds" << std::endl;
+      }
+    });
+    const char *names[] = {"csv", "jsonl", "binary"};
+    for (const auto format: {utils::results::CSV, utils::results::JSONL,
+                             utils::results::BINARY}) {
+      harness.Measure(std::string("write/") + names[format - 1], {{"Q", Q}}, Q,
+                      [&]() {
+        utils::results::Writer<double,int> writer("/dev/null", format);
+        for (size_t i = 0; i < Q; ++i) {
+          writer.Write(i, results[i], results[i]);
+        }
+        writer.Close();
+      });
+    }
+  }
+}
+
+void bench::RunMicro(Harness& harness) {
+  ManhattanKernel(harness);
+  DTWKernel(harness);
+  HashFunctions(harness);
+  Vectorizers(harness);
+  ResultWriters(harness);
+}
@@ -0,0 +1,22 @@
+#include <iostream>
+
+#include "../includes/utils.h"
+#include "../includes/report_utils.h"
+
+void utils::report::ReportError(const utils::ExitCode &code) {
+  switch (code) {
+    case INVALID_SUITE:
+      std::cout << "\n[ERROR]: " << "Invalid suite, expected micro, macro or all"
+                << std::endl;
+      break;
+    case INVALID_REPETITIONS:
+      std::cout << "\n[ERROR]: " << "Invalid number of repetitions" << std::endl;
+      break;
+    case INVALID_OUTPUT:
+      std::cout << "\n[ERROR]: " << "Invalid output file name" << std::endl;
+      break;
+    default:
+      abort();
+  }
+  exit(EXIT_FAILURE);
+}
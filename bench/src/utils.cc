@@ -0,0 +1,36 @@
+#include <iostream>
+#include <string>
+
+#include "../includes/utils.h"
+
+void utils::ShowUsage(const std::string &program_name,
+  const struct InputInfo &input_info) {
+  std::cerr << "usage: " << program_name << " [--help] [--json FILE]"
+            << " [--suite micro|macro|all] [--filter NAME] [--warmup INT]"
+            << " [--repetitions INT]"
+            << "\n\n"
+            << "optional arguments:\n"
+            << "  -help\tshow this help message and exit\n"
+            << "  --json\twrite the results as JSON to a file\n"
+            << "  --suite\tdefine the benchmarks to run: micro (kernels, hash"
+            << " functions, vectorizers), macro (build and query of every"
+            << " engine) or all (default = " << input_info.suite << ")\n"
+            << "  --filter\trun only benchmarks whose name contains NAME,"
+            << " e.g kernel/dtw or grid_lsh\n"
+            << "  --warmup\tdefine the unmeasured runs of every benchmark"
+            << " (default = " << input_info.warmup << ")\n"
+            << "  --repetitions\tdefine the measured runs of every benchmark"
+            << " (default = " << input_info.repetitions << ")\n"
+            << std::endl;
+  exit(EXIT_FAILURE);
+}
+
+void utils::InputInfo::Print(void) {
+  std::cout << std::endl;
+  std::cout << "JSON file: "
+            << (json_file.empty() ? "none" : json_file) << std::endl;
+  std::cout << "Suite: " << suite << std::endl;
+  std::cout << "Filter: " << (filter.empty() ? "none" : filter) << std::endl;
+  std::cout << "Warm-up runs: " << warmup << std::endl;
+  std::cout << "Repetitions: " << repetitions << std::endl;
+}
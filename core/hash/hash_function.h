@@ -6,6 +6,7 @@
 #include <chrono>
 #include <iostream>
 #include <iterator>
+#include <limits>
 #include <random>
 #include <stdlib.h>
 #include <string>
@@ -26,6 +27,39 @@ namespace hash {
       const double w;
       std::vector<double> s;
       std::vector<int> a;
+      /* powers[i] = m^(D-1-i) modM, the factor of a_i in h(x) */
+      std::vector<uint64_t> powers;
+      /* padding[i] = sum of the terms of a_i..a_D-1 when they are padding */
+      std::vector<uint32_t> padding;
+      /**
+        \brief Window of a padding coordinate
+      */
+      static constexpr int kPadding = std::numeric_limits<int>::min();
+      /**
+        \brief Precompute powers and padding terms of h(x)
+      */
+      void Precompute(void) {
+        powers.resize(D);
+        padding.assign(D + 1, 0);
+        for (size_t i = 0; i < D; ++i) {
+          powers[i] = utils::mod_exp(m, D - 1 - i, M);
+        }
+        for (size_t i = D; i > 0; --i) {
+          padding[i - 1] = padding[i] + (utils::mod(kPadding,M) * powers[i - 1]) % M;
+        }
+      };
+      /**
+        \brief Compute h(x) = (a_d−1 + m*a_d−2 +···+ m^(d−1)*a_0) modM
+        where a_length..a_d-1 are padding
+      */
+      uint32_t Combine(const size_t length) const {
+        uint32_t hash_value = padding[length];
+        /* Computing h(x) */
+        for (size_t i = 0; i < length; ++i) {
+          hash_value += (utils::mod(a[i],M) * powers[i]) % M;
+        }
+        return hash_value % M;
+      };
     public:
       /** \brief HashFunction class constructor
         This class illustrates the following hash function:
@@ -44,6 +78,16 @@ namespace hash {
         for (size_t i = 0; i < D; ++i) {
           s[i] = distribution(generator);
         }
+        Precompute();
+      };
+      /** \brief HashFunction class constructor from given shifts
+        Used to restore a hash function from a persisted index
+        @par shifts - the D shifts s_i drawn at construction time
+      */
+      HashFunction(const uint16_t D, const uint32_t m, const uint32_t M,
+        const double w, const double *shifts): D(D), m(m), M(M), w(w),
+        distribution(0,w), s(shifts, shifts + D), a(D) {
+        Precompute();
       };
       /**
         \brief HashFunction class default destructor
@@ -55,18 +99,43 @@ namespace hash {
         2) Compute h(x) = (a_d−1 + m*a_d−2 +···+ m^(d−1)*a_0) modM
       */
       uint32_t Hash(const std::vector<T> &points, int offset) {
-        uint32_t hash_value{};
+        return Hash(&points[(size_t) offset * D], D);
+      };
+      /** \brief Hash the first length coordinates of a point, the rest
+        D - length coordinates are padding
+        @par const T *point - the coordinates of the point
+        @par const size_t length - number of coordinates of the point
+      */
+      uint32_t Hash(const T *point, const size_t length) {
         /* Computing a_i */
-        for (size_t i = 0; i < D; ++i) {
-          a[i] = floor((points[offset * D + i] - s[i]) / w);
+        for (size_t i = 0; i < length; ++i) {
+          a[i] = floor((point[i] - s[i]) / w);
         }
-        /* Reverse vector a */
-        std::reverse(a.begin(),a.end());
-        /* Computing h(x) */
-        for (size_t i = 0; i < D; ++i) {
-          hash_value += (utils::mod(a[i],M) * utils::mod_exp(m,i,M)) % M;
+        return Combine(length);
+      };
+      /** \brief Hash point as above and also compute its margin, i.e the
+        distance of the point from the closest boundary of its window
+        @par double &margin - Pass by reference the margin to be returned
+      */
+      uint32_t Hash(const std::vector<T> &points, int offset, double &margin) {
+        return Hash(&points[(size_t) offset * D], D, margin);
+      };
+      uint32_t Hash(const T *point, const size_t length, double &margin) {
+        margin = w;
+        /* Computing a_i and the distance to the window boundaries */
+        for (size_t i = 0; i < length; ++i) {
+          double x = (point[i] - s[i]) / w;
+          a[i] = floor(x);
+          double frac = x - a[i];
+          margin = std::min(margin, std::min(frac, 1 - frac) * w);
         }
-        return hash_value % M;
+        return Combine(length);
+      };
+      /**
+        \brief Returns the shifts s_i of the hash function
+      */
+      const std::vector<double>& GetShifts(void) const {
+        return s;
       };
   };
 
@@ -95,6 +164,16 @@ namespace hash {
             h.push_back(HashFunction<T>(D, m, M, w));
           }
         }
+      /** \brief AmplifiedHashFunction class constructor from given shifts
+        @par shifts - K * D shifts, D for each one of the K hash functions
+      */
+      AmplifiedHashFunction(const uint8_t K, const uint16_t D, const uint32_t m,
+        const uint32_t M, const double w, const double *shifts):
+        K(K), D(D), m(m), M(M), w(w) {
+          for (size_t i = 0; i < K; ++i) {
+            h.push_back(HashFunction<T>(D, m, M, w, shifts + i * D));
+          }
+        }
       /**
         \brief AmplifiedHashFunction class default destructor
       */
@@ -104,15 +183,47 @@ namespace hash {
         2) Concat h_i and modulo with table_size
       */
       uint64_t Hash(const std::vector<T> &points, int offset) {
+        return Hash(&points[(size_t) offset * D], D);
+      }
+      /** \brief Hash the first length coordinates of a point as above,
+        the rest D - length coordinates are padding
+      */
+      uint64_t Hash(const T *point, const size_t length) {
+        std::string str_value{};
+        for (size_t i = 0; i < K; ++i) {
+          str_value += std::to_string(h[i].Hash(point,length));
+        }
+        // convert str_value to uint64_t
+        char *p_end;
+        uint64_t hash_value = strtoull(str_value.c_str(), &p_end, 10);
+        return hash_value;
+      }
+      /** \brief Hash point as above and compute the margin of g as the
+        minimum margin of h_i, i = 1..K
+        @par double &margin - Pass by reference the margin to be returned
+      */
+      uint64_t Hash(const std::vector<T> &points, int offset, double &margin) {
+        return Hash(&points[(size_t) offset * D], D, margin);
+      }
+      uint64_t Hash(const T *point, const size_t length, double &margin) {
         std::string str_value{};
+        margin = w;
         for (size_t i = 0; i < K; ++i) {
-          str_value += std::to_string(h[i].Hash(points,offset));
+          double margin_i;
+          str_value += std::to_string(h[i].Hash(point,length,margin_i));
+          margin = std::min(margin, margin_i);
         }
         // convert str_value to uint64_t
         char *p_end;
         uint64_t hash_value = strtoull(str_value.c_str(), &p_end, 10);
         return hash_value;
       }
+      /**
+        \brief Returns the K hash functions h_i of g
+      */
+      const std::vector<HashFunction<T>>& GetHashFunctions(void) const {
+        return h;
+      };
   };
 
 }
@@ -1,9 +1,13 @@
 #ifndef METRIC
 #define METRIC
 
+#include <algorithm>
+#include <iterator>
+#include <limits>
 #include <utility>
 #include <cmath>
 #include <tuple>
+#include <vector>
 
 #include "../utils/utils.h"
 
@@ -34,6 +38,64 @@ namespace metric {
     }
     return manhattan_distance;
   }
+  /** \brief Computes Manhattan Distance of 2 points in R^d given only
+    their first p_length and q_length coordinates. The rest coordinates
+    are padding coordinates equal to the max value of T, so the result
+    is the same as the distance of the padded points
+    @par const T *p - dataset point
+    @par const T *q - query point
+    returns: manhattan_distance type of T
+  */
+  template <typename T>
+  T PaddedManhattanDistance(const T *p, const size_t p_length,
+    const T *q, const size_t q_length) {
+    const T padding = std::numeric_limits<T>::max();
+    const size_t length = std::min(p_length, q_length);
+    T manhattan_distance{};
+    for (size_t i = 0; i < length; ++i) {
+      manhattan_distance += std::abs(q[i] - p[i]);
+    }
+    for (size_t i = length; i < p_length; ++i) {
+      manhattan_distance += std::abs(padding - p[i]);
+    }
+    for (size_t i = length; i < q_length; ++i) {
+      manhattan_distance += std::abs(q[i] - padding);
+    }
+    return manhattan_distance;
+  }
+  /** \brief Computes Manhattan Distance of 2 padded points as above, but
+    abandons as soon as the partial sum exceeds bound, as every term is non
+    negative. A padding term is huge, so it usually ends the sum.
+    @par const double bound - distance above which the exact value is not
+      needed, a double so that no bound overflows T
+    returns: manhattan_distance, or the max value of T if it exceeds bound
+  */
+  template <typename T>
+  T PaddedManhattanDistance(const T *p, const size_t p_length,
+    const T *q, const size_t q_length, const double bound) {
+    const T padding = std::numeric_limits<T>::max();
+    const size_t length = std::min(p_length, q_length);
+    T manhattan_distance{};
+    for (size_t i = 0; i < length; ++i) {
+      manhattan_distance += std::abs(q[i] - p[i]);
+      if (manhattan_distance > bound) {
+        return std::numeric_limits<T>::max();
+      }
+    }
+    for (size_t i = length; i < p_length; ++i) {
+      manhattan_distance += std::abs(padding - p[i]);
+      if (manhattan_distance > bound) {
+        return std::numeric_limits<T>::max();
+      }
+    }
+    for (size_t i = length; i < q_length; ++i) {
+      manhattan_distance += std::abs(q[i] - padding);
+      if (manhattan_distance > bound) {
+        return std::numeric_limits<T>::max();
+      }
+    }
+    return manhattan_distance;
+  }
   /** \brief Computes Euclidian Distance of 2 points in R^2
     @par const std::pair<T,T>& p - first point
     @par const std::pair<T,T>& q - second point
@@ -105,6 +167,56 @@ namespace metric {
     // Return dynamic time warping distance
     return dtw_distance;
   }
+  /** \brief Computes Dynamic Time Warping between two curves as above, but
+    abandons as soon as the distance is known to exceed bound. Costs are non
+    negative, so every warping path crosses row i of the dtw array with a
+    cost no less than the minimum of the row.
+    @par const T bound - distance above which the exact value is not needed
+    returns: the dtw distance, or the max value of T if it exceeds bound
+  */
+  template <typename T, typename iterator>
+  T DTWDistance(iterator p, iterator p_end, iterator q, iterator q_end,
+    const T bound) {
+    const size_t M = std::distance(q, q_end);
+    // previous and current row of the dtw array
+    std::vector<T> previous(M + 1, std::numeric_limits<T>::max());
+    std::vector<T> current(M + 1);
+    previous[0] = 0;
+    for (; p < p_end; ++p) {
+      current[0] = std::numeric_limits<T>::max();
+      T row_min = std::numeric_limits<T>::max();
+      iterator q_j = q;
+      for (size_t j = 1; j < M + 1; ++j, ++q_j) {
+        current[j] = _2DEuclidianDistance(*p, *q_j) +
+          utils::min(previous[j], current[j - 1], previous[j - 1]);
+        row_min = std::min(row_min, current[j]);
+      }
+      if (row_min > bound) {
+        return std::numeric_limits<T>::max();
+      }
+      std::swap(previous, current);
+    }
+    return previous[M];
+  }
+  /** \brief Computes a lower bound of Dynamic Time Warping between two
+    curves in O(1). Every warping path matches the first points and the last
+    points of the curves, so their distances are part of any DTW distance
+    @par iterator p - iterator of the dataset curve
+    @par iterator p_end - end iterator of dataset curve
+    @par iterator q - iterator of the query curve
+    @par iterator q_end - end iterator of query curve
+  */
+  template <typename T, typename iterator>
+  T DTWLowerBound(iterator p, iterator p_end, iterator q, iterator q_end) {
+    if (p == p_end || q == q_end) {
+      return T{};
+    }
+    T lower_bound = _2DEuclidianDistance(*p, *q);
+    if (std::distance(p, p_end) > 1 || std::distance(q, q_end) > 1) {
+      lower_bound += _2DEuclidianDistance(*std::prev(p_end), *std::prev(q_end));
+    }
+    return lower_bound;
+  }
   /** \brief Computes average and max distance ratio appox_dists / exact_dists
     Each tuple consists of the nearest distance found, the id of the point/curve
     with minimum distance and the time taken to be computed
@@ -0,0 +1,163 @@
+#ifndef REPORT
+#define REPORT
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "../utils/histogram.h"
+#include "../utils/timing.h"
+
+namespace metric {
+  /** \brief Report - quality and latency of approximate NN against exact NN
+    @par queries - number of queries evaluated
+    @par not_found - queries the approximate search did not answer
+    @par k - rank of recall_at_k
+    @par recall_at_1 - fraction of queries answered with an exact NN
+    @par recall_at_k - fraction of queries answered with one of the
+      exact k nearest neighbors
+    @par af - approximation factor percentiles over the answered queries
+    @par qps - queries per second of the approximate search
+    @par latency, exact_latency - latencies of approximate and exact NN,
+      over the queries timed by the timing policy of the engines
+  */
+  struct Report {
+    uint32_t queries;
+    uint32_t not_found;
+    uint32_t k;
+    double recall_at_1;
+    double recall_at_k;
+    double af_mean;
+    double af_p50;
+    double af_p90;
+    double af_p99;
+    double af_max;
+    double qps;
+    utils::Histogram latency;
+    utils::Histogram exact_latency;
+  };
+  /** \brief Evaluate approximate NN results against exact NN results
+    @par exact - results of brute force as distance, id and seconds
+    @par approx - results of the approximate search as above
+    @par kth - distance of the k-th exact nearest neighbor of every query,
+      empty to evaluate recall at k = 1 only
+    @par seconds - time of the whole batch of approximate queries, qps is
+      estimated from the timed queries if it is not given
+  */
+  template <typename T, typename U>
+  Report Evaluate(const std::vector<std::tuple<T,U,double>>& exact,
+    const std::vector<std::tuple<T,U,double>>& approx,
+    const std::vector<T>& kth = std::vector<T>(), const uint32_t k = 1,
+    const double seconds = 0) {
+
+    Report report{};
+    report.queries = exact.size();
+    report.k = kth.empty() ? 1 : k;
+    size_t at_1{}, at_k{};
+    std::vector<double> af;
+    for (size_t i = 0; i < exact.size(); ++i) {
+      if (std::get<2>(exact[i]) != utils::timing::kNotTimed) {
+        report.exact_latency.Record(std::get<2>(exact[i]));
+      }
+      if (std::get<2>(approx[i]) != utils::timing::kNotTimed) {
+        report.latency.Record(std::get<2>(approx[i]));
+      }
+      const T dist = std::get<0>(approx[i]);
+      if (dist == std::numeric_limits<T>::max()) {
+        report.not_found++;
+        continue;
+      }
+      at_1 += dist <= std::get<0>(exact[i]);
+      at_k += dist <= (kth.empty() ? std::get<0>(exact[i]) : kth[i]);
+      // same as EvaluationMetric, zero distances have no ratio
+      if (dist != 0 && std::get<0>(exact[i]) != 0) {
+        af.push_back((double) dist / std::get<0>(exact[i]));
+      }
+    }
+    if (report.queries) {
+      report.recall_at_1 = (double) at_1 / report.queries;
+      report.recall_at_k = (double) at_k / report.queries;
+    }
+    if (!af.empty()) {
+      std::sort(af.begin(), af.end());
+      // nearest rank of percentile p is ceil(p * n)
+      auto percentile = [&](const double p) {
+        return af[std::max<size_t>(std::ceil(p * af.size()), 1) - 1];
+      };
+      double sum{};
+      for (const auto& ratio: af) {
+        sum += ratio;
+      }
+      report.af_mean = sum / af.size();
+      report.af_p50 = percentile(0.5);
+      report.af_p90 = percentile(0.9);
+      report.af_p99 = percentile(0.99);
+      report.af_max = af.back();
+    }
+    if (seconds > 0) {
+      report.qps = report.queries / seconds;
+    } else if (report.latency.Sum() > 0) {
+      report.qps = report.latency.Count() / report.latency.Sum();
+    }
+    return report;
+  }
+  /** \brief Write a report as JSON, or as metric,value CSV rows if the
+      file name ends in .csv. Latencies are in seconds.
+      Throws std::runtime_error on I/O failure
+    @par const std::string& file_name - Path to the report file
+  */
+  inline void WriteReport(const std::string& file_name, const Report& report) {
+    const std::vector<std::pair<std::string,double>> values{
+      {"queries", report.queries},
+      {"not_found", report.not_found},
+      {"k", report.k},
+      {"recall_at_1", report.recall_at_1},
+      {"recall_at_k", report.recall_at_k},
+      {"af_mean", report.af_mean},
+      {"af_p50", report.af_p50},
+      {"af_p90", report.af_p90},
+      {"af_p99", report.af_p99},
+      {"af_max", report.af_max},
+      {"qps", report.qps},
+      {"latency_mean", report.latency.Mean()},
+      {"latency_p50", report.latency.Percentile(0.5)},
+      {"latency_p90", report.latency.Percentile(0.9)},
+      {"latency_p99", report.latency.Percentile(0.99)},
+      {"latency_p999", report.latency.Percentile(0.999)},
+      {"latency_max", report.latency.Max()},
+      {"exact_latency_mean", report.exact_latency.Mean()},
+      {"exact_latency_p50", report.exact_latency.Percentile(0.5)},
+      {"exact_latency_p99", report.exact_latency.Percentile(0.99)}
+    };
+    const bool csv = file_name.size() >= 4 &&
+                     file_name.compare(file_name.size() - 4, 4, ".csv") == 0;
+    std::ofstream file(file_name);
+    file.precision(9);
+    if (csv) {
+      file << "metric,value\n";
+    } else {
+      file << "{";
+    }
+    for (size_t i = 0; i < values.size(); ++i) {
+      if (csv) {
+        file << values[i].first << "," << values[i].second << "\n";
+      } else {
+        file << (i ? "," : "") << "\n  \"" << values[i].first << "\": "
+             << values[i].second;
+      }
+    }
+    if (!csv) {
+      file << "\n}\n";
+    }
+    if (!file.flush()) {
+      throw std::runtime_error("can not write " + file_name);
+    }
+  }
+}
+
+#endif
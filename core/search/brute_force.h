@@ -2,9 +2,12 @@
 #define BRUTE_FORCE
 
 #include <limits>
+#include <queue>
 #include <tuple>
 
 #include "../../core/metric/metric.h"
+#include "../../core/utils/ragged.h"
+#include "../../core/utils/timing.h"
 
 using namespace std::chrono;
 
@@ -14,12 +17,12 @@ namespace search {
   */
   namespace vectors {
 
-    template <typename T, typename U>
+    template <typename T, typename U, typename Timing = utils::QueryTiming>
     class BruteForce {
       private:
         const uint32_t N;
         const uint16_t D;
-        const std::vector<T>& feature_vector;
+        const utils::RaggedView<T> feature_vector;
         const std::vector<U>& feature_vector_ids;
       public:
         /** \brief class BruteForce constructor
@@ -30,7 +33,17 @@ namespace search {
         */
         BruteForce(const uint32_t N, const uint16_t D,
             const std::vector<T>& points, const std::vector<U>& ids)
-          : N(N), D(D), feature_vector(points), feature_vector_ids(ids) {};
+          : N(N), D(D), feature_vector(points, D), feature_vector_ids(ids) {
+          Timing::Calibrate();
+        };
+        /** \brief class BruteForce constructor on variable length points,
+          implicitly padded to their dimension D
+        */
+        BruteForce(const uint32_t N, const utils::Ragged<T>& points,
+            const std::vector<U>& ids)
+          : N(N), D(points.D), feature_vector(points), feature_vector_ids(ids) {
+          Timing::Calibrate();
+        };
         /**
           \brief class BruteForce default construct
         */
@@ -41,27 +54,58 @@ namespace search {
         */
         std::tuple<T,U,double> NearestNeighbor(const std::vector<T>& query_points,
           const int idx) {
+          return NearestNeighbor(&query_points[(size_t) idx * D], D);
+        };
+        std::tuple<T,U,double> NearestNeighbor(const utils::Ragged<T>& query_points,
+          const int idx) {
+          return NearestNeighbor(query_points.Data(idx), query_points.Length(idx));
+        };
+        /** \brief Executes exact Nearest tNeighbor of a query point given
+          its first length coordinates
+        */
+        std::tuple<T,U,double> NearestNeighbor(const T *query, const size_t length) {
 
-          auto start = high_resolution_clock::now();
+          const typename Timing::Stamp start = Timing::Start();
           /* Initialize min_dist to max value of type T */
           T min_dist = std::numeric_limits<T>::max();
           /* Initialize correspodent min_id using the C++11 way */
           U min_id{};
           /* Run NearestNeighbor for all points in the dataset */
           for (size_t i = 0; i < N; ++i) {
-            T dist = metric::ManhattanDistance<T>(
-              std::next(feature_vector.begin(), i * D),
-              std::next(query_points.begin(), idx * D),
-              std::next(query_points.begin(), idx * D + D));
+            T dist = metric::PaddedManhattanDistance<T>(feature_vector.Data(i),
+                                                        feature_vector.Length(i),
+                                                        query, length);
             if (dist < min_dist) {
               min_dist = dist;
               min_id = feature_vector_ids[i];
             }
           }
-          auto stop = high_resolution_clock::now();
-          duration <double> total_time = duration_cast<duration<double>>(stop - start);
-          /* return result as a tuple of min_dist, min_id and total_time */
-          return std::make_tuple(min_dist,min_id,total_time.count());
+          /* return result as a tuple of min_dist, min_id and seconds taken */
+          return std::make_tuple(min_dist,min_id,Timing::Stop(start));
+        };
+        /** \brief Distance of the k-th nearest neighbor of a query point,
+          used to evaluate recall at k
+          @par const std::vector<T>& query_points - Pass by reference query points
+          @par const int idx - idx to get correspodent point
+        */
+        T KthNearestDistance(const std::vector<T>& query_points, const int idx,
+          const uint32_t k) {
+
+          const T *query = &query_points[(size_t) idx * D];
+          /* max heap of the k smallest distances */
+          std::priority_queue<T> nearest;
+          for (size_t i = 0; i < N; ++i) {
+            T dist = metric::PaddedManhattanDistance<T>(feature_vector.Data(i),
+                                                        feature_vector.Length(i),
+                                                        query, D);
+            if (nearest.size() < k) {
+              nearest.push(dist);
+            } else if (dist < nearest.top()) {
+              nearest.pop();
+              nearest.push(dist);
+            }
+          }
+          return nearest.empty() ? std::numeric_limits<T>::max() : nearest.top();
         };
         /** \brief Executes (r,c)-Nearest tNeighbor
           @par const std::vector<T> &query_points - Pass by reference query points
@@ -71,14 +115,14 @@ namespace search {
           const std::vector<T>& query_points,
           const int idx, const double R) {
 
+          const T *query = &query_points[(size_t) idx * D];
           /* Define result vector */
           std::vector<std::pair<T,U>> result;
           /* Run (r,c)-NearestNeighbor for all points in the dataset */
           for (size_t i = 0; i < N; ++i) {
-            T dist = metric::ManhattanDistance<T>(
-              std::next(feature_vector.begin(), i * D),
-              std::next(query_points.begin(), idx * D),
-              std::next(query_points.begin(), idx * D + D));
+            T dist = metric::PaddedManhattanDistance<T>(feature_vector.Data(i),
+                                                        feature_vector.Length(i),
+                                                        query, D);
             if (dist <= R) {
               result.push_back(std::make_pair(dist,feature_vector_ids[i]));
             }
@@ -92,7 +136,7 @@ namespace search {
   */
   namespace curves {
 
-    template <typename T, typename U>
+    template <typename T, typename U, typename Timing = utils::QueryTiming>
     class BruteForce {
       private:
         const std::vector<std::pair<T,T>>& input_curves;
@@ -111,7 +155,9 @@ namespace search {
           const std::vector<U>& ids, const std::vector<int>& lengths,
           const std::vector<int>& offsets)
           : input_curves(curves), input_curves_ids(ids),
-            input_curves_lengths(lengths), input_curves_offsets(offsets) {};
+            input_curves_lengths(lengths), input_curves_offsets(offsets) {
+          Timing::Calibrate();
+        };
         /**
           \brief class BruteForce default construct
         */
@@ -130,7 +176,7 @@ namespace search {
           const std::vector<int>& query_lengths,
           const std::vector<int>& query_offsets, const int idx) {
 
-          auto start = high_resolution_clock::now();
+          const typename Timing::Stamp start = Timing::Start();
           /* Initialize min_dist to max value of type T */
           T min_dist = std::numeric_limits<T>::max();
           /* Initialize correspodent min_id using the C++11 way */
@@ -149,10 +195,39 @@ namespace search {
               min_id = input_curves_ids[i];
             }
           }
-          auto stop = high_resolution_clock::now();
-          duration <double> total_time = duration_cast<duration<double>>(stop - start);
-          /* return result as a tuple of min_dist, min_id and total_time */
-          return std::make_tuple(min_dist,min_id,total_time.count());
+          /* return result as a tuple of min_dist, min_id and seconds taken */
+          return std::make_tuple(min_dist,min_id,Timing::Stop(start));
+        };
+        /** \brief Distance of the k-th nearest neighbor of a query curve,
+          used to evaluate recall at k. Curves farther than the k-th nearest
+          found so far are abandoned early.
+          @par const int idx - Index to current query curve
+        */
+        T KthNearestDistance(const std::vector<std::pair<T,T>>& query_curves,
+          const std::vector<int>& query_lengths,
+          const std::vector<int>& query_offsets, const int idx,
+          const uint32_t k) {
+
+          /* max heap of the k smallest distances */
+          std::priority_queue<T> nearest;
+          for (size_t i = 0; i < input_curves_ids.size(); ++i) {
+            const T bound = nearest.size() < k ? std::numeric_limits<T>::max()
+                                               : nearest.top();
+            T dist = metric::DTWDistance<T>(
+              std::next(input_curves.begin(),input_curves_offsets[i]),
+              std::next(input_curves.begin(),
+                        input_curves_offsets[i] + input_curves_lengths[i]),
+              std::next(query_curves.begin(),query_offsets[idx]),
+              std::next(query_curves.begin(),
+                        query_offsets[idx] + query_lengths[idx]), bound);
+            if (nearest.size() < k) {
+              nearest.push(dist);
+            } else if (dist < nearest.top()) {
+              nearest.pop();
+              nearest.push(dist);
+            }
+          }
+          return nearest.empty() ? std::numeric_limits<T>::max() : nearest.top();
         };
     };
   }
@@ -1,14 +1,26 @@
 #ifndef HYPERCUBE
 #define HYPERCUBE
 
+#include <algorithm>
+#include <cmath>
+#include <functional>
 #include <iterator>
+#include <memory>
+#include <queue>
 #include <random>
+#include <stdexcept>
 #include <tuple>
 #include <unordered_map>
 #include <bitset>
 
 #include "../../core/hash/hash_function.h"
 #include "../../core/metric/metric.h"
+#include "../../core/utils/counters.h"
+#include "../../core/utils/parallel.h"
+#include "../../core/utils/ragged.h"
+#include "../../core/utils/span.h"
+#include "../../core/utils/snapshot.h"
+#include "../../core/utils/timing.h"
 #include "../../core/utils/utils.h"
 
 using namespace std::chrono;
@@ -25,73 +37,947 @@ namespace search {
     @par D - points' dimension
     @par N - number of dataset points
     @par R - average of exact NN distances calculated using brute force search
+    @par Counters - policy counting the work of the queries, see counters.h
+    @par Timing - policy timing every query, see timing.h
   */
+  /** \brief Magic string and version of HyperCube snapshot files */
+  constexpr const char* kHyperCubeMagic = "HYPERCUBE";
+  constexpr uint32_t kHyperCubeVersion = 4;
+  /** \brief Vertices and bucket offsets of a cube are 32 bit, so a cube
+    has 1 to 31 dimensions
+  */
+  inline bool ValidCubeDimensions(const uint16_t k) {
+    return k >= 1 && k <= 31;
+  }
+  /** \brief Number of dimensions a cube may have beyond ceil(log2 N)
+  */
+  constexpr uint16_t kCubeSlack = 4;
+  /** \brief The table of a cube takes 2^k + 1 bucket offsets whatever its
+    N points, so a cube of more than 2^kCubeSlack vertices per point is
+    rejected as well, e.g k = 30 would allocate 4 GB for any dataset
+  */
+  inline bool ValidCubeDimensions(const uint16_t k, const uint32_t N) {
+    uint16_t log2_N = 0;
+    while ((1ULL << log2_N) < N) {
+      ++log2_N;
+    }
+    return ValidCubeDimensions(k) && k <= log2_N + kCubeSlack;
+  }
+  /**
+    \brief HammingBall - enumerates the vertices of a k-dimensional cube in
+      increasing Hamming distance 1, 2, ..., k from a given vertex.
+      Vertices at the same distance d are generated from the masks of d set
+      bits in increasing order using Gosper's hack, so no memory is allocated.
+  */
+  class HammingBall {
+    private:
+      const uint32_t vertex;
+      const uint16_t k;
+      uint16_t distance;
+      uint32_t mask;
+    public:
+      HammingBall(const uint32_t vertex, const uint16_t k) :
+        vertex(vertex), k(k), distance(1), mask(1) {};
+      /** \brief Get the next vertex of the ball
+        @par uint32_t& probe - the vertex to be probed
+        returns: false when all 2^k - 1 vertices have been generated
+      */
+      bool Next(uint32_t& probe) {
+        if (distance > k) {
+          return false;
+        }
+        probe = vertex ^ mask;
+        // Gosper's hack: next mask with the same number of set bits
+        uint64_t c = mask & -mask;
+        uint64_t r = mask + c;
+        uint64_t next = (((r ^ mask) >> 2) / c) | r;
+        if (next >= (1ULL << k)) {
+          ++distance;
+          next = (1ULL << distance) - 1;
+        }
+        mask = next;
+        return true;
+      };
+  };
+  /**
+    \brief ProbeOrder - order in which the neighbor vertices of a query
+      are probed
+      - HAMMING_ORDER: increasing Hamming distance from the query's vertex
+      - MARGIN_ORDER: increasing sum of the margins of the flipped bits,
+        where the margin of bit i is the distance of the query from the
+        closest window boundary of g_i (query-directed multi-probe)
+  */
+  typedef enum ProbeOrder {
+    HAMMING_ORDER,
+    MARGIN_ORDER
+  } ProbeOrder;
+  /**
+    \brief MarginProbes - enumerates the vertices of a k-dimensional cube in
+      increasing total margin of the bits flipped from a given vertex.
+      Bits are sorted by margin and sets of sorted positions are generated
+      from a min-heap using the shift and expand operations, so each set
+      is generated exactly once and in order of its score.
+  */
+  class MarginProbes {
+    private:
+      typedef std::pair<double,uint32_t> Set;
+      const uint32_t vertex;
+      const uint16_t k;
+      uint8_t order[32];
+      double z[32];
+      std::priority_queue<Set, std::vector<Set>, std::greater<Set>> heap;
+    public:
+      /** \brief MarginProbes class constructor
+        @par const double *margins - the k margins of the query's bits
+      */
+      MarginProbes(const uint32_t vertex, const uint16_t k,
+        const double *margins) : vertex(vertex), k(k), order(), z() {
+        for (size_t i = 0; i < k; ++i) {
+          order[i] = i;
+        }
+        std::sort(order, order + k, [margins](uint8_t a, uint8_t b) {
+          return margins[a] < margins[b];
+        });
+        for (size_t i = 0; i < k; ++i) {
+          z[i] = margins[order[i]];
+        }
+        heap.push(std::make_pair(z[0], 1U));
+      };
+      /** \brief Get the next vertex in increasing score
+        @par uint32_t& probe - the vertex to be probed
+        returns: false when all 2^k - 1 vertices have been generated
+      */
+      bool Next(uint32_t& probe) {
+        if (heap.empty()) {
+          return false;
+        }
+        const Set top = heap.top();
+        heap.pop();
+        // Position of the largest element of the set
+        size_t j = 0;
+        while (top.second >> (j + 1)) {
+          ++j;
+        }
+        if (j + 1 < k) {
+          // shift: replace the largest element j with j + 1
+          heap.push(std::make_pair(top.first - z[j] + z[j + 1],
+                                   (top.second ^ (1U << j)) | (1U << (j + 1))));
+          // expand: add element j + 1
+          heap.push(std::make_pair(top.first + z[j + 1],
+                                   top.second | (1U << (j + 1))));
+        }
+        // Map sorted positions back to the bits of the vertex
+        uint32_t mask{};
+        for (size_t i = 0; i <= j; ++i) {
+          if (top.second & (1U << i)) {
+            mask |= 1U << order[i];
+          }
+        }
+        probe = vertex ^ mask;
+        return true;
+      };
+  };
+  /**
+    \brief Sampling - how candidates are chosen from a probed vertex with
+      more points than the remaining candidates budget
+      - RANDOM_SAMPLING: uniform sample without replacement
+      - WINDOW_SAMPLING: a contiguous window at a random position of the
+        vertex, cheaper and cache friendly for large vertices
+  */
+  typedef enum Sampling {
+    RANDOM_SAMPLING,
+    WINDOW_SAMPLING
+  } Sampling;
+  /**
+    \brief CandidateSampler - samples m out of n positions in O(m) using a
+      sparse partial Fisher-Yates shuffle. Only the displaced positions are
+      stored, in an open addressing table that is reused between calls,
+      so no memory is allocated once the table has grown to the largest m.
+      Each thread uses its own sampler through Local().
+  */
+  class CandidateSampler {
+    private:
+      std::vector<uint32_t> keys;
+      std::vector<uint32_t> values;
+      std::vector<uint32_t> used;
+      uint32_t mask;
+      std::default_random_engine generator;
+
+      uint32_t Slot(const uint32_t key) const {
+        uint32_t slot = (key * 2654435761U) & mask;
+        while (keys[slot] != key && keys[slot] != kEmpty) {
+          slot = (slot + 1) & mask;
+        }
+        return slot;
+      };
+      uint32_t Get(const uint32_t key) const {
+        const uint32_t slot = Slot(key);
+        return keys[slot] == key ? values[slot] : key;
+      };
+      void Set(const uint32_t key, const uint32_t value) {
+        const uint32_t slot = Slot(key);
+        if (keys[slot] == kEmpty) {
+          keys[slot] = key;
+          used.push_back(slot);
+        }
+        values[slot] = value;
+      };
+    public:
+      static constexpr uint32_t kEmpty = 0xFFFFFFFF;
+
+      CandidateSampler() : mask(0),
+        generator(std::chrono::system_clock::now().time_since_epoch().count()) {};
+      /**
+        \brief Sampler of the calling thread
+      */
+      static CandidateSampler& Local(void) {
+        static thread_local CandidateSampler sampler;
+        return sampler;
+      };
+      /** \brief Visit m distinct positions of [0, n) chosen uniformly
+        @par Visit visit - called with each sampled position
+      */
+      template <typename Visit>
+      void Sample(const uint32_t n, const uint32_t m, Visit& visit) {
+        // Keep the load factor of the table below 1/2
+        if (keys.size() < 4 * (size_t) m) {
+          size_t capacity = 16;
+          while (capacity < 4 * (size_t) m) {
+            capacity <<= 1;
+          }
+          keys.assign(capacity, uint32_t(kEmpty));
+          values.resize(capacity);
+          used.reserve(capacity);
+          mask = capacity - 1;
+        }
+        for (uint32_t i = 0; i < m; ++i) {
+          std::uniform_int_distribution<uint32_t> position(i, n - 1);
+          const uint32_t j = position(generator);
+          const uint32_t value_j = Get(j);
+          Set(j, Get(i));
+          visit(value_j);
+        }
+        for (const auto& slot: used) {
+          keys[slot] = kEmpty;
+        }
+        used.clear();
+      };
+      /** \brief Visit a window of m consecutive positions of [0, n) starting
+        at a random position
+        @par Visit visit - called with each sampled position
+      */
+      template <typename Visit>
+      void Window(const uint32_t n, const uint32_t m, Visit& visit) {
+        std::uniform_int_distribution<uint32_t> position(0, n - m);
+        const uint32_t start = position(generator);
+        for (uint32_t i = start; i < start + m; ++i) {
+          visit(i);
+        }
+      };
+  };
+  /**
+    \brief CubeHash - how the bits of a vertex are computed
+      - AMPLIFIED_HASH: bit i is a random coin of g_i, an amplified hash
+        function of k h functions, i.e O(k^2 * D) per point
+      - PROJECTION_HASH: bit i is a hashed coin of the window of a single
+        random Cauchy projection, the k projections are computed in one
+        pass over the point, i.e O(k * D) per point. Cauchy is 1-stable,
+        so projected distances follow the L1 distances of the points
+  */
+  typedef enum CubeHash {
+    AMPLIFIED_HASH,
+    PROJECTION_HASH
+  } CubeHash;
+  /**
+    \brief Cube - the projection of N points of dimension D on the vertices
+      of a k-dimensional hypercube, shared by the vectors' and curves'
+      HyperCube. Vertex i is stored as the i_th bucket of a dense table
+      in CSR form: its points are ids[offsets[i]..offsets[i+1]). The table
+      is either owned or points into a mmapped snapshot.
+  */
+  template <typename T>
+  class Cube {
+    private:
+      uint16_t k;
+      uint16_t D;
+      uint32_t N;
+      uint32_t m;
+      uint32_t t;
+      double w;
+
+      CubeHash hash;
+      std::vector<hash::AmplifiedHashFunction<T>> g;
+      std::unordered_map<uint32_t, std::bitset<1>> bucket_map;
+      // PROJECTION_HASH: D x k projections, stored by coordinate so that all
+      // k dot products advance together, k shifts in [0,w) and the coin seed
+      std::vector<double> projections;
+      std::vector<double> projection_shifts;
+      uint64_t seed;
+
+      std::vector<uint32_t> offsets_storage;
+      std::vector<uint32_t> ids_storage;
+      const uint32_t* mapped_offsets;
+      const uint32_t* mapped_ids;
+      std::shared_ptr<const utils::snapshot::MappedFile> mapping;
+
+      std::default_random_engine generator;
+      std::uniform_int_distribution<int> f;
+
+      const uint32_t* Offsets(void) const {
+        return mapping ? mapped_offsets : offsets_storage.data();
+      };
+      const uint32_t* Ids(void) const {
+        return mapping ? mapped_ids : ids_storage.data();
+      };
+      /** \brief Hashed coin of window bucket of projection i, so that
+        no coins need to be stored
+      */
+      uint32_t HashCoin(const uint32_t i, const int64_t bucket) const {
+        uint64_t z = seed + (i + 1) * 0x9E3779B97F4A7C15ULL + (uint64_t) bucket;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return (z ^ (z >> 31)) & 1;
+      };
+      /** \brief PROJECTION_HASH vertex of a point, computing the k
+        projections in a single pass. Margins are returned if not null
+      */
+      uint32_t Project(const T *point, const size_t length,
+        double *margins) const {
+        double acc[32];
+        std::copy(projection_shifts.begin(), projection_shifts.end(), acc);
+        const double *projection = projections.data();
+        for (size_t d = 0; d < length; ++d, projection += k) {
+          const double x = point[d];
+          for (size_t i = 0; i < k; ++i) {
+            acc[i] += projection[i] * x;
+          }
+        }
+        uint32_t vertex{};
+        for (size_t i = 0; i < k; ++i) {
+          const double window = acc[i] / w;
+          const double bucket = std::floor(window);
+          if (margins != nullptr) {
+            const double frac = window - bucket;
+            margins[i] = std::min(frac, 1 - frac) * w;
+          }
+          vertex |= HashCoin(i, (int64_t) bucket) << i;
+        }
+        return vertex;
+      };
+    public:
+      /** \brief class Cube constructor
+        Select k amplified hash functions or k random projections and
+        project all points on the cube
+        @par const std::vector<T>& points - Pass by reference given points
+        @par const CubeHash hash - how the bits of a vertex are computed
+        @par const uint64_t random_seed - seed of all random choices, cubes
+          built at the same time must be given different seeds
+      */
+      Cube(const uint16_t k, const uint16_t D, const uint32_t N,
+        const double w, const std::vector<T>& points,
+        const CubeHash hash = AMPLIFIED_HASH,
+        const uint64_t random_seed =
+          std::chrono::system_clock::now().time_since_epoch().count()) :
+        Cube(k, N, w, utils::RaggedView<T>(points, D), hash, random_seed) {};
+      /** \brief class Cube constructor on variable length points, implicitly
+        padded to dimension D. Padding coordinates are skipped by the
+        projections of PROJECTION_HASH, i.e they count as 0.
+        throws std::invalid_argument unless 1 <= k <= 31
+      */
+      Cube(const uint16_t k, const uint32_t N, const double w,
+        const utils::RaggedView<T>& points, const CubeHash hash,
+        const uint64_t random_seed) :
+        k(k), D(points.GetD()), N(N), w(w), hash(hash), seed(0),
+        mapped_offsets(nullptr), mapped_ids(nullptr),
+        generator(random_seed), f(0,1) {
+
+        if (!ValidCubeDimensions(k)) {
+          throw std::invalid_argument("invalid number of cube dimensions");
+        }
+        m = (1ULL << 32) - 5;
+        t = 1ULL << (32 / k);
+        if (hash == PROJECTION_HASH) {
+          // 1) Randomly select k Cauchy projections and their shifts
+          std::cauchy_distribution<double> cauchy(0.0, 1.0);
+          std::uniform_real_distribution<double> shift(0.0, w);
+          projections.resize((size_t) D * k);
+          for (auto& p: projections) {
+            p = cauchy(generator);
+          }
+          projection_shifts.resize(k);
+          for (auto& s: projection_shifts) {
+            s = shift(generator);
+          }
+          seed = ((uint64_t) generator() << 32) ^ generator();
+        } else {
+          // 1) Randomly select k = logD amplified hash functions g1 , . . . , gL .
+          std::uniform_real_distribution<double> shift(0.0, w);
+          std::vector<double> shifts((size_t) k * D);
+          for (size_t i = 0; i < k; ++i) {
+            for (auto& s: shifts) {
+              s = shift(generator);
+            }
+            g.push_back(hash::AmplifiedHashFunction<T>(k,D,m,t,w,shifts.data()));
+          }
+        }
+        // 2) Map each point to its vertex
+        std::vector<uint32_t> vertices(N);
+        offsets_storage = std::vector<uint32_t>((1ULL << k) + 1);
+        for (size_t i = 0; i < N; ++i) {
+          vertices[i] = Vertex(points.Data(i),points.Length(i));
+          offsets_storage[vertices[i] + 1]++;
+        }
+        // 3) Store vertices as a dense table, i.e counting sort on vertices
+        for (size_t i = 0; i < (1ULL << k); ++i) {
+          offsets_storage[i + 1] += offsets_storage[i];
+        }
+        ids_storage = std::vector<uint32_t>(N);
+        std::vector<uint32_t> next(offsets_storage.begin(), offsets_storage.end() - 1);
+        for (size_t i = 0; i < N; ++i) {
+          ids_storage[next[vertices[i]]++] = i;
+        }
+      };
+      /** \brief class Cube constructor from a snapshot
+        Hash functions and coins are copied, the vertex table is used in place
+        @par utils::snapshot::Reader& reader - reader positioned at the cube
+      */
+      explicit Cube(utils::snapshot::Reader& reader) :
+        generator(std::chrono::system_clock::now().time_since_epoch().count()),
+        f(0,1) {
+
+        k = reader.Read<uint16_t>();
+        D = reader.Read<uint16_t>();
+        N = reader.Read<uint32_t>();
+        m = reader.Read<uint32_t>();
+        t = reader.Read<uint32_t>();
+        w = reader.Read<double>();
+        hash = (CubeHash) reader.Read<uint32_t>();
+        if (!ValidCubeDimensions(k)) {
+          throw std::runtime_error("invalid number of cube dimensions");
+        }
+        if (hash == PROJECTION_HASH) {
+          seed = reader.Read<uint64_t>();
+          const double *p = reader.ReadArray<double>((size_t) D * k);
+          projections.assign(p, p + (size_t) D * k);
+          const double *s = reader.ReadArray<double>(k);
+          projection_shifts.assign(s, s + k);
+        } else if (hash == AMPLIFIED_HASH) {
+          seed = 0;
+          const double *shifts = reader.ReadArray<double>((size_t) k * k * D);
+          for (size_t i = 0; i < k; ++i) {
+            g.push_back(hash::AmplifiedHashFunction<T>(k,D,m,t,w,
+                                                       shifts + i * k * D));
+          }
+          uint64_t no_coins = reader.Read<uint64_t>();
+          // keys are 32 bit and each coin takes a key and a value byte
+          if (no_coins > (1ULL << 32) ||
+              no_coins > reader.Remaining() / (sizeof(uint32_t) + 1)) {
+            throw std::runtime_error("invalid number of coins");
+          }
+          const uint32_t *coin_keys = reader.ReadArray<uint32_t>(no_coins);
+          const uint8_t *coin_values = reader.ReadArray<uint8_t>(no_coins);
+          bucket_map.reserve(no_coins);
+          for (size_t i = 0; i < no_coins; ++i) {
+            bucket_map[coin_keys[i]] = coin_values[i];
+          }
+        } else {
+          throw std::runtime_error("invalid cube hash");
+        }
+        mapped_offsets = reader.ReadArray<uint32_t>((1ULL << k) + 1);
+        mapped_ids = reader.ReadArray<uint32_t>(N);
+        // Buckets are used in place, so they must be a valid vertex table:
+        // offsets increasing from 0 to N and ids of points
+        if (mapped_offsets[0] != 0 || mapped_offsets[1ULL << k] != N) {
+          throw std::runtime_error("invalid vertex table");
+        }
+        for (size_t i = 0; i < (1ULL << k); ++i) {
+          if (mapped_offsets[i] > mapped_offsets[i + 1]) {
+            throw std::runtime_error("invalid vertex table");
+          }
+        }
+        for (size_t i = 0; i < N; ++i) {
+          if (mapped_ids[i] >= N) {
+            throw std::runtime_error("invalid vertex table");
+          }
+        }
+        mapping = reader.File();
+      };
+      explicit Cube(utils::snapshot::Reader&& reader) : Cube(reader) {};
+      /**
+        \brief class Cube default destructor
+      */
+      ~Cube() = default;
+      /** \brief Write hash functions or projections, coins and vertex table
+        @par utils::snapshot::Writer& writer - Pass by reference the writer
+      */
+      void Save(utils::snapshot::Writer& writer) const {
+        writer.Write(k);
+        writer.Write(D);
+        writer.Write(N);
+        writer.Write(m);
+        writer.Write(t);
+        writer.Write(w);
+        writer.Write((uint32_t) hash);
+        if (hash == PROJECTION_HASH) {
+          writer.Write(seed);
+          writer.WriteArray(projections.data(), projections.size());
+          writer.WriteArray(projection_shifts.data(), projection_shifts.size());
+        } else {
+          std::vector<double> shifts;
+          for (const auto& gi: g) {
+            for (const auto& h: gi.GetHashFunctions()) {
+              shifts.insert(shifts.end(), h.GetShifts().begin(), h.GetShifts().end());
+            }
+          }
+          writer.WriteArray(shifts.data(), shifts.size());
+          std::vector<uint32_t> coin_keys;
+          std::vector<uint8_t> coin_values;
+          for (const auto& coin: bucket_map) {
+            coin_keys.push_back(coin.first);
+            coin_values.push_back(coin.second.to_ulong());
+          }
+          writer.Write((uint64_t) coin_keys.size());
+          writer.WriteArray(coin_keys.data(), coin_keys.size());
+          writer.WriteArray(coin_values.data(), coin_values.size());
+        }
+        writer.WriteArray(Offsets(), (1ULL << k) + 1);
+        writer.WriteArray(Ids(), N);
+      };
+      /** \brief Project point on the cube, bit i of the vertex is fi(gi)
+        @par const std::vector<T>& points - Pass by reference points
+        @par const int offset - Offset to get correspodent point
+      */
+      uint32_t Vertex(const std::vector<T>& points, const int offset) {
+        return Vertex(&points[(size_t) offset * D], D);
+      };
+      /** \brief Project the first length coordinates of a point on the cube,
+        the rest D - length coordinates are padding
+      */
+      uint32_t Vertex(const T *point, const size_t length) {
+        if (hash == PROJECTION_HASH) {
+          return Project(point, length, nullptr);
+        }
+        uint32_t vertex{};
+        for (size_t i = 0; i < k; ++i) {
+          vertex |= FlipCoin(g[i].Hash(point,length)) << i;
+        }
+        return vertex;
+      };
+      /** \brief Project point on the cube as above and also compute
+        the margin of each bit
+        @par double *margins - k margins to be returned
+      */
+      uint32_t Vertex(const std::vector<T>& points, const int offset,
+        double *margins) {
+        return Vertex(&points[(size_t) offset * D], D, margins);
+      };
+      uint32_t Vertex(const T *point, const size_t length, double *margins) {
+        if (hash == PROJECTION_HASH) {
+          return Project(point, length, margins);
+        }
+        uint32_t vertex{};
+        for (size_t i = 0; i < k; ++i) {
+          vertex |= FlipCoin(g[i].Hash(point,length,margins[i])) << i;
+        }
+        return vertex;
+      };
+      /**
+        \brief Return the begin and end pointers to the points of a vertex
+      */
+      std::pair<const uint32_t*, const uint32_t*> Bucket(const uint32_t vertex) const {
+        const uint32_t *offsets = Offsets();
+        return std::make_pair(Ids() + offsets[vertex], Ids() + offsets[vertex + 1]);
+      };
+      /** \brief For each gi,
+       - fi(gi) maps buckets to {0,1} uniformly.
+       returns the coin of the given bucket
+      */
+      uint32_t FlipCoin(uint32_t key) {
+        auto coin = bucket_map.find(key);
+        if (coin == bucket_map.end()) {
+          coin = bucket_map.emplace(key, f(generator)).first;
+        }
+        return coin->second.to_ulong();
+      };
+      /** \brief Visit the candidates of a query.
+        All points of the query's vertex are visited. Then vertices are
+        probed in the given order until either probes vertices or
+        M candidates have been checked.
+        @par const T *point - the coordinates of the query point
+        @par const size_t length - number of coordinates, the rest are padding
+        @par const ProbeOrder order - order of the probed vertices
+        @par const uint8_t probes - max number of vertices to be probed
+        @par const uint16_t M - max number of candidates of probed vertices
+        @par const Sampling sampling - how candidates are chosen from vertices
+          with more points than the remaining candidates
+        @par Visit visit - called with the offset of each candidate point
+        @par Counters - policy counting the probed vertices and their sizes
+      */
+      template <typename Counters = utils::counters::None, typename Visit>
+      void Search(const T *point, const size_t length,
+        const ProbeOrder order, const uint8_t probes, const uint16_t M,
+        const Sampling sampling, Visit visit) {
+
+        if (order == MARGIN_ORDER) {
+          double margins[32];
+          const uint32_t vertex = Vertex(point, length, margins);
+          MarginProbes generator(vertex, k, margins);
+          Probe<Counters>(vertex, generator, probes, M, sampling, visit);
+        } else {
+          const uint32_t vertex = Vertex(point, length);
+          HammingBall generator(vertex, k);
+          Probe<Counters>(vertex, generator, probes, M, sampling, visit);
+        }
+      };
+      /** \brief Visit the points of vertex and of the vertices
+        produced by generator, as described above
+      */
+      template <typename Counters, typename Generator, typename Visit>
+      void Probe(const uint32_t vertex, Generator& generator,
+        const uint8_t probes, const uint16_t M, const Sampling sampling,
+        Visit& visit) {
+
+        // Checking for neighbor in same vertex
+        auto bucket = Bucket(vertex);
+        Counters::Add(utils::counters::BUCKETS_PROBED);
+        Counters::Add(utils::counters::BUCKET_SIZES, bucket.second - bucket.first);
+        for (auto it = bucket.first; it != bucket.second; ++it) {
+          visit(*it);
+        }
+        // Walk the neighbor vertices in the order of the generator
+        uint32_t probe;
+        size_t checked = 0;
+        for (size_t i = 0; i < probes && checked < M && generator.Next(probe); ++i) {
+          auto bucket = Bucket(probe);
+          const uint32_t *points = bucket.first;
+          const uint32_t num_points = bucket.second - bucket.first;
+          const uint32_t max_points = std::min<size_t>(num_points, M - checked);
+          Counters::Add(utils::counters::BUCKETS_PROBED);
+          Counters::Add(utils::counters::BUCKET_SIZES, num_points);
+          auto visit_position = [&](const uint32_t j) { visit(points[j]); };
+          // Choose randomly points from vertex while candidates remain
+          if (max_points == num_points) {
+            for (uint32_t j = 0; j < num_points; ++j) {
+              visit(points[j]);
+            }
+          } else if (sampling == WINDOW_SAMPLING) {
+            CandidateSampler::Local().Window(num_points, max_points, visit_position);
+          } else {
+            CandidateSampler::Local().Sample(num_points, max_points, visit_position);
+          }
+          checked += max_points;
+        }
+      };
+      uint16_t GetK(void) const { return k; };
+      uint16_t GetD(void) const { return D; };
+      uint32_t GetN(void) const { return N; };
+  };
+  /**
+    \brief VisitedSet - set of point offsets visited by a query, cleared
+      in O(1) by advancing an epoch. Each thread uses its own set through
+      Local().
+  */
+  class VisitedSet {
+    private:
+      std::vector<uint32_t> stamps;
+      uint32_t epoch;
+    public:
+      VisitedSet() : epoch(0) {};
+      /**
+        \brief Set of the calling thread
+      */
+      static VisitedSet& Local(void) {
+        static thread_local VisitedSet visited;
+        return visited;
+      };
+      /**
+        \brief Start a new query over offsets [0, n)
+      */
+      void Reset(const uint32_t n) {
+        if (stamps.size() < n) {
+          stamps.resize(n, 0);
+        }
+        if (++epoch == 0) {
+          std::fill(stamps.begin(), stamps.end(), 0);
+          epoch = 1;
+        }
+      };
+      /**
+        \brief returns: true if offset had not been visited since Reset
+      */
+      bool Insert(const uint32_t offset) {
+        if (stamps[offset] == epoch) {
+          return false;
+        }
+        stamps[offset] = epoch;
+        return true;
+      };
+  };
+  /**
+    \brief CubeSet - L independent cubes over the same points. A query
+      probes every cube, the probes and candidates budget is split among
+      them and every point is visited at most once.
+  */
+  template <typename T>
+  class CubeSet {
+    private:
+      std::vector<std::shared_ptr<Cube<T>>> cubes;
+    public:
+      /** \brief class CubeSet constructor, the cubes are built in parallel
+        @par const uint8_t L - number of cubes
+        rest of parameters as in Cube
+        throws std::invalid_argument unless 1 <= k <= 31, before any
+        cube is built by the threads
+      */
+      CubeSet(const uint8_t L, const uint16_t k, const uint32_t N,
+        const double w, const utils::RaggedView<T>& points,
+        const CubeHash hash = AMPLIFIED_HASH) : cubes(std::max<uint8_t>(L, 1)) {
+
+        if (!ValidCubeDimensions(k)) {
+          throw std::invalid_argument("invalid number of cube dimensions");
+        }
+        const uint64_t seed = std::chrono::system_clock::now().time_since_epoch().count();
+        utils::parallel::ParallelFor(cubes.size(), 1, [&](const size_t l) {
+          cubes[l] = std::make_shared<Cube<T>>(k, N, w, points, hash,
+                                               seed + l * 0x9E3779B97F4A7C15ULL);
+        });
+      };
+      /** \brief class CubeSet constructor from a snapshot
+        @par utils::snapshot::Reader& reader - reader positioned at the cubes
+      */
+      explicit CubeSet(utils::snapshot::Reader& reader) {
+        const uint32_t L = reader.Read<uint32_t>();
+        if (L == 0 || L > 255) {
+          throw std::runtime_error("invalid number of cubes");
+        }
+        for (size_t l = 0; l < L; ++l) {
+          cubes.push_back(std::make_shared<Cube<T>>(reader));
+          if (cubes[l]->GetN() != cubes[0]->GetN() ||
+              cubes[l]->GetD() != cubes[0]->GetD()) {
+            throw std::runtime_error("cubes of different points");
+          }
+        }
+      };
+      explicit CubeSet(utils::snapshot::Reader&& reader) : CubeSet(reader) {};
+      /**
+        \brief class CubeSet default destructor
+      */
+      ~CubeSet() = default;
+      /** \brief Write the number of cubes followed by each cube
+        @par utils::snapshot::Writer& writer - Pass by reference the writer
+      */
+      void Save(utils::snapshot::Writer& writer) const {
+        writer.Write((uint32_t) cubes.size());
+        for (const auto& cube: cubes) {
+          cube->Save(writer);
+        }
+      };
+      /** \brief Visit the candidates of a query in every cube. Cube l gets
+        its share of probes and M, its own vertex is always fully visited.
+        Parameters as in Cube::Search
+      */
+      template <typename Counters = utils::counters::None, typename Visit>
+      void Search(const std::vector<T>& points, const int offset,
+        const ProbeOrder order, const uint8_t probes, const uint16_t M,
+        const Sampling sampling, Visit visit) {
+        Search<Counters>(&points[(size_t) offset * GetD()], GetD(), order, probes, M,
+               sampling, visit);
+      };
+      template <typename Counters = utils::counters::None, typename Visit>
+      void Search(const T *point, const size_t length,
+        const ProbeOrder order, const uint8_t probes, const uint16_t M,
+        const Sampling sampling, Visit visit) {
+
+        if (cubes.size() == 1) {
+          cubes[0]->template Search<Counters>(point, length, order, probes, M, sampling, visit);
+          return;
+        }
+        const size_t L = cubes.size();
+        VisitedSet& visited = VisitedSet::Local();
+        visited.Reset(GetN());
+        auto visit_once = [&](const uint32_t point) {
+          if (visited.Insert(point)) {
+            visit(point);
+          }
+        };
+        for (size_t l = 0; l < L; ++l) {
+          const uint8_t probes_l = probes / L + (l < probes % L);
+          const uint16_t M_l = M / L + (l < M % L);
+          cubes[l]->template Search<Counters>(point, length, order, probes_l, M_l, sampling, visit_once);
+        }
+      };
+      uint8_t GetL(void) const { return cubes.size(); };
+      uint16_t GetK(void) const { return cubes[0]->GetK(); };
+      uint16_t GetD(void) const { return cubes[0]->GetD(); };
+      uint32_t GetN(void) const { return cubes[0]->GetN(); };
+  };
+  /** \brief Checksum of the coordinates of N points, so that a snapshot
+    is only loaded for the points it was built on
+  */
+  template <typename T>
+  uint64_t PointsChecksum(const utils::RaggedView<T>& points, const uint32_t N) {
+    uint64_t checksum = utils::snapshot::Checksum(nullptr, 0);
+    for (size_t i = 0; i < N; ++i) {
+      const uint32_t length = points.Length(i);
+      checksum = utils::snapshot::Checksum(&length, sizeof(length), checksum);
+      checksum = utils::snapshot::Checksum(points.Data(i), length * sizeof(T),
+                                           checksum);
+    }
+    return checksum;
+  }
+  /** \brief Open a HyperCube snapshot and check its header
+    @par const std::string& file_name - Path to the snapshot
+    @par uint64_t& seed - returns the seed the points were computed with
+    @par uint32_t& count - returns the number of cube sets in the snapshot
+    throws std::runtime_error if file is not a valid snapshot
+  */
+  inline utils::snapshot::Reader OpenHyperCubeSnapshot(const std::string& file_name,
+    uint64_t& seed, uint32_t& count) {
+
+    utils::snapshot::Reader reader(
+      std::make_shared<const utils::snapshot::MappedFile>(file_name));
+    reader.Expect(kHyperCubeMagic);
+    if (reader.Read<uint32_t>() != kHyperCubeVersion) {
+      throw std::runtime_error("unsupported snapshot version");
+    }
+    seed = reader.Read<uint64_t>();
+    count = reader.Read<uint32_t>();
+    return reader;
+  }
+  /** \brief Write the header of a HyperCube snapshot
+    @par const uint64_t seed - seed the points were computed with, e.g the
+      seed of the vectorization of curves, 0 if they are read as is
+    @par const uint32_t count - number of cube sets to be written
+  */
+  inline void WriteHyperCubeHeader(utils::snapshot::Writer& writer,
+    const uint64_t seed, const uint32_t count) {
+    writer.WriteMagic(kHyperCubeMagic);
+    writer.Write(kHyperCubeVersion);
+    writer.Write(seed);
+    writer.Write(count);
+  }
+  /** \brief Read the next cube set of a snapshot, which must have been
+    built on the given points
+    @par const utils::RaggedView<T>& points - points the cubes were built on
+    @par const uint32_t N - number of points
+    throws std::runtime_error if it is not a valid cube set of the points
+  */
+  template <typename T>
+  CubeSet<T> ReadCubeSet(utils::snapshot::Reader& reader,
+    const utils::RaggedView<T>& points, const uint32_t N) {
+    // Fingerprint of the points: N, D and checksum of the coordinates
+    if (reader.Read<uint32_t>() != N ||
+        reader.Read<uint32_t>() != points.GetD() ||
+        reader.Read<uint64_t>() != PointsChecksum(points, N)) {
+      throw std::runtime_error("snapshot does not match the dataset");
+    }
+    CubeSet<T> cubes(reader);
+    if (cubes.GetN() != N || cubes.GetD() != points.GetD()) {
+      throw std::runtime_error("snapshot does not match the dataset");
+    }
+    return cubes;
+  }
+  /** \brief Write a cube set and the fingerprint of its points
+  */
+  template <typename T>
+  void WriteCubeSet(utils::snapshot::Writer& writer, const CubeSet<T>& cubes,
+    const utils::RaggedView<T>& points) {
+    writer.Write(cubes.GetN());
+    writer.Write(points.GetD());
+    writer.Write(PointsChecksum(points, cubes.GetN()));
+    cubes.Save(writer);
+  }
+
   namespace vectors {
     /**
       \brief HyperCube class for vectors
     */
-    template <typename T, typename U>
+    template <typename T, typename U,
+              typename Counters = utils::SearchCounters,
+              typename Timing = utils::QueryTiming>
     class HyperCube {
       private:
-        uint32_t m;
-        uint32_t t;
-        double w;
-
-        const uint16_t k;
         const uint16_t M;
-        const uint16_t D;
-        const uint32_t N;
         const uint8_t probes;
-        const double R;
+        const ProbeOrder order;
+        const Sampling sampling;
 
         const std::vector<T>& feature_vector;
         const std::vector<U>& feature_vector_ids;
 
-        std::vector<hash::AmplifiedHashFunction<T>> g;
-        std::unordered_map<uint32_t, std::bitset<1>> bucket_map;
-
-        std::unordered_map<std::string, std::vector<int>> p;
-        std::default_random_engine generator;
-        std::uniform_int_distribution<int> f;
+        CubeSet<T> cube;
+        const uint16_t k;
+        const uint16_t D;
+        const uint32_t N;
 
+        /**
+          \brief The cube set of a snapshot written by Save
+        */
+        static CubeSet<T> Load(const std::string& snapshot_file,
+          const utils::RaggedView<T>& points, const uint32_t N) {
+          uint64_t seed;
+          uint32_t count;
+          utils::snapshot::Reader reader =
+            OpenHyperCubeSnapshot(snapshot_file, seed, count);
+          if (count != 1) {
+            throw std::runtime_error("snapshot does not match the dataset");
+          }
+          return ReadCubeSet(reader, points, N);
+        };
       public:
         /**
           \brief class HyperCube constructor
+          @par const double window - window size as a multiple of r
     		*/
     		HyperCube(const uint16_t k, const uint16_t M, const uint16_t D,
           const uint32_t N, const uint8_t probes, const double r,
-          const std::vector<T>& points, const std::vector<T>& ids) :
-          generator(std::chrono::system_clock::now().time_since_epoch().count()),
-          f(0,1), k(k), M(M), D(D), N(N), probes(probes), R(r),
-          feature_vector(points), feature_vector_ids(ids) {
-
-    			w = 5 * r;
-    			m = (1ULL << 32) - 5;
-    			t = 1ULL << (32 / k);
-
-    			// Preprocess step
-    			// 1) Randomly select k = logD amplified hash functions g1 , . . . , gL .
-    			for (size_t i = 0; i < k; ++i) {
-    				g.push_back(hash::AmplifiedHashFunction<T>(k,D,m,t,w));
-    			}
-
-    			for (size_t i = 0; i < N; ++i) {
-    				std::string str;
-    				for (size_t j = 0; j < k; ++j) {
-    					uint32_t key = g[j].Hash(feature_vector,i);
-    					//project points in a cube
-    					FlipCoin(key);
-    					str += bucket_map[key].to_string();
-    				}
-    				p[str].push_back(i);
-    			}
-    		};
+          const std::vector<T>& points, const std::vector<T>& ids,
+          const ProbeOrder order = HAMMING_ORDER,
+          const Sampling sampling = RANDOM_SAMPLING,
+          const CubeHash hash = AMPLIFIED_HASH, const uint8_t L = 1,
+          const double window = 5) :
+          M(M), probes(probes), order(order), sampling(sampling),
+          feature_vector(points), feature_vector_ids(ids),
+          cube(L, k, N, window * r, utils::RaggedView<T>(points, D), hash), k(k), D(D), N(N) {
+          Timing::Calibrate();
+        };
+        /** \brief class HyperCube constructor from a snapshot
+          written by Save. Throws std::runtime_error if the snapshot
+          can not be used with the given points.
+          @par const std::string& snapshot_file - Path to the snapshot
+        */
+        HyperCube(const std::string& snapshot_file, const uint16_t M,
+          const uint8_t probes, const std::vector<T>& points,
+          const std::vector<U>& ids, const ProbeOrder order = HAMMING_ORDER,
+          const Sampling sampling = RANDOM_SAMPLING) :
+          M(M), probes(probes), order(order), sampling(sampling),
+          feature_vector(points), feature_vector_ids(ids),
+          cube(Load(snapshot_file, utils::RaggedView<T>(points,
+                 ids.empty() ? 0 : points.size() / ids.size()), ids.size())),
+          k(cube.GetK()), D(cube.GetD()), N(cube.GetN()) {
+
+          if ((size_t) N * D != points.size()) {
+            throw std::runtime_error("snapshot does not match the dataset");
+          }
+          Timing::Calibrate();
+        };
 
         /**
           \brief class HyperCube default destructor
         */
         ~HyperCube() = default;
 
+        /** \brief Persist the cube so that it can be reloaded without
+          rehashing the dataset. Throws std::runtime_error on I/O failure
+          @par const std::string& snapshot_file - Path to the snapshot
+        */
+        void Save(const std::string& snapshot_file) const {
+          utils::snapshot::Writer writer(snapshot_file);
+          WriteHyperCubeHeader(writer, 0, 1);
+          WriteCubeSet(writer, cube, utils::RaggedView<T>(feature_vector, D));
+          writer.Close();
+        };
+
         /** \brief Executes approximate Nearest tNeighbor
           @par const std::vector<T>& query_points - Pass by reference query points
           @par const int offset - Offset to get correspodent point
@@ -99,19 +985,15 @@ namespace search {
         std::tuple<T,U,double> NearestNeighbor(const std::vector<T>& query_points,
           const int offset) {
 
-          auto start = high_resolution_clock::now();
+          const typename Timing::Stamp start = Timing::Start();
           T min_dist = std::numeric_limits<T>::max();
           U min_id{};
-          std::string key;
-          // Get value from g function
-          for (size_t i = 0; i < k; ++i) {
-            uint32_t val = g[i].Hash(query_points,offset);
-            FlipCoin(val);
-            key += bucket_map[val].to_string();
-          }
-          //Checking for neighbor in same vertex
-          std::vector<int>& vertex = p[key];
-          for (auto const& fv_offset: vertex) {
+          Counters::Add(utils::counters::QUERIES);
+          // Search query's vertex and its neighbors
+          cube.template Search<Counters>(query_points, offset, order, probes,
+                                         M, sampling, [&](const uint32_t fv_offset) {
+            Counters::Add(utils::counters::CANDIDATES);
+            Counters::Add(utils::counters::DISTANCES);
             T dist = metric::ManhattanDistance<T>(
               std::next(feature_vector.begin(), fv_offset * D),
               std::next(query_points.begin(), offset * D),
@@ -121,43 +1003,10 @@ namespace search {
               min_dist = dist;
               min_id = feature_vector_ids[fv_offset];
             }
-          }
+          });
 
-          // Get "probes" random vertices with hamming distance 1
-          std::vector<std::string> vertices = GetToggledBitStrings(key);
-          size_t num_vertices = vertices.size();
-          std::vector<size_t> idx = VectorShuffle(num_vertices);
-          size_t max_vertices = (num_vertices < probes) ? num_vertices : probes;
-
-          // For each key map to its bucket and search
-          for (size_t i = 0; i < max_vertices; ++i) {
-            const std::string key = vertices[idx[i]];
-            // Get a specific vertex
-            std::vector<int>& vertex = p[key];
-            size_t num_points = vertex.size();
-            // Choose randomly M points from vertex
-            std::vector<size_t> points = VectorShuffle(num_points);
-            size_t max_points = (num_points < M) ? num_points : M;
-            // Calculate manhattan distance between those points and queries
-            for (size_t j = 0; j < max_points; ++j) {
-              int fv_offset = vertex[points[j]];
-              T dist = metric::ManhattanDistance<T>(
-                std::next(feature_vector.begin(), fv_offset * D),
-                std::next(query_points.begin(), offset * D),
-                std::next(query_points.begin(), offset * D + D)
-              );
-              if (dist < min_dist) {
-                min_dist = dist;
-                min_id = feature_vector_ids[fv_offset];
-              }
-            }
-          }
-
-          auto stop = high_resolution_clock::now();
-          duration <double> total_time = duration_cast<duration<double>>(stop - start);
-
-          // Return result as a tuple of min_dist, min_id and total_time
-          return std::make_tuple(min_dist,min_id,total_time.count());
+          // Return result as a tuple of min_dist, min_id and seconds taken
+          return std::make_tuple(min_dist,min_id,Timing::Stop(start));
         };
 
         /** \brief Executes approximate Radius Nearest tNeighbor
@@ -169,139 +1018,91 @@ namespace search {
           const int radius) {
 
           std::vector<std::pair<T,U>> result;
-          auto start = high_resolution_clock::now();
-          T min_dist = std::numeric_limits<T>::max();
-          U min_id{};
-          std::string key;
-          // Get value from g function
-          for (size_t i = 0; i < k; ++i) {
-            uint32_t val = g[i].Hash(query_points,offset);
-            FlipCoin(val);
-            key += bucket_map[val].to_string();
-          }
-          // Checking for neighbor in same vertex
-          std::vector<int>& vertex = p[key];
-          for (auto const& fv_offset: vertex) {
+          // Search query's vertex and its neighbors
+          cube.Search(query_points, offset, order, probes, M, sampling,
+                      [&](const uint32_t fv_offset) {
             T dist = metric::ManhattanDistance<T>(
               std::next(feature_vector.begin(), fv_offset * D),
               std::next(query_points.begin(), offset * D),
               std::next(query_points.begin(), offset * D + D)
             );
-            if (dist < min_dist) {
-              min_dist = dist;
-              min_id = feature_vector_ids[fv_offset];
-            }
             if (dist <= radius) {
               result.push_back(std::make_pair(dist,feature_vector_ids[fv_offset]));
             }
-          }
-
-          // Get "probes" random vertices with hamming distance 1
-          std::vector<std::string> vertices = GetToggledBitStrings(key);
-          size_t num_vertices = vertices.size();
-          std::vector<size_t> idx = VectorShuffle(num_vertices);
-          size_t max_vertices = (num_vertices < probes) ? num_vertices : probes;
-
-          // For each key map to its bucket and search
-          for (size_t i = 0; i < max_vertices; ++i) {
-            const std::string key = vertices[idx[i]];
-            // Get a specific vertex
-            std::vector<int>& vertex = p[key];
-            size_t num_points = vertex.size();
-            // Choose randomly M points from vertex
-            std::vector<size_t> points = VectorShuffle(num_points);
-            size_t max_points = (num_points < M) ? num_points : M;
-            // Calculate manhattan distance between those points and queries
-            for (size_t j = 0; j < max_points; ++j) {
-              int fv_offset = vertex[points[j]];
-              T dist = metric::ManhattanDistance<T>(
-                std::next(feature_vector.begin(), fv_offset * D),
-                std::next(query_points.begin(), offset * D),
-                std::next(query_points.begin(), offset * D + D)
-              );
-              if (dist < min_dist) {
-                min_dist = dist;
-                min_id = feature_vector_ids[fv_offset];
-              }
-              if (dist <= radius) {
-                result.push_back(std::make_pair(dist,feature_vector_ids[fv_offset]));
-              }
-            }
-          }
-
-          auto stop = high_resolution_clock::now();
-          duration <double> total_time = duration_cast<duration<double>>(stop - start);
-          // Return result as a tuple of min_dist, min_id and total_time
-          return result;
-        };
-    		/** \brief For each gi,
-    		 - fi(gi) maps buckets to {0,1} uniformly.
-    		*/
-    		void FlipCoin(uint32_t key) {
-    			if (bucket_map.find(key) == bucket_map.end()) {
-    				bucket_map[key] = f(generator);
-    			}
-    		};
-        /**
-          \brief Given a string return all strings with hamming distance 1
-        */
-        std::vector<std::string> GetToggledBitStrings(const std::string& key) {
-          /* Initialize the vector to be returned */
-          std::vector<std::string> result;
-          /* Toggle each char of the key string to take the one
-            with hamming distance 1 */
-          for (size_t i = 0; i < key.length(); ++i) {
-            std::string temp = key;
-            temp[i] = (key[0] == '1') ? 0 : 1;
-            result.push_back(temp);
-          }
+          });
           return result;
         };
-        /**
-          \brief Given an input n create a vector with number from 1 to n in
-            random order
-        */
-        std::vector<size_t> VectorShuffle(const size_t n) {
-          std::vector<size_t> idx;
-          for (size_t i = 0; i < n; ++i) {
-            idx.push_back(i);
-          }
-          std::random_shuffle(idx.begin(), idx.end());
-          return idx;
-        };
     };
   }
   namespace curves {
     /**
       \brief HyperCube class for curves
     */
-    template <typename T, typename U>
+    template <typename T, typename U,
+              typename Counters = utils::SearchCounters>
     class HyperCube {
       private:
-        uint32_t m;
-        uint32_t t;
-        double w;
+        const uint16_t M;
+        const uint8_t probes;
+        const ProbeOrder order;
+        const Sampling sampling;
+
+        const std::vector<std::pair<T,T>>& input_curves;
+        const utils::Span<U> input_curves_ids;
+        const utils::Span<int> input_curves_lengths;
+        const utils::Span<int> input_curves_offsets;
+        const utils::RaggedView<T> input_vectors;
 
+        CubeSet<T> cube;
         const uint16_t k;
-        const uint16_t M;
         const uint16_t D;
         const uint32_t N;
-        const uint8_t probes;
-        const double R;
 
-        const std::vector<double> &feature_vector;
-        const std::vector<std::pair<T,T>>& input_curves;
-        const std::vector<U> &input_curves_ids;
-        const std::vector<int>& input_curves_lengths;
-        const std::vector<int>& input_curves_offsets;
+        /** \brief Visit the offsets of the candidate curves of the query
+          vector given its first length coordinates
+          @par const bool wrap - map candidate offsets modulo the number of curves
+        */
+        template <typename Visit>
+        void Candidates(const T *query, const size_t length, const bool wrap,
+          Visit visit) {
 
-        std::vector<hash::AmplifiedHashFunction<T>> g;
-        std::unordered_map<uint32_t, std::bitset<1>> bucket_map;
+          // Search query's vertex and its neighbors
+          cube.template Search<Counters>(query, length, order, probes, M,
+                                         sampling, [&](const uint32_t fv_offset) {
+            Counters::Add(utils::counters::CANDIDATES);
+            visit(wrap ? fv_offset % input_curves_lengths.size() : fv_offset);
+          });
+        };
+        /** \brief Executes approximate Nearest tNeighbor of the query vector
+          given its first length coordinates
+          @par const bool wrap - map candidate offsets modulo the number of curves
+        */
+        std::pair<T,U> NearestNeighbor(const T *query, const size_t length,
+          const int offset, const std::vector<std::pair<T,T>>& query_curves,
+          const std::vector<int>& query_curves_lengths,
+          const std::vector<int>& query_curves_offsets, const bool wrap) {
 
-        std::unordered_map<std::string, std::vector<int>> p;
-        std::default_random_engine generator;
-        std::uniform_int_distribution<int> f;
+          T min_dist = std::numeric_limits<T>::max();
+          U min_id{};
+          Counters::Add(utils::counters::QUERIES);
+          Candidates(query, length, wrap, [&](const uint32_t of) {
+            Counters::Add(utils::counters::DISTANCES);
+            T dist =  metric::DTWDistance<T>(
+              std::next(input_curves.begin(),input_curves_offsets[of]),
+              std::next(input_curves.begin(),
+                        input_curves_offsets[of] + input_curves_lengths[of]),
+              std::next(query_curves.begin(),query_curves_offsets[offset]),
+              std::next(query_curves.begin(),
+                        query_curves_offsets[offset] + query_curves_lengths[offset]));
+            if (dist < min_dist) {
+              min_dist = dist;
+              min_id = input_curves_ids[of];
+            }
+          });
 
+          // Return result as a pair of min_dist and min_id
+          return std::make_pair(min_dist,min_id);
+        };
       public:
         /**
           \brief class HyperCube constructor
@@ -309,40 +1110,65 @@ namespace search {
     		HyperCube(const uint16_t k, const uint16_t M, const uint16_t D,
           const uint32_t N, const uint8_t probes, const double r,
           const std::vector<std::pair<T,T>>& curves,
-          const std::vector<U> &ids, const std::vector<int>& lengths,
-          const std::vector<int>& offsets, const std::vector<T> &points) :
-          generator(std::chrono::system_clock::now().time_since_epoch().count()),
-          f(0,1), k(k), M(M), D(D), N(N), probes(probes), R(r),
+          const utils::Span<U>& ids, const utils::Span<int>& lengths,
+          const utils::Span<int>& offsets, const std::vector<T> &points,
+          const ProbeOrder order = HAMMING_ORDER,
+          const Sampling sampling = RANDOM_SAMPLING,
+          const CubeHash hash = AMPLIFIED_HASH, const uint8_t L = 1) :
+          HyperCube(k, M, N, probes, r, curves, ids, lengths, offsets,
+                    utils::RaggedView<T>(points, D), order, sampling, hash, L) {};
+        /**
+          \brief class HyperCube constructor on variable length vectors, e.g
+            grid curves, implicitly padded to dimension D
+        */
+        HyperCube(const uint16_t k, const uint16_t M, const uint32_t N,
+          const uint8_t probes, const double r,
+          const std::vector<std::pair<T,T>>& curves,
+          const utils::Span<U>& ids, const utils::Span<int>& lengths,
+          const utils::Span<int>& offsets, const utils::RaggedView<T>& points,
+          const ProbeOrder order = HAMMING_ORDER,
+          const Sampling sampling = RANDOM_SAMPLING,
+          const CubeHash hash = AMPLIFIED_HASH, const uint8_t L = 1) :
+          M(M), probes(probes), order(order), sampling(sampling),
           input_curves(curves), input_curves_ids(ids),
           input_curves_lengths(lengths), input_curves_offsets(offsets),
-          feature_vector(points) {
-
-    			w = 10 * R;
-    			m = (1ULL << 32) - 5;
-    			t = 1ULL << (32 / k);
-
-    			// Preprocess step
-    			// 1) Randomly select k = logD amplified hash functions g1 , . . . , gL .
-    			for (size_t i = 0; i < k; ++i) {
-    				g.push_back(hash::AmplifiedHashFunction<T>(k,D,m,t,w));
-    			}
-
-    			for (size_t i = 0; i < N; ++i) {
-    				std::string str;
-    				for (size_t j = 0; j < k; ++j) {
-    					uint32_t key = g[j].Hash(feature_vector,i);
-    					//project points in a cube
-    					FlipCoin(key);
-    					str += bucket_map[key].to_string();
-    				}
-    				p[str].push_back(i);
-    			}
-    		};
+          input_vectors(points), cube(L, k, N, 10 * r, points, hash),
+          k(k), D(points.GetD()), N(N) {};
+        /** \brief class HyperCube constructor from the next cube set of a
+          snapshot written by Save, on either dense or variable length
+          vectors. Throws std::runtime_error if the cube set was not built
+          on the given vectors.
+          @par utils::snapshot::Reader& reader - reader of a snapshot opened
+            by OpenHyperCubeSnapshot
+        */
+        HyperCube(utils::snapshot::Reader& reader, const uint16_t M,
+          const uint32_t N, const uint8_t probes,
+          const std::vector<std::pair<T,T>>& curves,
+          const utils::Span<U>& ids, const utils::Span<int>& lengths,
+          const utils::Span<int>& offsets, const utils::RaggedView<T>& points,
+          const ProbeOrder order = HAMMING_ORDER,
+          const Sampling sampling = RANDOM_SAMPLING) :
+          M(M), probes(probes), order(order), sampling(sampling),
+          input_curves(curves), input_curves_ids(ids),
+          input_curves_lengths(lengths), input_curves_offsets(offsets),
+          input_vectors(points),
+          cube(ReadCubeSet(reader, points, N)),
+          k(cube.GetK()), D(cube.GetD()), N(cube.GetN()) {};
 
         /**
           \brief class HyperCube default destructor
         */
         ~HyperCube() = default;
+
+        /** \brief Persist the cube so that it can be reloaded without
+          rehashing the vectors. Several HyperCubes are written to the same
+          snapshot after WriteHyperCubeHeader.
+          Throws std::runtime_error on I/O failure
+          @par utils::snapshot::Writer& writer - Pass by reference the writer
+        */
+        void Save(utils::snapshot::Writer& writer) const {
+          WriteCubeSet(writer, cube, input_vectors);
+        };
         /** \brief Executes approximate Nearest tNeighbor
           @par const std::vector<T>& query_points - Pass by reference query points
           @par const int offset - Offset to get correspodent point
@@ -351,169 +1177,58 @@ namespace search {
           const int offset, const std::vector<std::pair<T,T>>& query_curves,
           const std::vector<int>& query_curves_lengths,
           const std::vector<int>& query_curves_offsets) {
-
-          T min_dist = std::numeric_limits<T>::max();
-          U min_id{};
-          std::string key;
-          // Get value from g function
-          for (size_t i = 0; i < k; ++i) {
-            uint32_t val = g[i].Hash(query_points,offset);
-            FlipCoin(val);
-            key += bucket_map[val].to_string();
-          }
-          //Checking for neighbor in same vertex
-          std::vector<int>& vertex = p[key];
-          for (auto const& fv_offset: vertex) {
-            T dist =  metric::DTWDistance<T>(
-              std::next(input_curves.begin(),input_curves_offsets[fv_offset]),
-              std::next(input_curves.begin(),
-                        input_curves_offsets[fv_offset] + input_curves_lengths[fv_offset]),
-              std::next(query_curves.begin(),query_curves_offsets[offset]),
-              std::next(query_curves.begin(),
-                        query_curves_offsets[offset] + query_curves_lengths[offset]));
-            if (dist < min_dist) {
-              min_dist = dist;
-              min_id = input_curves_ids[fv_offset];
-            }
-          }
-
-          // Get "probes" random vertices with hamming distance 1
-          std::vector<std::string> vertices = GetToggledBitStrings(key);
-          size_t num_vertices = vertices.size();
-          std::vector<size_t> idx = VectorShuffle(num_vertices);
-          size_t max_vertices = (num_vertices < probes) ? num_vertices : probes;
-
-          // For each key map to its bucket and search
-          for (size_t i = 0; i < max_vertices; ++i) {
-            const std::string key = vertices[idx[i]];
-            //Get a specific vertex
-            std::vector<int>& vertex = p[key];
-            size_t num_points = vertex.size();
-            // Choose randomly M points from vertex
-            std::vector<size_t> points = VectorShuffle(num_points);
-            size_t max_points = (num_points < M) ? num_points : M;
-            // Calculate manhattan distance between those points and queries
-            for (size_t j = 0; j < max_points; ++j) {
-              int fv_offset = vertex[points[j]];
-              T dist =  metric::DTWDistance<T>(
-                std::next(input_curves.begin(),input_curves_offsets[fv_offset]),
-                std::next(input_curves.begin(),
-                          input_curves_offsets[fv_offset] + input_curves_lengths[fv_offset]),
-                std::next(query_curves.begin(),query_curves_offsets[offset]),
-                std::next(query_curves.begin(),
-                          query_curves_offsets[offset] + query_curves_lengths[offset]));
-              if (dist < min_dist) {
-                min_dist = dist;
-                min_id = input_curves_ids[fv_offset];
-              }
-            }
-          }
-
-          // Return result as a pair of min_dist and min_id
-          return std::make_pair(min_dist,min_id);
+          return NearestNeighbor(&query_points[(size_t) offset * D], D, offset,
+                                 query_curves, query_curves_lengths,
+                                 query_curves_offsets, false);
         };
-        std::pair<T,U> NearestNeighbor(const std::vector<T>& query_points,
+        std::pair<T,U> NearestNeighbor(const utils::Ragged<T>& query_points,
+          const int offset, const std::vector<std::pair<T,T>>& query_curves,
+          const std::vector<int>& query_curves_lengths,
+          const std::vector<int>& query_curves_offsets) {
+          return NearestNeighbor(query_points.Data(offset),
+                                 query_points.Length(offset), offset,
+                                 query_curves, query_curves_lengths,
+                                 query_curves_offsets, false);
+        };
+        std::pair<T,U> NearestNeighbor(const utils::Span<T>& query_points,
           const int offset, const std::vector<std::pair<T,T>>& query_curves,
           const std::vector<int>& query_curves_lengths,
           const std::vector<int>& query_curves_offsets, U id) {
-
-          T min_dist = std::numeric_limits<T>::max();
-          U min_id{};
-          std::string key;
-          // Get value from g function
-          for (size_t i = 0; i < k; ++i) {
-            uint32_t val = g[i].Hash(query_points,offset);
-            FlipCoin(val);
-            key += bucket_map[val].to_string();
+          if ((size_t) (offset + 1) * D > query_points.size()) {
+            return std::make_pair(std::numeric_limits<T>::max(), U{});
           }
-          //Checking for neighbor in same vertex
-          std::vector<int>& vertex = p[key];
-          for (auto const& fv_offset: vertex) {
-            int of = fv_offset % input_curves_lengths.size();
-            T dist =  metric::DTWDistance<T>(
-              std::next(input_curves.begin(),input_curves_offsets[of]),
-              std::next(input_curves.begin(),
-                        input_curves_offsets[of] + input_curves_lengths[of]),
-              std::next(query_curves.begin(),query_curves_offsets[offset]),
-              std::next(query_curves.begin(),
-                        query_curves_offsets[offset] + query_curves_lengths[offset]));
-            if (dist < min_dist) {
-              min_dist = dist;
-              min_id = input_curves_ids[of];
-            }
-          }
-
-          // Get "probes" random vertices with hamming distance 1
-          std::vector<std::string> vertices = GetToggledBitStrings(key);
-          size_t num_vertices = vertices.size();
-          std::vector<size_t> idx = VectorShuffle(num_vertices);
-          size_t max_vertices = (num_vertices < probes) ? num_vertices : probes;
-
-          // For each key map to its bucket and search
-          for (size_t i = 0; i < max_vertices; ++i) {
-            const std::string key = vertices[idx[i]];
-            //Get a specific vertex
-            std::vector<int>& vertex = p[key];
-            size_t num_points = vertex.size();
-            // Choose randomly M points from vertex
-            std::vector<size_t> points = VectorShuffle(num_points);
-            size_t max_points = (num_points < M) ? num_points : M;
-            // Calculate manhattan distance between those points and queries
-            for (size_t j = 0; j < max_points; ++j) {
-              int fv_offset = vertex[points[j]] % input_curves_lengths.size();
-              T dist =  metric::DTWDistance<T>(
-                std::next(input_curves.begin(),input_curves_offsets[fv_offset]),
-                std::next(input_curves.begin(),
-                          input_curves_offsets[fv_offset] + input_curves_lengths[fv_offset]),
-                std::next(query_curves.begin(),query_curves_offsets[offset]),
-                std::next(query_curves.begin(),
-                          query_curves_offsets[offset] + query_curves_lengths[offset]));
-              if (dist < min_dist) {
-                min_dist = dist;
-                min_id = input_curves_ids[fv_offset];
-              }
-            }
-          }
-
-          // Return result as a pair of min_dist and min_id
-          return std::make_pair(min_dist,min_id);
+          return NearestNeighbor(&query_points[(size_t) offset * D], D, offset,
+                                 query_curves, query_curves_lengths,
+                                 query_curves_offsets, true);
         };
-
-    		/** \brief For each gi,
-    		 - fi(gi) maps buckets to {0,1} uniformly.
-    		*/
-    		void FlipCoin(uint32_t key) {
-    			if (bucket_map.find(key) == bucket_map.end()) {
-    				bucket_map[key] = f(generator);
-    			}
-    		};
-        /**
-          \brief Given a string return all strings with hamming distance 1
+        /** \brief Visit the offsets of the candidate curves of a query without
+          computing any distance, so that candidates of several structures
+          can be merged and scored once
+          @par const int offset - Offset to get correspodent point
+          @par Visit visit - called with the offset of each candidate curve
         */
-        std::vector<std::string> GetToggledBitStrings(const std::string& key) {
-          /* Initialize the vector to be returned */
-          std::vector<std::string> result;
-          /* Toggle each char of the key string to take the one
-            with hamming distance 1 */
-          for (size_t i = 0; i < key.length(); ++i) {
-            std::string temp = key;
-            temp[i] = (key[0] == '1') ? 0 : 1;
-            result.push_back(temp);
-          }
-          return result;
+        template <typename Visit>
+        void Candidates(const std::vector<T>& query_points, const int offset,
+          Visit visit) {
+          Candidates(&query_points[(size_t) offset * D], D, false, visit);
         };
-        /**
-          \brief Given an input n create a vector with number from 1 to n in
-            random order
-        */
-        std::vector<size_t> VectorShuffle(const size_t n) {
-          std::vector<size_t> idx;
-          for (size_t i = 0; i < n; ++i) {
-            idx.push_back(i);
+        template <typename Visit>
+        void Candidates(const utils::Ragged<T>& query_points, const int offset,
+          Visit visit) {
+          Candidates(query_points.Data(offset), query_points.Length(offset),
+                     false, visit);
+        };
+        template <typename Visit>
+        void Candidates(const utils::Span<T>& query_points, const int offset,
+          U, Visit visit) {
+          if ((size_t) (offset + 1) * D <= query_points.size()) {
+            Candidates(&query_points[(size_t) offset * D], D, true, visit);
           }
-          std::random_shuffle(idx.begin(), idx.end());
-          return idx;
         };
+        const std::vector<std::pair<T,T>>& GetCurves(void) const { return input_curves; };
+        const utils::Span<U>& GetIds(void) const { return input_curves_ids; };
+        const utils::Span<int>& GetLengths(void) const { return input_curves_lengths; };
+        const utils::Span<int>& GetOffsets(void) const { return input_curves_offsets; };
     };
   }
 }
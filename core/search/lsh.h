@@ -1,6 +1,7 @@
 #ifndef LSH_H_
 #define LSH_H_
 
+#include <algorithm>
 #include <iterator>
 #include <random>
 #include <tuple>
@@ -8,6 +9,10 @@
 
 #include "../../core/hash/hash_function.h"
 #include "../../core/metric/metric.h"
+#include "../../core/utils/counters.h"
+#include "../../core/utils/ragged.h"
+#include "../../core/utils/span.h"
+#include "../../core/utils/timing.h"
 #include "../../core/utils/utils.h"
 
 using namespace std::chrono;
@@ -24,13 +29,17 @@ namespace search {
     @par D - points' dimension
     @par N - number of dataset points
     @par R - average of exact NN distances calculated using brute force search
+    @par Counters - policy counting the work of the queries, see counters.h
+    @par Timing - policy timing every query, see timing.h
   */
   /**
     \brief LSH class for vectors
   */
   namespace vectors {
 
-    template <typename T, typename U>
+    template <typename T, typename U,
+              typename Counters = utils::SearchCounters,
+              typename Timing = utils::QueryTiming>
     class LSH {
       private:
         uint32_t table_size;
@@ -50,13 +59,14 @@ namespace search {
         std::vector<std::unordered_map<int,std::vector<int>>> hash_tables;
       public:
         /** \brief class LSH constructor
+          @par const double window - window size as a multiple of r
         */
         LSH(const uint8_t K, const uint8_t L, const uint16_t D,
             const uint32_t N, const double r, const std::vector<T>& points,
-            const std::vector<T>& ids) : K(K), L(L), D(D), N(N), R(r),
-            feature_vector(points), feature_vector_ids(ids) {
+            const std::vector<T>& ids, const double window = 2) : K(K), L(L),
+            D(D), N(N), R(r), feature_vector(points), feature_vector_ids(ids) {
 
-            w = 2 * r;
+            w = window * r;
             m = (1ULL << 32) - 5;
             M = 1ULL << (32 / K);
             table_size = N / 32;
@@ -73,6 +83,7 @@ namespace search {
               }
               hash_tables.push_back(ht);
             }
+            Timing::Calibrate();
         };
         /**
           \brief class LSH default destructor
@@ -86,16 +97,21 @@ namespace search {
         std::tuple<T,U,double> NearestNeighbor(const std::vector<T>& query_points,
           const int offset) {
 
-          auto start = high_resolution_clock::now();
+          const typename Timing::Stamp start = Timing::Start();
           /* Initialize min_dist to max value of type T */
           T min_dist = std::numeric_limits<T>::max();
           /* Initialize correspodent min_id using the C++11 way */
           U min_id{};
+          Counters::Add(utils::counters::QUERIES);
           for (size_t i = 0; i < L; ++i) {
             // get i_th hashtable
             std::unordered_map<int,std::vector<int>>& ht_i = hash_tables[i];
             // get all points in the same bucket
             std::vector<int>& bucket = ht_i[hash_functions[i].Hash(query_points,offset) % table_size];
+            Counters::Add(utils::counters::BUCKETS_PROBED);
+            Counters::Add(utils::counters::BUCKET_SIZES, bucket.size());
+            Counters::Add(utils::counters::CANDIDATES, bucket.size());
+            Counters::Add(utils::counters::DISTANCES, bucket.size());
             // iterate over all points in the buck
             for (auto const& fv_offset: bucket) {
               T dist = metric::ManhattanDistance<T>(
@@ -108,10 +124,8 @@ namespace search {
               }
             }
           }
-          auto stop = high_resolution_clock::now();
-          duration <double> total_time = duration_cast<duration<double>>(stop - start);
-          /* return result as a tuple of min_dist, min_id and total_time */
-          return std::make_tuple(min_dist,min_id,total_time.count());
+          /* return result as a tuple of min_dist, min_id and seconds taken */
+          return std::make_tuple(min_dist,min_id,Timing::Stop(start));
         };
 
         /** \brief Executes approximate Radius Nearest tNeighbor
@@ -153,7 +167,8 @@ namespace search {
   */
   namespace curves {
 
-    template <typename T, typename U>
+    template <typename T, typename U,
+              typename Counters = utils::SearchCounters>
     class LSH {
       private:
         uint32_t table_size;
@@ -166,24 +181,87 @@ namespace search {
         const uint32_t N;
         const double R;
 
-        const std::vector<double> &feature_vector;
         const std::vector<std::pair<T,T>>& input_curves;
-        const std::vector<U> &input_curves_ids;
-        const std::vector<int>& input_curves_lengths;
-        const std::vector<int>& input_curves_offsets;
+        const utils::Span<U> input_curves_ids;
+        const utils::Span<int> input_curves_lengths;
+        const utils::Span<int> input_curves_offsets;
 
         std::vector<hash::AmplifiedHashFunction<double>> hash_functions;
         std::vector<std::unordered_map<int,std::vector<int>>> hash_tables;
+
+        /** \brief Visit the offsets of the curves in the buckets of the query
+          point given its first length coordinates
+          @par const bool wrap - map bucket offsets modulo the number of curves
+        */
+        template <typename Visit>
+        void Candidates(const T *query, const size_t length, const bool wrap,
+          Visit visit) {
+
+          for (size_t i = 0; i < L; ++i) {
+            // get i_th hashtable
+            std::unordered_map<int,std::vector<int>> &ht_i = hash_tables[i];
+            // get all curves in the same bucket
+            std::vector<int> &bucket = ht_i[hash_functions[i].Hash(query,length) % table_size];
+            Counters::Add(utils::counters::BUCKETS_PROBED);
+            Counters::Add(utils::counters::BUCKET_SIZES, bucket.size());
+            Counters::Add(utils::counters::CANDIDATES, bucket.size());
+            //iterate over all curves in the bucket
+            for (auto const& fv_offset: bucket) {
+              visit(wrap ? fv_offset % input_curves_offsets.size() : fv_offset);
+            }
+          }
+        };
+        /** \brief Executes approximate Nearest tNeighbor of the query point
+          given its first length coordinates
+          @par const bool wrap - map bucket offsets modulo the number of curves
+        */
+        std::pair<T,U> NearestNeighbor(const T *query, const size_t length,
+          const int offset, const std::vector<std::pair<T,T>>& query_curves,
+          const std::vector<int>& query_curves_lengths,
+          const std::vector<int>& query_curves_offsets, const bool wrap) {
+
+          /* Initialize min_dist to max value of type T */
+          T min_dist = std::numeric_limits<T>::max();
+          /* Initialize correspodent min_id using the C++11 way */
+          U min_id{};
+          Counters::Add(utils::counters::QUERIES);
+          Candidates(query, length, wrap, [&](const uint32_t of) {
+            Counters::Add(utils::counters::DISTANCES);
+            T dist =  metric::DTWDistance<T> (
+              std::next(input_curves.begin(),input_curves_offsets[of]),
+              std::next(input_curves.begin(),
+                        input_curves_offsets[of] + input_curves_lengths[of]),
+              std::next(query_curves.begin(),query_curves_offsets[offset]),
+              std::next(query_curves.begin(),
+                        query_curves_offsets[offset] + query_curves_lengths[offset])
+            );
+            if (dist < min_dist) {
+              min_dist = dist;
+              min_id = input_curves_ids[of];
+            }
+          });
+          /* return result as a tuple of min_dist and min_id */
+          return std::make_pair(min_dist,min_id);
+        };
       public:
         /** \brief class LSH constructor
         */
         LSH(const uint8_t K, const uint8_t L, const uint16_t D, const uint32_t N,
             const double r, const std::vector<std::pair<T,T>>& curves,
-            const std::vector<U> &ids, const std::vector<int>& lengths,
-            const std::vector<int>& offsets, const std::vector<T> &points) :
-            K(K), L(L), D(D), N(N), R(r), input_curves(curves),
+            const utils::Span<U>& ids, const utils::Span<int>& lengths,
+            const utils::Span<int>& offsets, const std::vector<T> &points) :
+            LSH(K, L, N, r, curves, ids, lengths, offsets,
+                utils::RaggedView<T>(points, D)) {};
+        /** \brief class LSH constructor on variable length vectors, e.g
+          grid curves, implicitly padded to dimension D
+        */
+        LSH(const uint8_t K, const uint8_t L, const uint32_t N,
+            const double r, const std::vector<std::pair<T,T>>& curves,
+            const utils::Span<U>& ids, const utils::Span<int>& lengths,
+            const utils::Span<int>& offsets, const utils::RaggedView<T>& points) :
+            K(K), L(L), D(points.GetD()), N(N), R(r), input_curves(curves),
             input_curves_ids(ids), input_curves_lengths(lengths),
-            input_curves_offsets(offsets), feature_vector(points) {
+            input_curves_offsets(offsets) {
 
             w = 40 * R;
             m = (1ULL << 32) - 5;
@@ -198,7 +276,7 @@ namespace search {
             for (size_t i = 0; i < L; ++i) {
               std::unordered_map<int,std::vector<int>> ht;
               for (size_t j = 0; j < N; ++j) {
-                ht[hash_functions[i].Hash(feature_vector,j) % table_size].push_back(j);
+                ht[hash_functions[i].Hash(points.Data(j),points.Length(j)) % table_size].push_back(j);
               }
               hash_tables.push_back(ht);
             }
@@ -215,72 +293,182 @@ namespace search {
           const int offset, const std::vector<std::pair<T,T>>& query_curves,
           const std::vector<int>& query_curves_lengths,
           const std::vector<int>& query_curves_offsets) {
-
-          /* Initialize min_dist to max value of type T */
-          T min_dist = std::numeric_limits<T>::max();
-          /* Initialize correspodent min_id using the C++11 way */
-          U min_id{};
-          for (size_t i = 0; i < L; ++i) {
-            // get i_th hashtable
-            std::unordered_map<int,std::vector<int>> &ht_i = hash_tables[i];
-            // get all curves in the same bucket
-            std::vector<int> &bucket = ht_i[hash_functions[i].Hash(query_points,offset) % table_size];
-            //iterate over all curves in the bucket
-            for (auto const& fv_offset: bucket) {
-              T dist =  metric::DTWDistance<T> (
-                std::next(input_curves.begin(),input_curves_offsets[fv_offset]),
-                std::next(input_curves.begin(),
-                          input_curves_offsets[fv_offset] + input_curves_lengths[fv_offset]),
-                std::next(query_curves.begin(),query_curves_offsets[offset]),
-                std::next(query_curves.begin(),
-                          query_curves_offsets[offset] + query_curves_lengths[offset])
-              );
-              if (dist < min_dist) {
-                min_dist = dist;
-                min_id = input_curves_ids[fv_offset];
-              }
-            }
-          }
-          /* return result as a tuple of min_dist and min_id */
-          return std::make_pair(min_dist,min_id);
+          return NearestNeighbor(&query_points[(size_t) offset * D], D, offset,
+                                 query_curves, query_curves_lengths,
+                                 query_curves_offsets, false);
         };
-
-        std::pair<T,U> NearestNeighbor(const std::vector<T>& query_points,
+        std::pair<T,U> NearestNeighbor(const utils::Ragged<T>& query_points,
+          const int offset, const std::vector<std::pair<T,T>>& query_curves,
+          const std::vector<int>& query_curves_lengths,
+          const std::vector<int>& query_curves_offsets) {
+          return NearestNeighbor(query_points.Data(offset),
+                                 query_points.Length(offset), offset,
+                                 query_curves, query_curves_lengths,
+                                 query_curves_offsets, false);
+        };
+        std::pair<T,U> NearestNeighbor(const utils::Span<T>& query_points,
           const int offset, const std::vector<std::pair<T,T>>& query_curves,
           const std::vector<int>& query_curves_lengths,
           const std::vector<int>& query_curves_offsets,
           const U idx) {
+          if ((size_t) (offset + 1) * D > query_points.size()) {
+            return std::make_pair(std::numeric_limits<T>::max(), U{});
+          }
+          return NearestNeighbor(&query_points[(size_t) offset * D], D, offset,
+                                 query_curves, query_curves_lengths,
+                                 query_curves_offsets, true);
+        };
+        /** \brief Visit the offsets of the candidate curves of a query without
+          computing any distance, so that candidates of several structures
+          can be merged and scored once
+          @par const int offset - Offset to get correspodent point
+          @par Visit visit - called with the offset of each candidate curve
+        */
+        template <typename Visit>
+        void Candidates(const std::vector<T>& query_points, const int offset,
+          Visit visit) {
+          Candidates(&query_points[(size_t) offset * D], D, false, visit);
+        };
+        template <typename Visit>
+        void Candidates(const utils::Ragged<T>& query_points, const int offset,
+          Visit visit) {
+          Candidates(query_points.Data(offset), query_points.Length(offset),
+                     false, visit);
+        };
+        template <typename Visit>
+        void Candidates(const utils::Span<T>& query_points, const int offset,
+          const U, Visit visit) {
+          if ((size_t) (offset + 1) * D <= query_points.size()) {
+            Candidates(&query_points[(size_t) offset * D], D, true, visit);
+          }
+        };
+        const std::vector<std::pair<T,T>>& GetCurves(void) const { return input_curves; };
+        const utils::Span<U>& GetIds(void) const { return input_curves_ids; };
+        const utils::Span<int>& GetLengths(void) const { return input_curves_lengths; };
+        const utils::Span<int>& GetOffsets(void) const { return input_curves_offsets; };
+    };
+    /** \brief SharedLSH - LSH of many groups of vectors of the same
+      dimension, e.g. the vectors of the traversals in Projection. Every group
+      is a tenant of the structure: all tenants share the L amplified hash
+      functions and live in one hash table per function, keyed by
+      (tenant, bucket). Memory and build time grow with the number of
+      vectors and not with the number of tenants, and a query point is
+      hashed once for all the tenants it is searched in.
+    */
+    template <typename T, typename U,
+              typename Counters = utils::SearchCounters>
+    class SharedLSH {
+      private:
+        /* curves of the vectors of a tenant and its virtual table size */
+        struct Tenant {
+          uint32_t table_size;
+          utils::Span<U> ids;
+          utils::Span<int> lengths;
+          utils::Span<int> offsets;
+        };
+        uint32_t m;
+        uint32_t M;
+        double w;
+        const uint8_t K;
+        const uint8_t L;
+        const uint16_t D;
+        const double R;
 
-          /* Initialize min_dist to max value of type T */
-          T min_dist = std::numeric_limits<T>::max();
-          /* Initialize correspodent min_id using the C++11 way */
-          U min_id{};
+        const std::vector<std::pair<T,T>>& input_curves;
+
+        std::vector<Tenant> tenants;
+        std::vector<hash::AmplifiedHashFunction<double>> hash_functions;
+        std::vector<std::unordered_map<uint64_t,std::vector<uint32_t>>> hash_tables;
+
+        static uint64_t Key(const uint32_t tenant, const uint32_t bucket) {
+          return static_cast<uint64_t>(tenant) << 32 | bucket;
+        };
+      public:
+        /** \brief class SharedLSH constructor, tenants are added by Add
+          @par const uint16_t D - dimension of the vectors of all tenants
+        */
+        SharedLSH(const uint8_t K, const uint8_t L, const uint16_t D,
+          const double r, const std::vector<std::pair<T,T>>& curves) :
+          K(K), L(L), D(D), R(r), input_curves(curves),
+          hash_tables(L) {
+
+          w = 40 * R;
+          m = (1ULL << 32) - 5;
+          M = pow(2, 32 / K);
           for (size_t i = 0; i < L; ++i) {
-            // get i_th hashtable
-            std::unordered_map<int,std::vector<int>> &ht_i = hash_tables[i];
-            // get all curves in the same bucket
-            std::vector<int> &bucket = ht_i[hash_functions[i].Hash(query_points,offset) % table_size];
-            //iterate over all curves in the bucket
-            //auto const& fv_offset:bucket[0];
-            for (auto const& fv_offset: bucket) {
-              int of = fv_offset % input_curves_offsets.size(); //fv_offset % input_curves_offsets.size();
-              //std::cout << fv_offset << std::endl; 
-              T dist =  metric::DTWDistance<T> (
-                std::next(input_curves.begin(),input_curves_offsets[of]),
-                std::next(input_curves.begin(),
-                          input_curves_offsets[of] + input_curves_lengths[of]),
-                std::next(query_curves.begin(),query_curves_offsets[offset]),
-                std::next(query_curves.begin(),
-                          query_curves_offsets[offset] + query_curves_lengths[offset])
-              );
-              if (dist < min_dist) {
-                min_dist = dist;
-                min_id = input_curves_ids[of];
+            hash_functions.push_back(hash::AmplifiedHashFunction<T>(K,D,m,M,w));
+          }
+        };
+        /**
+          \brief class SharedLSH default destructor
+        */
+        ~SharedLSH() = default;
+        /** \brief Hash the N vectors of a new tenant to all tables. Vector j
+          belongs to curve j modulo the number of curves of the tenant, as in
+          the wrapping queries of LSH
+          @par const uint32_t N - number of vectors of the tenant
+          rest of parameters describe the curves of the vectors
+          returns: the index of the tenant
+        */
+        uint32_t Add(const uint32_t N, const utils::Span<U>& ids,
+          const utils::Span<int>& lengths, const utils::Span<int>& offsets,
+          const utils::RaggedView<T>& points) {
+
+          const uint32_t tenant = tenants.size();
+          tenants.push_back(Tenant{std::max<uint32_t>(N / 8, 1), ids, lengths,
+                                   offsets});
+          for (size_t i = 0; i < L; ++i) {
+            for (size_t j = 0; j < N; ++j) {
+              const uint32_t bucket = hash_functions[i].Hash(points.Data(j),
+                points.Length(j)) % tenants[tenant].table_size;
+              hash_tables[i][Key(tenant, bucket)].push_back(j);
+            }
+          }
+          return tenant;
+        };
+        /** \brief Visit the candidate curves of a query point in the given
+          tenants, hashing the query point once per hash function
+          @par const std::vector<uint32_t>& group - tenants to search
+          @par const int offset - Offset to get correspodent point
+          @par Visit visit - called with the tenant and the offset of each
+            candidate curve in the tenant
+        */
+        template <typename Visit>
+        void Candidates(const std::vector<uint32_t>& group,
+          const utils::Span<T>& query_points, const int offset, Visit visit) {
+
+          if ((size_t) (offset + 1) * D > query_points.size()) {
+            return;
+          }
+          for (size_t i = 0; i < L; ++i) {
+            const uint64_t hash_value = hash_functions[i].Hash(
+              &query_points[(size_t) offset * D], D);
+            for (const auto& tenant: group) {
+              auto bucket = hash_tables[i].find(
+                Key(tenant, hash_value % tenants[tenant].table_size));
+              Counters::Add(utils::counters::BUCKETS_PROBED);
+              if (bucket == hash_tables[i].end()) {
+                continue;
+              }
+              Counters::Add(utils::counters::BUCKET_SIZES, bucket->second.size());
+              Counters::Add(utils::counters::CANDIDATES, bucket->second.size());
+              const size_t size = tenants[tenant].offsets.size();
+              for (const auto& fv_offset: bucket->second) {
+                visit(tenant, fv_offset % size);
               }
             }
           }
-          /* return result as a tuple of min_dist and min_id */
-          return std::make_pair(min_dist,min_id);
+        };
+        size_t GetTenants(void) const { return tenants.size(); };
+        const std::vector<std::pair<T,T>>& GetCurves(void) const { return input_curves; };
+        const utils::Span<U>& GetIds(const uint32_t tenant) const {
+          return tenants[tenant].ids;
+        };
+        const utils::Span<int>& GetLengths(const uint32_t tenant) const {
+          return tenants[tenant].lengths;
+        };
+        const utils::Span<int>& GetOffsets(const uint32_t tenant) const {
+          return tenants[tenant].offsets;
         };
     };
   }
@@ -0,0 +1,245 @@
+#ifndef TUNER
+#define TUNER
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "../../core/search/brute_force.h"
+#include "../../core/utils/config.h"
+#include "../../core/utils/utils.h"
+
+namespace search {
+  namespace tuner {
+    /** \brief Number of dataset points the configurations are built on */
+    constexpr uint32_t kTuneSample = 2000;
+    /** \brief Configuration - parameters of an engine and their measured
+      quality. Parameters an engine does not use are ignored by it.
+      @par K - number of hash functions, or dimension of the cube
+      @par L - number of hash tables
+      @par w - window size as a multiple of R
+      @par probes - max number of vertices to be checked
+      @par M - max number of candidate points to be checked
+      @par recall - fraction of queries whose exact NN distance is found
+      @par latency - average seconds per query
+    */
+    struct Configuration {
+      uint16_t K;
+      uint8_t L;
+      double w;
+      uint8_t probes;
+      uint16_t M;
+      double recall;
+      double latency;
+    };
+    /** \brief All combinations of the given parameter values
+    */
+    inline std::vector<Configuration> Grid(const std::vector<uint16_t>& Ks,
+      const std::vector<uint8_t>& Ls, const std::vector<double>& ws,
+      const std::vector<uint8_t>& probes, const std::vector<uint16_t>& Ms) {
+
+      std::vector<Configuration> configurations;
+      for (const auto& K: Ks) {
+        for (const auto& L: Ls) {
+          for (const auto& w: ws) {
+            for (const auto& p: probes) {
+              for (const auto& M: Ms) {
+                configurations.push_back(Configuration{K, L, w, p, M, 0.0, 0.0});
+              }
+            }
+          }
+        }
+      }
+      return configurations;
+    }
+    /** \brief Maximum number of held-out dataset points the configurations
+      are measured with
+    */
+    constexpr uint32_t kTuneQueries = 200;
+    /** \brief Split a random subset of [0, N) into up to S indices the
+      configurations are built on and up to n other indices used as pseudo
+      queries, so that tuning never sees the evaluation queries. Both are in
+      increasing order so that the sampled points keep their relative order
+    */
+    inline std::pair<std::vector<uint32_t>,std::vector<uint32_t>> HoldOut(
+      const uint32_t N, const uint32_t S, const uint32_t n) {
+
+      std::vector<uint32_t> indices(N);
+      for (size_t i = 0; i < N; ++i) {
+        indices[i] = i;
+      }
+      std::mt19937_64 generator(
+        std::chrono::system_clock::now().time_since_epoch().count());
+      const uint32_t queries = std::min(n, N / 2);
+      const uint32_t size = std::min(S, N - queries);
+      // partial Fisher-Yates shuffle draws both without replacement
+      for (size_t i = 0; i < size + queries; ++i) {
+        std::uniform_int_distribution<uint32_t> pick(i, N - 1);
+        std::swap(indices[i], indices[pick(generator)]);
+      }
+      std::vector<uint32_t> sample(indices.begin(), indices.begin() + size);
+      std::vector<uint32_t> held_out(indices.begin() + size,
+                                     indices.begin() + size + queries);
+      std::sort(sample.begin(), sample.end());
+      std::sort(held_out.begin(), held_out.end());
+      return std::make_pair(sample, held_out);
+    }
+    /** \brief Measure recall and latency of a configuration. Latency is
+      the time of the whole batch over its queries, whatever the timing
+      policy of the engine
+      @par Configuration& configuration - where recall and latency are stored
+      @par const std::vector<std::tuple<T,U,double>>& exact - exact results
+      @par Search search - search(i) returns the result of query i as
+        a tuple of distance, id and seconds taken
+    */
+    template <typename T, typename U, typename Search>
+    void Measure(Configuration& configuration,
+      const std::vector<std::tuple<T,U,double>>& exact, Search search) {
+
+      size_t found = 0;
+      auto start = std::chrono::steady_clock::now();
+      for (size_t i = 0; i < exact.size(); ++i) {
+        const std::tuple<T,U,double> result = search(i);
+        if (std::get<0>(result) <= std::get<0>(exact[i])) {
+          ++found;
+        }
+      }
+      const double seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+      configuration.recall = exact.empty() ? 0.0 : (double) found / exact.size();
+      configuration.latency = exact.empty() ? 0.0 : seconds / exact.size();
+    }
+    /** \brief Configurations which no other configuration beats in both
+      recall and latency, in increasing latency and recall
+    */
+    inline std::vector<Configuration> ParetoFront(
+      std::vector<Configuration> configurations) {
+
+      std::sort(configurations.begin(), configurations.end(),
+                [](const Configuration& a, const Configuration& b) {
+        return a.latency < b.latency ||
+               (a.latency == b.latency && a.recall > b.recall);
+      });
+      std::vector<Configuration> front;
+      for (const auto& configuration: configurations) {
+        if (front.empty() || configuration.recall > front.back().recall) {
+          front.push_back(configuration);
+        }
+      }
+      return front;
+    }
+    /** \brief The fastest configuration of the front reaching the recall
+      target, or the one of highest recall if none reaches it
+    */
+    inline Configuration Select(const std::vector<Configuration>& front,
+      const double target) {
+
+      for (const auto& configuration: front) {
+        if (configuration.recall >= target) {
+          return configuration;
+        }
+      }
+      return front.back();
+    }
+    /** \brief Print a configuration as a line of the Pareto front
+    */
+    inline void Print(const Configuration& c) {
+      std::cout << "K = " << c.K << ", L = " << (unsigned int) c.L
+                << ", w = " << c.w << ", probes = " << (unsigned int) c.probes
+                << ", M = " << c.M << ": recall " << c.recall
+                << ", latency " << c.latency << " seconds" << std::endl;
+    }
+    /** \brief Store a configuration to a config file.
+        Throws std::runtime_error on I/O failure
+      @par const double target - recall target the configuration was chosen for
+    */
+    inline void Save(const std::string& file_name, const Configuration& c,
+      const double target) {
+
+      utils::Config config;
+      config.Set("K", c.K);
+      config.Set("L", (unsigned int) c.L);
+      config.Set("w", c.w);
+      config.Set("probes", (unsigned int) c.probes);
+      config.Set("M", c.M);
+      config.Set("recall", c.recall);
+      config.Set("latency", c.latency);
+      config.Save(file_name, "tuned for recall " + std::to_string(target));
+    }
+    /** \brief Tune vector search for a recall target. Every configuration
+      is built on a sample of the dataset and measured against the exact NN
+      in the sample of held-out dataset points. The Pareto front and the
+      chosen configuration are printed and the latter is saved to a config
+      file. Throws std::runtime_error on I/O failure
+      @par std::vector<Configuration> configurations - the grid to be tuned
+      @par const std::vector<T>& points - the N dataset points of dimension D
+      @par const std::vector<U>& ids - the ids of the dataset points
+      @par const double target - recall target
+      @par const bool scale_K - K is the dimension of a cube, whose vertices
+        should grow with the dataset, so log2 of the ratio of N to the sample
+        size is added to the chosen K
+      @par const std::string& file_name - config file to be written
+      @par Build build - build(c, S, r, sample_points, sample_ids) returns a
+        std::unique_ptr to a structure of configuration c on the S sampled
+        points, whose NearestNeighbor(queries, i) searches pseudo query i
+      returns: the chosen configuration
+    */
+    template <typename T, typename U, typename Build>
+    Configuration Tune(std::vector<Configuration> configurations,
+      const std::vector<T>& points, const std::vector<U>& ids,
+      const uint16_t D, const uint32_t N, const double target,
+      const bool scale_K, const std::string& file_name, Build build) {
+
+      std::vector<uint32_t> sample, held_out;
+      std::tie(sample, held_out) = HoldOut(N, kTuneSample, kTuneQueries);
+      const uint32_t S = sample.size();
+      std::vector<T> sample_points((size_t) S * D);
+      std::vector<U> sample_ids(S);
+      for (size_t i = 0; i < S; ++i) {
+        std::copy_n(&points[(size_t) sample[i] * D], D,
+                    &sample_points[(size_t) i * D]);
+        sample_ids[i] = ids[sample[i]];
+      }
+      std::vector<T> queries(held_out.size() * D);
+      for (size_t i = 0; i < held_out.size(); ++i) {
+        std::copy_n(&points[(size_t) held_out[i] * D], D, &queries[i * D]);
+      }
+      vectors::BruteForce<T,U> sample_bf{S, D, sample_points, sample_ids};
+      std::vector<std::tuple<T,U,double>> exact(held_out.size());
+      for (size_t i = 0; i < held_out.size(); ++i) {
+        exact[i] = sample_bf.NearestNeighbor(queries, i);
+      }
+      const double r = utils::ComputeParameterR(exact);
+      for (auto& c: configurations) {
+        auto structure = build(c, S, r, sample_points, sample_ids);
+        Measure(c, exact, [&](const size_t i) {
+          return structure->NearestNeighbor(queries, i);
+        });
+      }
+      const std::vector<Configuration> front = ParetoFront(configurations);
+      std::cout << "Pareto front of " << configurations.size()
+                << " configurations on " << S << " points and "
+                << held_out.size() << " held-out queries:" << std::endl;
+      for (const auto& c: front) {
+        Print(c);
+      }
+      Configuration chosen = Select(front, target);
+      if (scale_K && N > S) {
+        chosen.K += (uint16_t) std::lround(std::log2((double) N / S));
+      }
+      std::cout << "Chosen for recall " << target << ":" << std::endl;
+      Print(chosen);
+      Save(file_name, chosen, target);
+      return chosen;
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef CONFIG
+#define CONFIG
+
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace utils {
+  /** \brief Config - parameters stored as one "key = value" pair per line.
+    Empty lines and lines starting with # are ignored.
+  */
+  class Config {
+    private:
+      std::map<std::string,std::string> values;
+
+      static std::string Trim(const std::string& str) {
+        const size_t begin = str.find_first_not_of(" \t\r");
+        if (begin == std::string::npos) {
+          return std::string();
+        }
+        return str.substr(begin, str.find_last_not_of(" \t\r") - begin + 1);
+      };
+    public:
+      Config() = default;
+      /** \brief class Config constructor from a file written by Save
+        @par const std::string& file_name - Path to the config file
+        throws std::runtime_error if the file can not be read or parsed
+      */
+      explicit Config(const std::string& file_name) {
+        std::ifstream file(file_name);
+        if (!file) {
+          throw std::runtime_error("can not open " + file_name);
+        }
+        std::string line;
+        for (size_t number = 1; std::getline(file, line); ++number) {
+          line = Trim(line);
+          if (line.empty() || line[0] == '#') {
+            continue;
+          }
+          const size_t equal = line.find('=');
+          if (equal == std::string::npos) {
+            throw std::runtime_error(file_name + ":" + std::to_string(number)
+                                     + ": expected key = value");
+          }
+          values[Trim(line.substr(0, equal))] = Trim(line.substr(equal + 1));
+        }
+      };
+      /**
+        \brief class Config default destructor
+      */
+      ~Config() = default;
+      bool Has(const std::string& key) const {
+        return values.count(key) != 0;
+      };
+      /** \brief Value of key converted to V, or default_value if the key
+        is missing. Throws std::runtime_error if the value is not a V
+      */
+      template <typename V>
+      V Get(const std::string& key, const V& default_value) const {
+        auto value = values.find(key);
+        if (value == values.end()) {
+          return default_value;
+        }
+        std::istringstream ss(value->second);
+        V result;
+        if (!(ss >> result)) {
+          throw std::runtime_error("invalid value of " + key);
+        }
+        return result;
+      };
+      /** \brief Value of key as by Get, which must lie in [min, max].
+        Throws std::runtime_error otherwise
+      */
+      template <typename V>
+      V Get(const std::string& key, const V& default_value, const V& min,
+        const V& max) const {
+        const V result = Get<V>(key, default_value);
+        if (result < min || result > max) {
+          throw std::runtime_error("value of " + key + " out of range");
+        }
+        return result;
+      };
+      template <typename V>
+      void Set(const std::string& key, const V& value) {
+        std::ostringstream ss;
+        ss << value;
+        values[key] = ss.str();
+      };
+      /** \brief Write all pairs to a file, after an optional comment line.
+          Throws std::runtime_error on I/O failure
+        @par const std::string& file_name - Path to the config file
+      */
+      void Save(const std::string& file_name,
+        const std::string& comment = std::string()) const {
+        std::ofstream file(file_name);
+        if (!comment.empty()) {
+          file << "# " << comment << "\n";
+        }
+        for (const auto& value: values) {
+          file << value.first << " = " << value.second << "\n";
+        }
+        if (!file.flush()) {
+          throw std::runtime_error("can not write " + file_name);
+        }
+      };
+  };
+}
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef COUNTERS
+#define COUNTERS
+
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+
+namespace utils {
+  namespace counters {
+    /* enumerated counters of the work done by the queries of a run */
+    typedef enum Counter {
+      QUERIES,
+      BUCKETS_PROBED,
+      BUCKET_SIZES,
+      CANDIDATES,
+      UNIQUE_CANDIDATES,
+      DISTANCES,
+      EARLY_ABANDONS,
+      LOWER_BOUND_PRUNES,
+      NUM_COUNTERS
+    } Counter;
+    /** \brief None - counters policy of the engines when instrumentation is
+      disabled. Add is an empty inline function, so counting compiles to
+      nothing on the search path.
+    */
+    struct None {
+      static constexpr bool kEnabled = false;
+      static void Add(const Counter, const uint64_t = 1) {};
+      static uint64_t Get(const Counter) { return 0; };
+      static void Reset(void) {};
+    };
+    /** \brief Run - counters policy aggregating the counters of all the
+      queries of a run. Counters are added by relaxed atomic increments, so
+      parallel probing and scoring tasks may add to them.
+    */
+    struct Run {
+      static constexpr bool kEnabled = true;
+      static std::atomic<uint64_t>* Totals(void) {
+        static std::atomic<uint64_t> totals[NUM_COUNTERS];
+        return totals;
+      };
+      static void Add(const Counter counter, const uint64_t n = 1) {
+        Totals()[counter].fetch_add(n, std::memory_order_relaxed);
+      };
+      static uint64_t Get(const Counter counter) {
+        return Totals()[counter].load(std::memory_order_relaxed);
+      };
+      static void Reset(void) {
+        for (size_t i = 0; i < NUM_COUNTERS; ++i) {
+          Totals()[i].store(0, std::memory_order_relaxed);
+        }
+      };
+    };
+    /** \brief Print the totals of a run and their average per query,
+      nothing if the policy is disabled
+    */
+    template <typename Counters>
+    void Print(std::ostream& out = std::cout) {
+      if (!Counters::kEnabled) {
+        return;
+      }
+      static const char *names[NUM_COUNTERS] = {
+        "Queries", "Buckets probed", "Bucket sizes", "Candidates scanned",
+        "Unique candidates", "Distance evaluations", "Early abandons",
+        "Lower bound prunes"
+      };
+      const uint64_t queries = Counters::Get(QUERIES);
+      out << "\nSearch counters (total, per query):" << std::endl;
+      for (size_t i = 0; i < NUM_COUNTERS; ++i) {
+        const uint64_t total = Counters::Get(static_cast<Counter>(i));
+        out << names[i] << ": " << total;
+        if (i != QUERIES && queries) {
+          out << ", " << (double) total / queries;
+        }
+        out << std::endl;
+      }
+    }
+  }
+  /* counters policy of the engines, Run if built with -DSEARCH_COUNTERS */
+#ifdef SEARCH_COUNTERS
+  typedef counters::Run SearchCounters;
+#else
+  typedef counters::None SearchCounters;
+#endif
+}
+
+#endif
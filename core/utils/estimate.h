@@ -0,0 +1,128 @@
+#ifndef ESTIMATE
+#define ESTIMATE
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "../metric/metric.h"
+#include "parallel.h"
+#include "ragged.h"
+
+namespace utils {
+  /** \brief Relative half width of the 95% confidence interval at which
+    the estimation of parameter R stops
+  */
+  constexpr double kRTolerance = 0.05;
+  /** \brief Maximum number of sampled points when R is estimated because
+    no exact NN distances of the queries are computed
+  */
+  constexpr uint32_t kRSamples = 1000;
+  /** \brief Estimate the average distance of a point to its nearest
+    neighbor, using a random sample of the dataset points as queries
+    against the rest of the dataset. Duplicates of a point are not its
+    nearest neighbor, as they would make R vanish on datasets with repeated
+    points, e.g grid curves. The sample is drawn in batches whose
+    queries are searched in parallel, and sampling stops as soon as the 95%
+    confidence interval of the average is within tolerance of it.
+    @par const uint32_t N - number of dataset points
+    @par Distance distance - distance(i, j, bound) of points i and j, any
+      value above bound if the distance exceeds bound
+    @par const uint32_t samples - maximum number of sampled points
+    @par const double tolerance - relative half width of the interval
+    returns: the estimated average and the number of points sampled
+  */
+  template <typename Distance>
+  std::pair<double,uint32_t> EstimateNNDistance(const uint32_t N,
+    Distance distance, const uint32_t samples,
+    const double tolerance = kRTolerance) {
+
+    const uint32_t batch = 32;
+    const uint32_t n = std::min(samples, N > 1 ? N : 0);
+    std::vector<uint32_t> sample(N);
+    for (size_t i = 0; i < N; ++i) {
+      sample[i] = i;
+    }
+    std::mt19937_64 generator(
+      std::chrono::system_clock::now().time_since_epoch().count());
+    std::vector<double> nn_distances(n);
+    double sum{}, sum_of_squares{};
+    uint32_t drawn = 0;
+    while (drawn < n) {
+      const uint32_t end = std::min(n, drawn + batch);
+      // partial Fisher-Yates shuffle draws the next batch without replacement
+      for (uint32_t i = drawn; i < end; ++i) {
+        std::uniform_int_distribution<uint32_t> pick(i, N - 1);
+        std::swap(sample[i], sample[pick(generator)]);
+      }
+      parallel::ParallelFor(end - drawn, 1, [&](const size_t b) {
+        const uint32_t i = sample[drawn + b];
+        double min_dist = std::numeric_limits<double>::max();
+        for (uint32_t j = 0; j < N; ++j) {
+          const double dist = j != i ? distance(i, j, min_dist) : 0.0;
+          if (dist > 0.0) {
+            min_dist = std::min(min_dist, dist);
+          }
+        }
+        nn_distances[drawn + b] =
+          min_dist < std::numeric_limits<double>::max() ? min_dist : 0.0;
+      });
+      for (uint32_t i = drawn; i < end; ++i) {
+        sum += nn_distances[i];
+        sum_of_squares += nn_distances[i] * nn_distances[i];
+      }
+      drawn = end;
+      const double mean = sum / drawn;
+      const double variance = std::max(0.0,
+        (sum_of_squares - drawn * mean * mean) / std::max<uint32_t>(drawn - 1, 1));
+      if (drawn > 1 && mean > 0.0 && 1.96 * std::sqrt(variance / drawn) <= tolerance * mean) {
+        break;
+      }
+    }
+    return std::make_pair(drawn ? sum / drawn : 0.0, drawn);
+  }
+  /** \brief Estimate parameter R of vectors, or of variable length vectors
+    implicitly padded to their dimension, under the Manhattan distance.
+    The distance to a pseudo query is abandoned once it exceeds its nearest
+    distance.
+    @par const utils::RaggedView<T>& points - the dataset points
+    rest of parameters as in EstimateNNDistance
+  */
+  template <typename T>
+  std::pair<double,uint32_t> EstimateParameterR(const RaggedView<T>& points,
+    const uint32_t N, const uint32_t samples,
+    const double tolerance = kRTolerance) {
+
+    return EstimateNNDistance(N, [&](const uint32_t i, const uint32_t j,
+                                     const double bound) {
+      return metric::PaddedManhattanDistance<T>(points.Data(i), points.Length(i),
+                                                points.Data(j), points.Length(j),
+                                                bound);
+    }, samples, tolerance);
+  }
+  /** \brief Estimate parameter R of curves under Dynamic Time Warping.
+    DTW of a pseudo query is abandoned once it exceeds its nearest distance
+    rest of parameters describe the dataset curves as in EstimateNNDistance
+  */
+  template <typename T>
+  std::pair<double,uint32_t> EstimateParameterR(
+    const std::vector<std::pair<T,T>>& curves, const std::vector<int>& lengths,
+    const std::vector<int>& offsets, const uint32_t samples,
+    const double tolerance = kRTolerance) {
+
+    return EstimateNNDistance(lengths.size(), [&](const uint32_t i,
+                                                  const uint32_t j,
+                                                  const double bound) {
+      auto p = std::next(curves.begin(), offsets[j]);
+      auto q = std::next(curves.begin(), offsets[i]);
+      return metric::DTWDistance<T>(p, std::next(p, lengths[j]),
+                                    q, std::next(q, lengths[i]), (T) bound);
+    }, samples, tolerance);
+  }
+}
+
+#endif
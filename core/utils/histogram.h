@@ -0,0 +1,88 @@
+#ifndef HISTOGRAM
+#define HISTOGRAM
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace utils {
+  /** \brief Histogram - latencies recorded in nanoseconds into log-linear
+    buckets: every power of two is split into kSubBuckets / 2 equal
+    buckets, so that any percentile is within 2 / kSubBuckets (0.8%) of a
+    recorded value, in constant memory whatever the number of queries.
+  */
+  class Histogram {
+    private:
+      static constexpr uint32_t kSubBucketBits = 8;
+      static constexpr uint32_t kSubBuckets = 1U << kSubBucketBits;
+
+      std::vector<uint64_t> counts;
+      uint64_t total;
+      uint64_t min;
+      uint64_t max;
+      double sum;
+
+      static uint32_t Bucket(const uint64_t value) {
+        if (value < kSubBuckets) {
+          return value;
+        }
+        // position of the highest set bit selects the power of two and the
+        // next kSubBucketBits - 1 bits the bucket within it
+        uint32_t exponent = 63 - __builtin_clzll(value);
+        uint32_t shift = exponent - kSubBucketBits + 1;
+        return shift * (kSubBuckets / 2) + (value >> shift);
+      };
+      /* largest value of bucket b */
+      static uint64_t Upper(const uint32_t b) {
+        if (b < kSubBuckets) {
+          return b;
+        }
+        uint32_t shift = b / (kSubBuckets / 2) - 1;
+        uint64_t first = (uint64_t) (b - shift * (kSubBuckets / 2)) << shift;
+        return first + (1ULL << shift) - 1;
+      };
+    public:
+      Histogram() : counts(Bucket(UINT64_MAX) + 1, 0), total(0),
+        min(UINT64_MAX), max(0), sum(0) {};
+      /**
+        \brief class Histogram default destructor
+      */
+      ~Histogram() = default;
+      /** \brief Record a latency given in seconds
+      */
+      void Record(const double seconds) {
+        const uint64_t value = std::llround(std::max(seconds, 0.0) * 1e9);
+        counts[Bucket(value)]++;
+        total++;
+        min = std::min(min, value);
+        max = std::max(max, value);
+        sum += seconds;
+      };
+      /** \brief returns: the latency in seconds below which a fraction p of
+        the recorded latencies lies, 0 if nothing was recorded
+      */
+      double Percentile(const double p) const {
+        if (total == 0) {
+          return 0.0;
+        }
+        // nearest rank of percentile p is ceil(p * total)
+        const uint64_t rank = std::max<uint64_t>(std::ceil(p * total), 1);
+        uint64_t seen = 0;
+        for (size_t b = 0; b < counts.size(); ++b) {
+          seen += counts[b];
+          if (seen >= rank) {
+            return std::min(std::max(Upper(b), min), max) / 1e9;
+          }
+        }
+        return max / 1e9;
+      };
+      uint64_t Count(void) const { return total; };
+      double Min(void) const { return total ? min / 1e9 : 0.0; };
+      double Max(void) const { return max / 1e9; };
+      double Mean(void) const { return total ? sum / total : 0.0; };
+      double Sum(void) const { return sum; };
+  };
+}
+
+#endif
@@ -0,0 +1,155 @@
+#ifndef PARALLEL
+#define PARALLEL
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace utils {
+  namespace parallel {
+    /**
+      \brief Number of worker threads to be used, at least 1
+    */
+    inline size_t Workers(void) {
+      return std::max(1U, std::thread::hardware_concurrency());
+    }
+    /** \brief Pool - worker threads started once and reused by every
+      parallel loop, so a query does not pay for creating and joining
+      threads. The calling thread runs the job too. A job started while
+      another one is running, e.g. from inside a task, runs on the calling
+      thread only.
+    */
+    class Pool {
+      private:
+        std::vector<std::thread> threads;
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable done;
+        std::atomic<bool> busy;
+        const std::function<void()> *job;
+        uint64_t generation;
+        size_t running;
+        bool stop;
+
+        void Loop(void) {
+          uint64_t seen = 0;
+          std::unique_lock<std::mutex> lock(mutex);
+          for (;;) {
+            wake.wait(lock, [&]() { return stop || generation != seen; });
+            if (stop) {
+              return;
+            }
+            seen = generation;
+            const std::function<void()> *work = job;
+            lock.unlock();
+            (*work)();
+            lock.lock();
+            if (--running == 0) {
+              done.notify_one();
+            }
+          }
+        };
+      public:
+        /** \brief Pool class constructor
+          @par const size_t workers - number of threads running a job,
+            including the calling thread
+        */
+        explicit Pool(const size_t workers = Workers()) : busy(false),
+          job(nullptr), generation(0), running(0), stop(false) {
+
+          for (size_t i = 1; i < workers; ++i) {
+            threads.emplace_back(&Pool::Loop, this);
+          }
+        };
+        Pool(const Pool&) = delete;
+        Pool& operator=(const Pool&) = delete;
+        /**
+          \brief Pool class destructor stops and joins the worker threads
+        */
+        ~Pool() {
+          {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+          }
+          wake.notify_all();
+          for (auto& thread: threads) {
+            thread.join();
+          }
+        };
+        size_t Size(void) const { return threads.size() + 1; };
+        /** \brief Run work on every thread of the pool and return once all
+          of them are done. work must split itself among concurrent calls.
+        */
+        void Run(const std::function<void()>& work) {
+          bool idle = false;
+          if (threads.empty() || !busy.compare_exchange_strong(idle, true)) {
+            work();
+            return;
+          }
+          {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &work;
+            running = threads.size();
+            ++generation;
+          }
+          wake.notify_all();
+          work();
+          {
+            std::unique_lock<std::mutex> lock(mutex);
+            done.wait(lock, [&]() { return running == 0; });
+            job = nullptr;
+          }
+          busy.store(false);
+        };
+    };
+    /**
+      \brief Pool shared by the parallel loops of a program, started by its
+        first call
+    */
+    inline Pool& SharedPool(void) {
+      static Pool pool;
+      return pool;
+    }
+    /** \brief Call f(i) for every i in [0, n). Indices are split in chunks
+      of grain consecutive indices which are handed to the threads of the
+      shared pool on demand, so uneven work is balanced. The calling thread
+      is one of the workers and f must be safe to call concurrently for
+      different i.
+      @par const size_t n - number of indices
+      @par const size_t grain - number of consecutive indices of a chunk
+      @par F f - called with each index
+      @par const size_t serial_below - n below which the loop runs on the
+        calling thread, as waking the pool costs more than small loops
+    */
+    template <typename F>
+    void ParallelFor(const size_t n, const size_t grain, F f,
+      const size_t serial_below = 0) {
+
+      const size_t chunk = std::max<size_t>(grain, 1);
+      const size_t chunks = (n + chunk - 1) / chunk;
+      if (chunks <= 1 || n < serial_below || Workers() <= 1) {
+        for (size_t i = 0; i < n; ++i) {
+          f(i);
+        }
+        return;
+      }
+      std::atomic<size_t> next(0);
+      const std::function<void()> work = [&]() {
+        size_t c;
+        while ((c = next++) < chunks) {
+          const size_t end = std::min(n, (c + 1) * chunk);
+          for (size_t i = c * chunk; i < end; ++i) {
+            f(i);
+          }
+        }
+      };
+      SharedPool().Run(work);
+    }
+  }
+}
+
+#endif
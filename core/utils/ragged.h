@@ -0,0 +1,53 @@
+#ifndef RAGGED
+#define RAGGED
+
+#include <cstdint>
+#include <vector>
+
+namespace utils {
+  /** \brief Ragged - N variable length vectors stored back to back.
+    Vector i is values[offsets[i]..offsets[i+1]). All vectors are
+    considered of dimension D, coordinates past the length of a vector
+    are implicit padding coordinates, so they cost no memory and hash
+    functions and distances skip them. No vector is longer than D.
+  */
+  template <typename T>
+  struct Ragged {
+    std::vector<T> values;          // coordinates of all vectors
+    std::vector<uint32_t> offsets;  // N + 1 offsets to values
+    uint32_t D = 0;                 // dimension of the padded vectors
+
+    const T* Data(const size_t i) const { return values.data() + offsets[i]; };
+    uint32_t Length(const size_t i) const { return offsets[i + 1] - offsets[i]; };
+    uint32_t Size(void) const { return offsets.empty() ? 0 : offsets.size() - 1; };
+  };
+  /** \brief RaggedView - read only view of either N dense vectors of
+    dimension D stored in a std::vector or of a Ragged, so that
+    structures can be built on both
+  */
+  template <typename T>
+  class RaggedView {
+    private:
+      const T *values;
+      const uint32_t *offsets;
+      uint32_t D;
+    public:
+      RaggedView(const std::vector<T>& points, const uint32_t D) :
+        values(points.data()), offsets(nullptr), D(D) {};
+      RaggedView(const T *points, const uint32_t D) :
+        values(points), offsets(nullptr), D(D) {};
+      RaggedView(const Ragged<T>& points) :
+        values(points.values.data()), offsets(points.offsets.data()),
+        D(points.D) {};
+
+      const T* Data(const size_t i) const {
+        return values + (offsets ? offsets[i] : i * D);
+      };
+      uint32_t Length(const size_t i) const {
+        return offsets ? offsets[i + 1] - offsets[i] : D;
+      };
+      uint32_t GetD(void) const { return D; };
+  };
+}
+
+#endif
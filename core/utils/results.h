@@ -0,0 +1,256 @@
+#ifndef RESULTS
+#define RESULTS
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace utils {
+  namespace results {
+    /** \brief Magic string and version of binary result files */
+    constexpr const char* kResultsMagic = "RESULTS";
+    constexpr uint32_t kResultsVersion = 1;
+    /** \brief Bytes buffered before they are written to the file */
+    constexpr size_t kBufferSize = 1 << 20;
+    /* enumerated formats of the result files */
+    typedef enum Format {
+      TEXT,
+      CSV,
+      JSONL,
+      BINARY
+    } Format;
+    /** \brief Parse the name of a result format
+      @par const std::string& name - text, csv, jsonl or binary
+      @par Format& format - the parsed format
+      returns: false if name is not a format
+    */
+    inline bool ParseFormat(const std::string& name, Format& format) {
+      static const char *names[] = {"text", "csv", "jsonl", "binary"};
+      for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+        if (name == names[i]) {
+          format = static_cast<Format>(i);
+          return true;
+        }
+      }
+      return false;
+    }
+    /** \brief Buffer - output file written in blocks of kBufferSize bytes.
+      Numbers are formatted straight into the buffer, without streams,
+      locales or a flush per line.
+    */
+    class Buffer {
+      private:
+        std::FILE *file;
+        std::vector<char> data;
+        size_t size;
+        bool failed;
+
+        /* make room for n more bytes */
+        void Reserve(const size_t n) {
+          if (size + n > data.size()) {
+            Flush();
+            if (n > data.size()) {
+              data.resize(n);
+            }
+          }
+        };
+      public:
+        /** \brief Buffer class constructor
+          throws std::runtime_error if the file can not be created
+        */
+        explicit Buffer(const std::string& file_name) :
+          file(std::fopen(file_name.c_str(), "wb")), data(kBufferSize),
+          size(0), failed(false) {
+
+          if (file == nullptr) {
+            throw std::runtime_error("can not create " + file_name);
+          }
+        };
+        Buffer(const Buffer&) = delete;
+        Buffer& operator=(const Buffer&) = delete;
+        /**
+          \brief Buffer class destructor closes the file, errors are only
+            reported by Close
+        */
+        ~Buffer() {
+          if (file != nullptr) {
+            Flush();
+            std::fclose(file);
+          }
+        };
+        void Write(const char *bytes, const size_t n) {
+          Reserve(n);
+          std::memcpy(&data[size], bytes, n);
+          size += n;
+        };
+        void Write(const char *text) { Write(text, std::strlen(text)); };
+        void Write(const char c) {
+          Reserve(1);
+          data[size++] = c;
+        };
+        /** \brief Write the decimal digits of an integer */
+        void WriteInteger(const int64_t value) {
+          char digits[20];
+          size_t n = 0;
+          uint64_t magnitude = value < 0 ? 0 - (uint64_t) value : value;
+          do {
+            digits[n++] = '0' + magnitude % 10;
+            magnitude /= 10;
+          } while (magnitude);
+          Reserve(n + 1);
+          if (value < 0) {
+            data[size++] = '-';
+          }
+          while (n) {
+            data[size++] = digits[--n];
+          }
+        };
+        /** \brief Write a real number with 9 significant digits */
+        void WriteReal(const double value) {
+          Reserve(32);
+          size += std::snprintf(&data[size], 32, "%.9g", value);
+        };
+        /** \brief Write a number as an integer or a real number by its type */
+        template <typename V>
+        void WriteNumber(const V value) {
+          if (std::is_integral<V>::value) {
+            WriteInteger(value);
+          } else {
+            WriteReal(value);
+          }
+        };
+        /** \brief Write the bytes of a trivially copyable value */
+        template <typename V>
+        void WriteRaw(const V& value) {
+          Write(reinterpret_cast<const char*>(&value), sizeof(V));
+        };
+        void Flush(void) {
+          if (size && std::fwrite(data.data(), 1, size, file) != size) {
+            failed = true;
+          }
+          size = 0;
+        };
+        /**
+          \brief Flush and close the file, throws std::runtime_error on
+            I/O failure
+        */
+        void Close(void) {
+          Flush();
+          const bool closed = std::fclose(file) == 0;
+          file = nullptr;
+          if (failed || !closed) {
+            throw std::runtime_error("failed writing results");
+          }
+        };
+    };
+    /** \brief Writer - machine readable results of a run, one record per
+      query with the approximate and exact nearest neighbor, their search
+      times and an optional list of neighbors, e.g. top-k or radius results.
+        CSV - a header, then query,id,distance,true_id,true_distance,seconds,
+          true_seconds,neighbors with neighbors as space separated id:distance
+        JSONL - an object per line with the fields of CSV and neighbors as
+          an array of {"id","distance"} objects
+        BINARY - the magic string, the version and the sizes of T and U as
+          uint32_t, then per query: query, id, distance, true_id,
+          true_distance as U and T, seconds and true_seconds as double, the
+          number of neighbors as uint32_t and the id and distance of each
+      Not found queries have the max value of T as distance and queries that
+      were not timed -1 seconds.
+    */
+    template <typename T, typename U>
+    class Writer {
+      private:
+        Buffer buffer;
+        const Format format;
+      public:
+        /** \brief Writer class constructor
+          @par const std::string& file_name - Path to the result file
+          @par const Format format - CSV, JSONL or BINARY
+          throws std::runtime_error if the file can not be created
+        */
+        Writer(const std::string& file_name, const Format format) :
+          buffer(file_name), format(format) {
+
+          if (format == CSV) {
+            buffer.Write("query,id,distance,true_id,true_distance,seconds,"
+                         "true_seconds,neighbors\n");
+          } else if (format == BINARY) {
+            buffer.Write(kResultsMagic);
+            buffer.WriteRaw(kResultsVersion);
+            buffer.WriteRaw((uint32_t) sizeof(T));
+            buffer.WriteRaw((uint32_t) sizeof(U));
+          }
+        };
+        /**
+          \brief Writer default destructor
+        */
+        ~Writer() = default;
+        /** \brief Write the record of a query
+          @par const U query - id of the query
+          @par approx, exact - distance, id and seconds of the approximate
+            and of the exact nearest neighbor
+          @par neighbors - distance and id of the listed neighbors
+        */
+        void Write(const U query, const std::tuple<T,U,double>& approx,
+          const std::tuple<T,U,double>& exact,
+          const std::vector<std::pair<T,U>>& neighbors = std::vector<std::pair<T,U>>()) {
+
+          if (format == BINARY) {
+            buffer.WriteRaw(query);
+            buffer.WriteRaw(std::get<1>(approx));
+            buffer.WriteRaw(std::get<0>(approx));
+            buffer.WriteRaw(std::get<1>(exact));
+            buffer.WriteRaw(std::get<0>(exact));
+            buffer.WriteRaw(std::get<2>(approx));
+            buffer.WriteRaw(std::get<2>(exact));
+            buffer.WriteRaw((uint32_t) neighbors.size());
+            for (const auto& neighbor: neighbors) {
+              buffer.WriteRaw(neighbor.second);
+              buffer.WriteRaw(neighbor.first);
+            }
+            return;
+          }
+          const bool json = format == JSONL;
+          buffer.Write(json ? "{\"query\":" : "");
+          buffer.WriteNumber(query);
+          buffer.Write(json ? ",\"id\":" : ",");
+          buffer.WriteNumber(std::get<1>(approx));
+          buffer.Write(json ? ",\"distance\":" : ",");
+          buffer.WriteNumber(std::get<0>(approx));
+          buffer.Write(json ? ",\"true_id\":" : ",");
+          buffer.WriteNumber(std::get<1>(exact));
+          buffer.Write(json ? ",\"true_distance\":" : ",");
+          buffer.WriteNumber(std::get<0>(exact));
+          buffer.Write(json ? ",\"seconds\":" : ",");
+          buffer.WriteReal(std::get<2>(approx));
+          buffer.Write(json ? ",\"true_seconds\":" : ",");
+          buffer.WriteReal(std::get<2>(exact));
+          buffer.Write(json ? ",\"neighbors\":[" : ",");
+          for (size_t i = 0; i < neighbors.size(); ++i) {
+            if (i) {
+              buffer.Write(json ? ',' : ' ');
+            }
+            buffer.Write(json ? "{\"id\":" : "");
+            buffer.WriteNumber(neighbors[i].second);
+            buffer.Write(json ? ",\"distance\":" : ":");
+            buffer.WriteNumber(neighbors[i].first);
+            buffer.Write(json ? "}" : "");
+          }
+          buffer.Write(json ? "]}\n" : "\n");
+        };
+        /**
+          \brief Flush and close the file, throws std::runtime_error on
+            I/O failure
+        */
+        void Close(void) { buffer.Close(); };
+    };
+  }
+}
+
+#endif
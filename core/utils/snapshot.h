@@ -0,0 +1,190 @@
+#ifndef SNAPSHOT
+#define SNAPSHOT
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace utils {
+  namespace snapshot {
+    /** \brief Every array stored in a snapshot starts at a multiple of
+      kAlignment bytes, so that it can be used in place after mmap
+    */
+    constexpr size_t kAlignment = 8;
+    /** \brief MappedFile - read only memory mapping of a whole file.
+      The mapping is released when the object is destroyed, so structures
+      pointing into it keep a shared_ptr to the MappedFile.
+    */
+    class MappedFile {
+      private:
+        const uint8_t *data;
+        size_t size;
+      public:
+        /** \brief MappedFile class constructor
+          @par const std::string& file_name - Path to the file to be mapped
+          throws std::runtime_error if the file can not be opened or mapped
+        */
+        explicit MappedFile(const std::string& file_name) : data(nullptr), size(0) {
+          int fd = open(file_name.c_str(), O_RDONLY);
+          if (fd < 0) {
+            throw std::runtime_error("can not open " + file_name);
+          }
+          struct stat st;
+          if (fstat(fd, &st) < 0 || st.st_size == 0) {
+            close(fd);
+            throw std::runtime_error("can not stat " + file_name);
+          }
+          size = st.st_size;
+          void *addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+          close(fd);
+          if (addr == MAP_FAILED) {
+            throw std::runtime_error("can not mmap " + file_name);
+          }
+          data = static_cast<const uint8_t*>(addr);
+        };
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        /**
+          \brief MappedFile class destructor unmaps the file
+        */
+        ~MappedFile() {
+          munmap(const_cast<uint8_t*>(data), size);
+        };
+        const uint8_t* Data(void) const { return data; };
+        size_t Size(void) const { return size; };
+    };
+    /** \brief Reader - sequential reader over a MappedFile.
+      Scalars are copied out, arrays are returned as pointers into the mapping.
+    */
+    class Reader {
+      private:
+        std::shared_ptr<const MappedFile> file;
+        size_t cursor;
+
+        void Require(const size_t bytes) {
+          if (bytes > Remaining()) {
+            throw std::runtime_error("truncated snapshot");
+          }
+        };
+      public:
+        explicit Reader(std::shared_ptr<const MappedFile> file)
+          : file(file), cursor(0) {};
+        /**
+          \brief Read a single trivially copyable value
+        */
+        template <typename V>
+        V Read(void) {
+          V value;
+          Require(sizeof(V));
+          std::memcpy(&value, file->Data() + cursor, sizeof(V));
+          cursor += sizeof(V);
+          return value;
+        };
+        /**
+          \brief Get a pointer to an aligned array of n values
+        */
+        template <typename V>
+        const V* ReadArray(const size_t n) {
+          cursor = (cursor + kAlignment - 1) / kAlignment * kAlignment;
+          // n * sizeof(V) may overflow, so the bytes left are divided instead
+          if (n > Remaining() / sizeof(V)) {
+            throw std::runtime_error("truncated snapshot");
+          }
+          const V* array = reinterpret_cast<const V*>(file->Data() + cursor);
+          cursor += n * sizeof(V);
+          return array;
+        };
+        /**
+          \brief Check the magic string at the current position
+        */
+        void Expect(const char *magic) {
+          size_t n = strlen(magic);
+          Require(n);
+          if (std::memcmp(file->Data() + cursor, magic, n) != 0) {
+            throw std::runtime_error("not a snapshot of the expected type");
+          }
+          cursor += n;
+        };
+        /**
+          \brief Number of bytes after the current position
+        */
+        size_t Remaining(void) const {
+          return cursor < file->Size() ? file->Size() - cursor : 0;
+        };
+        std::shared_ptr<const MappedFile> File(void) const { return file; };
+    };
+    /** \brief Checksum - 64 bit FNV-1a over the 8 byte words of an array,
+      the last bytes of the array making up a shorter word. Checksums are
+      chained by passing the previous one as hash.
+      @par const void *data - array to be hashed
+      @par const size_t bytes - size of the array in bytes
+      @par uint64_t hash - checksum of the preceding arrays
+    */
+    inline uint64_t Checksum(const void *data, const size_t bytes,
+      uint64_t hash = 0xCBF29CE484222325ULL) {
+      const uint8_t *bytes_data = static_cast<const uint8_t*>(data);
+      for (size_t i = 0; i < bytes; i += sizeof(uint64_t)) {
+        uint64_t word = 0;
+        std::memcpy(&word, bytes_data + i, std::min(sizeof(uint64_t), bytes - i));
+        hash = (hash ^ word) * 0x100000001B3ULL;
+      }
+      return hash;
+    }
+    /** \brief Writer - sequential binary writer producing files
+      readable by Reader
+    */
+    class Writer {
+      private:
+        std::ofstream out;
+        size_t cursor;
+      public:
+        /** \brief Writer class constructor
+          throws std::runtime_error if the file can not be created
+        */
+        explicit Writer(const std::string& file_name)
+          : out(file_name, std::ios::binary | std::ios::trunc), cursor(0) {
+          if (!out) {
+            throw std::runtime_error("can not create " + file_name);
+          }
+        };
+        template <typename V>
+        void Write(const V& value) {
+          out.write(reinterpret_cast<const char*>(&value), sizeof(V));
+          cursor += sizeof(V);
+        };
+        template <typename V>
+        void WriteArray(const V *array, const size_t n) {
+          static const char zeros[kAlignment] = {};
+          size_t padding = (kAlignment - cursor % kAlignment) % kAlignment;
+          out.write(zeros, padding);
+          out.write(reinterpret_cast<const char*>(array), n * sizeof(V));
+          cursor += padding + n * sizeof(V);
+        };
+        void WriteMagic(const char *magic) {
+          out.write(magic, strlen(magic));
+          cursor += strlen(magic);
+        };
+        /**
+          \brief Flush the file, throws std::runtime_error on I/O failure
+        */
+        void Close(void) {
+          out.close();
+          if (!out) {
+            throw std::runtime_error("failed writing snapshot");
+          }
+        };
+    };
+  }
+}
+
+#endif
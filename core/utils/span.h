@@ -0,0 +1,33 @@
+#ifndef SPAN
+#define SPAN
+
+#include <cstddef>
+#include <vector>
+
+namespace utils {
+  /** \brief Span - read only view of n consecutive values, owned either by
+    a std::vector or by a larger arena. It has the size(), data() and
+    operator[] of a std::vector, so it can replace a const std::vector&.
+  */
+  template <typename T>
+  class Span {
+    private:
+      const T *values;
+      size_t length;
+    public:
+      Span() : values(nullptr), length(0) {};
+      Span(const T *values, const size_t length) :
+        values(values), length(length) {};
+      Span(const std::vector<T>& values) :
+        values(values.data()), length(values.size()) {};
+
+      const T& operator[](const size_t i) const { return values[i]; };
+      const T* data(void) const { return values; };
+      size_t size(void) const { return length; };
+      bool empty(void) const { return length == 0; };
+      const T* begin(void) const { return values; };
+      const T* end(void) const { return values + length; };
+  };
+}
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef TIMING
+#define TIMING
+
+#include <chrono>
+#include <cstdint>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace utils {
+  namespace timing {
+    /* seconds reported for a query that was not timed */
+    constexpr double kNotTimed = -1.0;
+    /** \brief None - timing policy of the engines when per-query timing is
+      disabled. No clock is read and every query is reported as kNotTimed,
+      so callers time their batch of queries instead.
+      Every policy has a Calibrate, called by the engines when they are
+      built and by the callers of the search functions before any query.
+    */
+    struct None {
+      typedef int Stamp;
+      static void Calibrate(void) {};
+      static Stamp Start(void) { return 0; };
+      static double Stop(const Stamp) { return kNotTimed; };
+    };
+    /** \brief Clock - timing policy reading high_resolution_clock at the
+      start and at the end of every query
+    */
+    struct Clock {
+      typedef std::chrono::high_resolution_clock::time_point Stamp;
+      static void Calibrate(void) {};
+      static Stamp Start(void) {
+        return std::chrono::high_resolution_clock::now();
+      };
+      static double Stop(const Stamp start) {
+        return std::chrono::duration_cast<std::chrono::duration<double>>(
+          std::chrono::high_resolution_clock::now() - start).count();
+      };
+    };
+    /** \brief returns: the time stamp counter of the cpu, or the ticks of
+      steady_clock where there is none
+    */
+    inline uint64_t Ticks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+      return __rdtsc();
+#else
+      return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+    }
+    /** \brief returns: Ticks per second, calibrated once against
+      steady_clock over a few milliseconds
+    */
+    inline double TicksPerSecond(void) {
+      static const double ticks_per_second = []() {
+        auto start = std::chrono::steady_clock::now();
+        const uint64_t ticks = Ticks();
+        std::chrono::duration<double> elapsed{};
+        do {
+          elapsed = std::chrono::steady_clock::now() - start;
+        } while (elapsed.count() < 0.01);
+        return (Ticks() - ticks) / elapsed.count();
+      }();
+      return ticks_per_second;
+    }
+    /** \brief Sampled - timing policy reading the time stamp counter for
+      one query in every kPeriod queries of a thread. The other queries are
+      reported as kNotTimed and left out of the latency percentiles.
+      Calibrate measures TicksPerSecond, so that it is not measured by the
+      first timed query.
+    */
+    template <uint32_t kPeriod>
+    struct Sampled {
+      typedef uint64_t Stamp;
+      static void Calibrate(void) { TicksPerSecond(); };
+      static Stamp Start(void) {
+        static thread_local uint32_t queries = 0;
+        return queries++ % kPeriod == 0 ? Ticks() : 0;
+      };
+      static double Stop(const Stamp start) {
+        if (start == 0) {
+          return kNotTimed;
+        }
+        return (Ticks() - start) / TicksPerSecond();
+      };
+    };
+  }
+  /* timing policy of the engines, Clock unless built with
+     -DQUERY_TIMING_NONE or -DQUERY_TIMING_SAMPLED */
+#if defined(QUERY_TIMING_NONE)
+  typedef timing::None QueryTiming;
+#elif defined(QUERY_TIMING_SAMPLED)
+  typedef timing::Sampled<16> QueryTiming;
+#else
+  typedef timing::Clock QueryTiming;
+#endif
+}
+
+#endif
@@ -0,0 +1,152 @@
+#ifndef CANDIDATES
+#define CANDIDATES
+
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "../../../core/metric/metric.h"
+#include "../../../core/search/hypercube.h"
+#include "../../../core/utils/counters.h"
+#include "../../../core/utils/parallel.h"
+
+namespace search {
+  namespace curves {
+    /** \brief CurveCandidates - union of the candidate curves returned by
+      several structures for the same query. Each candidate is kept once and
+      scored once, in increasing order of a DTW lower bound, so candidates
+      whose lower bound is not below the best distance found are skipped.
+      Structures may index the dataset curves differently, so a candidate is
+      identified by the offset of its first point in the dataset curves.
+      Counters counts the unique candidates, the pruned and the abandoned
+      ones and the distances evaluated.
+    */
+    template <typename T, typename U,
+              typename Counters = utils::SearchCounters>
+    class CurveCandidates {
+      private:
+        /* offset, length and id of a candidate curve */
+        struct Candidate {
+          int offset;
+          int length;
+          U id;
+        };
+        const std::vector<std::pair<T,T>>& input_curves;
+
+        std::vector<Candidate> candidates;
+        VisitedSet& visited;
+
+        /* candidates scored by a task at a time */
+        static constexpr size_t kGrain = 8;
+        /* candidates below which they are scored serially */
+        static constexpr size_t kParallelCandidates = 64;
+
+        /**
+          \brief Set of the calling thread, distinct from VisitedSet::Local()
+            which is used by the structures while candidates are inserted
+        */
+        static VisitedSet& Local(void) {
+          static thread_local VisitedSet local;
+          return local;
+        };
+      public:
+        /** \brief class CurveCandidates constructor
+          @par const std::vector<std::pair<T,T>>& curves - dataset curves of
+            the structures
+        */
+        CurveCandidates(const std::vector<std::pair<T,T>>& curves) :
+          input_curves(curves), visited(Local()) {
+
+          visited.Reset(curves.size());
+        };
+        /**
+          \brief class CurveCandidates default destructor
+        */
+        ~CurveCandidates() = default;
+        /** \brief Add candidate of a structure, if it is not already a candidate
+          @par const Structure& structure - LSH or HyperCube of the candidate
+          @par const uint32_t of - candidate offset visited by the structure
+        */
+        template <typename Structure>
+        void Insert(const Structure& structure, const uint32_t of) {
+          Insert(structure.GetOffsets()[of], structure.GetLengths()[of],
+                 structure.GetIds()[of]);
+        };
+        /** \brief Add candidate curve given its offset, length and id, if it
+          is not already a candidate
+        */
+        void Insert(const int offset, const int length, const U id) {
+          if (visited.Insert(offset)) {
+            Counters::Add(utils::counters::UNIQUE_CANDIDATES);
+            candidates.push_back(Candidate{offset, length, id});
+          }
+        };
+        size_t Size(void) const { return candidates.size(); };
+        /** \brief Executes Nearest Neighbor over the candidates. Candidates
+          are scored by parallel tasks of the shared pool, or serially if
+          there are fewer than kParallelCandidates, in increasing order of
+          their lower bound. The tasks share the best distance found so far: candidates
+          whose lower bound exceeds it are skipped and the DTW of the others
+          is abandoned once it exceeds it. Ties are broken in favour of the
+          candidate with the smaller lower bound, so the result does not
+          depend on the number of threads.
+          @par iterator q - iterator of the query curve
+          @par iterator q_end - end iterator of query curve
+          returns: min_dist and min_id, or the max value of T if there are no
+            candidates
+        */
+        template <typename iterator>
+        std::pair<T,U> NearestNeighbor(iterator q, iterator q_end) const {
+          std::vector<std::pair<T,uint32_t>> bounds;
+          bounds.reserve(candidates.size());
+          for (size_t i = 0; i < candidates.size(); ++i) {
+            auto p = std::next(input_curves.begin(), candidates[i].offset);
+            auto p_end = std::next(p, candidates[i].length);
+            bounds.push_back(std::make_pair(
+              metric::DTWLowerBound<T>(p, p_end, q, q_end), i));
+          }
+          std::sort(bounds.begin(), bounds.end());
+
+          std::atomic<T> best(std::numeric_limits<T>::max());
+          std::mutex mutex;
+          T min_dist = std::numeric_limits<T>::max();
+          size_t min_rank = bounds.size();
+          utils::parallel::ParallelFor(bounds.size(), kGrain,
+                                       [&](const size_t rank) {
+            if (bounds[rank].first > best.load(std::memory_order_relaxed)) {
+              Counters::Add(utils::counters::LOWER_BOUND_PRUNES);
+              return;
+            }
+            const Candidate& candidate = candidates[bounds[rank].second];
+            auto p = std::next(input_curves.begin(), candidate.offset);
+            auto p_end = std::next(p, candidate.length);
+            const T dist = metric::DTWDistance<T>(p, p_end, q, q_end,
+              best.load(std::memory_order_relaxed));
+            Counters::Add(utils::counters::DISTANCES);
+            if (dist == std::numeric_limits<T>::max()) {
+              Counters::Add(utils::counters::EARLY_ABANDONS);
+            }
+            if (dist > best.load(std::memory_order_relaxed)) {
+              return;
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            if (dist < min_dist || (dist == min_dist && rank < min_rank)) {
+              min_dist = dist;
+              min_rank = rank;
+              best.store(dist, std::memory_order_relaxed);
+            }
+          }, kParallelCandidates);
+          if (min_rank == bounds.size()) {
+            return std::make_pair(std::numeric_limits<T>::max(), U{});
+          }
+          return std::make_pair(min_dist, candidates[bounds[min_rank].second].id);
+        };
+    };
+  }
+}
+
+#endif
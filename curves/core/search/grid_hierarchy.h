@@ -0,0 +1,114 @@
+#ifndef GRID_HIERARCHY
+#define GRID_HIERARCHY
+
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "../../../core/search/hypercube.h"
+#include "../../../core/utils/ragged.h"
+#include "../vectorization/vectorization.h"
+#include "grid_index.h"
+
+namespace search {
+  namespace curves {
+    /** \brief GridHierarchy - grids of geometrically increasing delta, each
+      one with an exact index of the grid curves of the dataset. A query is
+      looked up from the finest to the coarsest level and stops as soon as
+      enough candidates have been found, so dense regions are answered by
+      fine grids and sparse regions fall back to coarse grids.
+    */
+    template <typename T, typename U>
+    class GridHierarchy {
+      private:
+        const uint32_t min_candidates;
+
+        const std::vector<U>& input_curves_ids;
+        const std::vector<int>& input_curves_lengths;
+
+        std::vector<vectorization::Grid<T>> grids;
+        std::vector<utils::Ragged<double>> grid_curves;
+        std::vector<std::unique_ptr<GridIndex<T,U>>> indices;
+      public:
+        /** \brief class GridHierarchy constructor
+          @par const uint8_t levels - number of grids
+          @par const double delta - delta of the finest grid
+          @par const double ratio - delta of level l is delta * ratio^l
+          @par const uint32_t min_candidates - candidates needed to stop at a level
+          @par const uint32_t N - number of dataset curves
+          @par const uint32_t D - dimension of the grid curves
+        */
+        GridHierarchy(const uint8_t levels, const double delta,
+          const double ratio, const uint32_t min_candidates,
+          const std::vector<std::pair<T,T>>& curves, const std::vector<U>& ids,
+          const std::vector<int>& lengths, const std::vector<int>& offsets,
+          const uint32_t N, const uint32_t D) :
+          min_candidates(min_candidates), input_curves_ids(ids),
+          input_curves_lengths(lengths) {
+
+          double level_delta = delta;
+          for (size_t l = 0; l < levels; ++l, level_delta *= ratio) {
+            grids.push_back(vectorization::Grid<T>(curves, lengths, offsets,
+                                                   N, D, level_delta));
+          }
+          grid_curves = vectorization::Vectorize(grids, N, curves, lengths, offsets);
+          for (size_t l = 0; l < levels; ++l) {
+            indices.emplace_back(new GridIndex<T,U>(grid_curves[l], curves, ids,
+                                                    lengths, offsets));
+          }
+        };
+        GridHierarchy(const GridHierarchy&) = delete;
+        GridHierarchy& operator=(const GridHierarchy&) = delete;
+        /**
+          \brief class GridHierarchy default destructor
+        */
+        ~GridHierarchy() = default;
+        /** \brief Executes coarse to fine Nearest Neighbor. Candidates of all
+          levels visited are scored once each.
+          @par const int idx - index to current query
+          @par std::pair<T,U>& result - min_dist and min_id to be returned
+          returns: false if the query has no exact grid match in any level
+        */
+        bool NearestNeighbor(const std::vector<std::pair<T,T>>& query_curves,
+          const std::vector<int>& query_curves_lengths,
+          const std::vector<int>& query_curves_offsets, const int idx,
+          std::pair<T,U>& result) const {
+
+          const std::pair<T,T> *query = &query_curves[query_curves_offsets[idx]];
+          const int length = query_curves_lengths[idx];
+          std::vector<double> query_grid(2 * length);
+          std::vector<uint32_t> candidates;
+          VisitedSet& visited = VisitedSet::Local();
+          visited.Reset(input_curves_lengths.size());
+          for (size_t l = 0; l < grids.size() && candidates.size() < min_candidates; ++l) {
+            const uint32_t size = grids[l].Snap(query, length, query_grid.data());
+            indices[l]->Find(query_grid.data(), size, [&](const uint32_t i) {
+              if (visited.Insert(i)) {
+                candidates.push_back(i);
+              }
+            });
+          }
+          if (candidates.empty()) {
+            return false;
+          }
+          auto q = std::next(query_curves.begin(), query_curves_offsets[idx]);
+          auto q_end = std::next(q, length);
+          result = std::make_pair(std::numeric_limits<T>::max(), U{});
+          for (const auto& i: candidates) {
+            T dist = indices[0]->Distance(i, q, q_end);
+            if (dist < result.first) {
+              result = std::make_pair(dist, input_curves_ids[i]);
+            }
+            if (dist == T{}) {
+              break;
+            }
+          }
+          return true;
+        };
+        uint8_t GetLevels(void) const { return grids.size(); };
+    };
+  }
+}
+
+#endif
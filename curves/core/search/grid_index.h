@@ -0,0 +1,135 @@
+#ifndef GRID_INDEX
+#define GRID_INDEX
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "../../../core/metric/metric.h"
+#include "../../../core/utils/ragged.h"
+
+namespace search {
+  namespace curves {
+    /** \brief GridIndex - exact index of the grid curves of one grid.
+      Curves snapped to the same grid curve are exact grid matches, so they
+      are found by a hash table keyed by a rolling hash of the snapped,
+      deduplicated coordinates, in O(length) and before any LSH probing.
+    */
+    template <typename T, typename U>
+    class GridIndex {
+      private:
+        const utils::Ragged<double>& grid_curves;
+        const std::vector<std::pair<T,T>>& input_curves;
+        const std::vector<U>& input_curves_ids;
+        const std::vector<int>& input_curves_lengths;
+        const std::vector<int>& input_curves_offsets;
+
+        std::unordered_map<uint64_t,std::vector<uint32_t>> table;
+      public:
+        /** \brief Rolling hash of a grid curve
+          @par const double *coordinates - snapped coordinates
+          @par const size_t length - number of coordinates
+        */
+        static uint64_t Hash(const double *coordinates, const size_t length) {
+          uint64_t hash_value = length;
+          for (size_t i = 0; i < length; ++i) {
+            // + 0.0 maps -0.0 to 0.0, as they are the same grid coordinate
+            const double x = coordinates[i] + 0.0;
+            uint64_t bits;
+            std::memcpy(&bits, &x, sizeof(bits));
+            hash_value = (hash_value ^ bits) * 0x100000001B3ULL;
+            hash_value ^= hash_value >> 29;
+          }
+          return hash_value;
+        };
+        /** \brief class GridIndex constructor
+          @par const utils::Ragged<double>& grid - grid curves of the dataset
+          rest of parameters describe the dataset curves
+        */
+        GridIndex(const utils::Ragged<double>& grid,
+          const std::vector<std::pair<T,T>>& curves, const std::vector<U>& ids,
+          const std::vector<int>& lengths, const std::vector<int>& offsets) :
+          grid_curves(grid), input_curves(curves), input_curves_ids(ids),
+          input_curves_lengths(lengths), input_curves_offsets(offsets) {
+
+          table.reserve(grid.Size());
+          for (size_t i = 0; i < grid.Size(); ++i) {
+            table[Hash(grid.Data(i), grid.Length(i))].push_back(i);
+          }
+        };
+        /**
+          \brief class GridIndex default destructor
+        */
+        ~GridIndex() = default;
+        /** \brief Visit the curves with the given grid curve
+          @par const double *grid_curve - snapped coordinates of the grid curve
+          @par const size_t length - number of coordinates
+          @par Visit visit - called with the offset of each matching curve
+        */
+        template <typename Visit>
+        void Find(const double *grid_curve, const size_t length,
+          Visit visit) const {
+
+          auto bucket = table.find(Hash(grid_curve, length));
+          if (bucket == table.end()) {
+            return;
+          }
+          for (const auto& i: bucket->second) {
+            // skip hash collisions
+            if (grid_curves.Length(i) == length &&
+                std::equal(grid_curve, grid_curve + length, grid_curves.Data(i))) {
+              visit(i);
+            }
+          }
+        };
+        /** \brief Find the nearest of the curves with the same grid curve as
+          the query. A curve equal to the query is returned without
+          computing any DTW distance.
+          @par const utils::Ragged<double>& query_grid - grid curves of the queries
+          @par const int offset - Offset to get correspodent query
+          @par std::pair<T,U>& result - min_dist and min_id to be returned
+          returns: false if no curve has the grid curve of the query
+        */
+        bool NearestNeighbor(const utils::Ragged<double>& query_grid,
+          const int offset, const std::vector<std::pair<T,T>>& query_curves,
+          const std::vector<int>& query_curves_lengths,
+          const std::vector<int>& query_curves_offsets,
+          std::pair<T,U>& result) const {
+
+          auto q = std::next(query_curves.begin(), query_curves_offsets[offset]);
+          auto q_end = std::next(q, query_curves_lengths[offset]);
+          bool found = false;
+          result = std::make_pair(std::numeric_limits<T>::max(), U{});
+          Find(query_grid.Data(offset), query_grid.Length(offset),
+               [&](const uint32_t i) {
+            if (found && result.first == T{}) {
+              return;
+            }
+            found = true;
+            T dist = Distance(i, q, q_end);
+            if (dist < result.first) {
+              result = std::make_pair(dist, input_curves_ids[i]);
+            }
+          });
+          return found;
+        };
+        /** \brief DTW distance of dataset curve i and a query curve, 0 without
+          computing DTW when the curves are equal
+        */
+        template <typename iterator>
+        T Distance(const uint32_t i, iterator q, iterator q_end) const {
+          auto p = std::next(input_curves.begin(), input_curves_offsets[i]);
+          auto p_end = std::next(p, input_curves_lengths[i]);
+          if (p_end - p == q_end - q && std::equal(p, p_end, q)) {
+            return T{};
+          }
+          return metric::DTWDistance<T>(p, p_end, q, q_end);
+        };
+    };
+  }
+}
+
+#endif
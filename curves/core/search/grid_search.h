@@ -5,9 +5,41 @@
 
 #include "../../../core/search/lsh.h"
 #include "../../../core/search/hypercube.h"
+#include "candidates.h"
+#include "grid_hierarchy.h"
+#include "grid_index.h"
 
 namespace search {
   namespace curves {
+    /** \brief Look up the query's grid curve in the exact index of every grid
+      @par grid_indices - vector of L_grid exact grid indices
+      @par std::pair<T,U>& result - min_dist and min_id over all exact matches
+      returns: false if the query has no exact grid match in any grid
+    */
+    template <typename T, typename U>
+    bool grid_exact_search(const uint8_t L_grid,
+      const std::vector<search::curves::GridIndex<T,U>>& grid_indices,
+      const std::vector<std::pair<T,T>>& query_curves,
+      const std::vector<int>& query_curves_lengths,
+      const std::vector<int>& query_curves_offsets,
+      const std::vector<utils::Ragged<double>>& L_grid_query_vectors,
+      const int idx, std::pair<T,U>& result) {
+
+        bool found = false;
+        result = std::make_pair(std::numeric_limits<T>::max(), U{});
+        std::pair<T,U> grid_result{};
+        for (size_t i = 0; i < L_grid && result.first > T{}; ++i) {
+          if (grid_indices[i].NearestNeighbor(L_grid_query_vectors[i], idx,
+                query_curves, query_curves_lengths, query_curves_offsets,
+                grid_result)) {
+            found = true;
+            if (grid_result.first < result.first) {
+              result = grid_result;
+            }
+          }
+        }
+        return found;
+    }
     /** \brief Executes LSH grid search to compute approximate nearest neighbor
       in curves
       @par L_grid - number of grids
@@ -15,40 +47,57 @@ namespace search {
       @par L_grid_query_vectors - each query curve corresponds to L_grid query
         vectors
       @par idx - index to current query
+      @par grid_indices - if not null, exact grid matches are returned first
+      @par grid_hierarchy - if not null, searched coarse to fine after
+        grid_indices
     */
-    template <typename T, typename U>
+    template <typename T, typename U, typename Counters,
+              typename Timing = utils::QueryTiming>
     std::tuple<T,U,double> grid_search(const uint8_t L_grid,
-      std::vector<search::curves::LSH<T,U>>& lsh_structures,
+      std::vector<search::curves::LSH<T,U,Counters>>& lsh_structures,
       const std::vector<std::pair<T,T>>& query_curves,
       const std::vector<int>& query_curves_lengths,
       const std::vector<int>& query_curves_offsets,
-      const std::vector<std::vector<double>>& L_grid_query_vectors,
-      const int idx) {
+      const std::vector<utils::Ragged<double>>& L_grid_query_vectors,
+      const int idx,
+      const std::vector<search::curves::GridIndex<T,U>> *grid_indices = nullptr,
+      const search::curves::GridHierarchy<T,U> *grid_hierarchy = nullptr) {
 
-        auto start = high_resolution_clock::now();
+        const typename Timing::Stamp start = Timing::Start();
         /* Initialize min_dist to max value of type T */
         T min_dist = std::numeric_limits<T>::max();
         /* Initialize correspodent min_id using the C++11 way */
         U min_id{};
-        /* Lsh returns a pair of min dist and min id found */
-        std::pair<T,U> lsh_result{};
-        for (size_t i = 0; i < L_grid; ++i) {
-          lsh_result = lsh_structures[i].NearestNeighbor(L_grid_query_vectors[i],
-                                        idx, query_curves, query_curves_lengths,
-                                        query_curves_offsets);
-          /* get dist and id return by current lsh NN */
-          T dist = std::get<0>(lsh_result);
-          U id = std::get<1>(lsh_result);
-          /* Check if we have found a better neighbor */
-          if (dist < min_dist) {
-            min_dist = dist;
-            min_id = id;
+        Counters::Add(utils::counters::QUERIES);
+        /* Exact grid matches answer the query without any probing */
+        std::pair<T,U> exact_result{};
+        if ((grid_indices != nullptr &&
+             grid_exact_search(L_grid, *grid_indices, query_curves,
+                               query_curves_lengths, query_curves_offsets,
+                               L_grid_query_vectors, idx, exact_result)) ||
+            (grid_hierarchy != nullptr &&
+             grid_hierarchy->NearestNeighbor(query_curves, query_curves_lengths,
+                                             query_curves_offsets, idx,
+                                             exact_result))) {
+          return std::make_tuple(exact_result.first, exact_result.second,
+                                 Timing::Stop(start));
+        }
+        /* Union of the candidates of all lsh structures, each scored once */
+        if (L_grid > 0) {
+          CurveCandidates<T,U,Counters> candidates(lsh_structures[0].GetCurves());
+          for (size_t i = 0; i < L_grid; ++i) {
+            const auto& structure = lsh_structures[i];
+            lsh_structures[i].Candidates(L_grid_query_vectors[i], idx,
+                                           [&](const uint32_t of) {
+              candidates.Insert(structure, of);
+            });
           }
+          auto q = std::next(query_curves.begin(), query_curves_offsets[idx]);
+          std::tie(min_dist, min_id) = candidates.NearestNeighbor(q,
+                                         std::next(q, query_curves_lengths[idx]));
         }
-        auto stop = high_resolution_clock::now();
-        duration <double> total_time = duration_cast<duration<double>>(stop - start);
-        /* return result as a tuple of min_dist, min_id and total_time */
-        return std::make_tuple(min_dist,min_id,total_time.count());
+        /* return result as a tuple of min_dist, min_id and seconds taken */
+        return std::make_tuple(min_dist,min_id,Timing::Stop(start));
     }
     /** \brief Executes HyperCube grid search to compute approximate
       nearest neighbor in curves
@@ -57,41 +106,57 @@ namespace search {
       @par L_grid_query_vectors - each query curve corresponds to L_grid query
         vectors
       @par idx - index to current query
+      @par grid_indices - if not null, exact grid matches are returned first
+      @par grid_hierarchy - if not null, searched coarse to fine after
+        grid_indices
     */
-    template <typename T, typename U>
+    template <typename T, typename U, typename Counters,
+              typename Timing = utils::QueryTiming>
     std::tuple<T,U,double> grid_search(const uint8_t L_grid,
-      std::vector<search::curves::HyperCube<T,U>>& hypercube_structures,
+      std::vector<search::curves::HyperCube<T,U,Counters>>& hypercube_structures,
       const std::vector<std::pair<T,T>>& query_curves,
       const std::vector<int>& query_curves_lengths,
       const std::vector<int>& query_curves_offsets,
-      const std::vector<std::vector<double>>& L_grid_query_vectors,
-      const int idx) {
+      const std::vector<utils::Ragged<double>>& L_grid_query_vectors,
+      const int idx,
+      const std::vector<search::curves::GridIndex<T,U>> *grid_indices = nullptr,
+      const search::curves::GridHierarchy<T,U> *grid_hierarchy = nullptr) {
 
-        auto start = high_resolution_clock::now();
+        const typename Timing::Stamp start = Timing::Start();
         /* Initialize min_dist to max value of type T */
         T min_dist = std::numeric_limits<T>::max();
         /* Initialize correspodent min_id using the C++11 way */
         U min_id{};
-        /* HyperCube returns a pair of min dist and min id found */
-        std::pair<T,U> hypercube_result{};
-        for (size_t i = 0; i < L_grid; ++i) {
-          hypercube_result = hypercube_structures[i].NearestNeighbor(
-                                        L_grid_query_vectors[i],
-                                        idx, query_curves, query_curves_lengths,
-                                        query_curves_offsets);
-          /* get dist and id return by current hypercube NN */
-          T dist = std::get<0>(hypercube_result);
-          U id = std::get<1>(hypercube_result);
-          /* Check if we have found a better neighbor */
-          if (dist < min_dist) {
-            min_dist = dist;
-            min_id = id;
+        Counters::Add(utils::counters::QUERIES);
+        /* Exact grid matches answer the query without any probing */
+        std::pair<T,U> exact_result{};
+        if ((grid_indices != nullptr &&
+             grid_exact_search(L_grid, *grid_indices, query_curves,
+                               query_curves_lengths, query_curves_offsets,
+                               L_grid_query_vectors, idx, exact_result)) ||
+            (grid_hierarchy != nullptr &&
+             grid_hierarchy->NearestNeighbor(query_curves, query_curves_lengths,
+                                             query_curves_offsets, idx,
+                                             exact_result))) {
+          return std::make_tuple(exact_result.first, exact_result.second,
+                                 Timing::Stop(start));
+        }
+        /* Union of the candidates of all hypercube structures, each scored once */
+        if (L_grid > 0) {
+          CurveCandidates<T,U,Counters> candidates(hypercube_structures[0].GetCurves());
+          for (size_t i = 0; i < L_grid; ++i) {
+            const auto& structure = hypercube_structures[i];
+            hypercube_structures[i].Candidates(L_grid_query_vectors[i], idx,
+                                           [&](const uint32_t of) {
+              candidates.Insert(structure, of);
+            });
           }
+          auto q = std::next(query_curves.begin(), query_curves_offsets[idx]);
+          std::tie(min_dist, min_id) = candidates.NearestNeighbor(q,
+                                         std::next(q, query_curves_lengths[idx]));
         }
-        auto stop = high_resolution_clock::now();
-        duration <double> total_time = duration_cast<duration<double>>(stop - start);
-        /* return result as a tuple of min_dist, min_id and total_time */
-        return std::make_tuple(min_dist,min_id,total_time.count());
+        /* return result as a tuple of min_dist, min_id and seconds taken */
+        return std::make_tuple(min_dist,min_id,Timing::Stop(start));
     }
   }
 }
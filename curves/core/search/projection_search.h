@@ -2,93 +2,162 @@
 #define PROJECTION_SEARCH
 
 #include <tuple>
+#include <vector>
 
 #include "../../../core/search/lsh.h"
 #include "../../../core/search/hypercube.h"
+#include "../../../core/utils/parallel.h"
+#include "../../../core/utils/span.h"
+#include "candidates.h"
 
 namespace search {
   namespace curves {
+    /** \brief Structures probed by a task at a time */
+    constexpr size_t kProbeGrain = 4;
+    /** \brief Structures below which a query probes them serially */
+    constexpr size_t kParallelProbes = 16;
+    /** \brief Probe the structures of the traversals of a query as parallel
+      tasks of the shared pool, or serially if there are fewer than
+      kParallelProbes, and add their candidates to the union. Every task visits its own
+      structure, the candidates are merged in the order of the structures.
+      @par std::vector<Structure>& structures - LSH or HyperCube structures
+      @par CurveCandidates<T,U,Counters>& candidates - union to add
+        candidates to
+    */
+    template <typename T, typename U, typename Counters, typename Structure>
+    void ProbeStructures(std::vector<Structure>& structures,
+      const utils::Span<double>& qvectors, const int idx, const U id,
+      CurveCandidates<T,U,Counters>& candidates) {
+
+      std::vector<std::vector<uint32_t>> found(structures.size());
+      utils::parallel::ParallelFor(structures.size(), kProbeGrain,
+                                   [&](const size_t s) {
+        structures[s].Candidates(qvectors, idx, id, [&](const uint32_t of) {
+          found[s].push_back(of);
+        });
+      }, kParallelProbes);
+      for (size_t s = 0; s < structures.size(); ++s) {
+        for (const auto& of: found[s]) {
+          candidates.Insert(structures[s], of);
+        }
+      }
+    }
     /** \brief Executes LSH grid search to compute approximate nearest neighbor
       in curves
+      @par query_curves_lengths - length of the query curve, once per query vector
+      @par query_curves_offsets - offset of the query curve, once per query vector
+      @par qvectors - vectors of the query curve, one per traversal
       @par idx - index to current query
+      The unnamed int is unused, it is kept so that all projection searches
+      take the same arguments.
     */
-    template <typename T, typename U>
+    template <typename T, typename U, typename Counters,
+              typename Timing = utils::QueryTiming>
     std::tuple<T,U,double> projection_search(
-      std::unordered_map<int,std::vector<search::curves::LSH<T,U>>>& lsh_structures,
+      std::unordered_map<int,std::vector<search::curves::LSH<T,U,Counters>>>& lsh_structures,
       const std::vector<std::pair<T,T>>& query_curves,
-      const std::unordered_map<U,std::vector<int>>& query_curves_lengths,
-      const std::unordered_map<U,std::vector<int>>& query_curves_offsets,
-      const std::unordered_map<U,std::vector<double>>& qvectors,
-      const int idx, const int M, const U id) {
+      const utils::Span<int>& query_curves_lengths,
+      const utils::Span<int>& query_curves_offsets,
+      const utils::Span<double>& qvectors,
+      const int idx, const int, const U id) {
 
-        auto start = high_resolution_clock::now();
+        const typename Timing::Stamp start = Timing::Start();
         /* Initialize min_dist to max value of type T */
         T min_dist = std::numeric_limits<T>::max();
         /* Initialize correspodent min_id using the C++11 way */
         U min_id{};
-        /* Lsh returns a pair of min dist and min id found */
-        std::pair<T,U> lsh_result{};
-        if (lsh_structures.find(idx) != lsh_structures.end()) {
-          for (auto& hash_table: lsh_structures.at(idx)) {
-            lsh_result = hash_table.NearestNeighbor(qvectors.at(id),
-                                          idx, query_curves,
-                                          query_curves_lengths.at(id),
-                                          query_curves_offsets.at(id),id);
-            /* get dist and id return by current lsh NN */
-            T dist = std::get<0>(lsh_result);
-            U id = std::get<1>(lsh_result);
-            /* Check if we have found a better neighbor */
-            if (dist < min_dist) {
-              min_dist = dist;
-              min_id = id;
-            }
+        Counters::Add(utils::counters::QUERIES);
+        /* Union of the candidates of all structures of the traversals,
+           probed and scored in parallel */
+        if (lsh_structures.find(idx) != lsh_structures.end() &&
+            !lsh_structures.at(idx).empty()) {
+          auto& structures = lsh_structures.at(idx);
+          CurveCandidates<T,U,Counters> candidates(structures[0].GetCurves());
+          ProbeStructures(structures, qvectors, idx, id, candidates);
+          if (!query_curves_offsets.empty()) {
+            auto q = std::next(query_curves.begin(), query_curves_offsets[0]);
+            std::tie(min_dist, min_id) = candidates.NearestNeighbor(q,
+                                           std::next(q, query_curves_lengths[0]));
           }
         }
-        auto stop = high_resolution_clock::now();
-        duration <double> total_time = duration_cast<duration<double>>(stop - start);
-        /* return result as a tuple of min_dist, min_id and total_time */
-        return std::make_tuple(min_dist,min_id,total_time.count());
+        /* return result as a tuple of min_dist, min_id and seconds taken */
+        return std::make_tuple(min_dist,min_id,Timing::Stop(start));
+    }
+    /** \brief Executes LSH grid search as above over the tenants of a
+      SharedLSH, grouped by the column of their cells like the structures.
+      The query id is not needed, as tenants are probed by their column.
+      @par lsh_tenants - tenants of the shared LSH for each column
+    */
+    template <typename T, typename U, typename Counters,
+              typename Timing = utils::QueryTiming>
+    std::tuple<T,U,double> projection_search(SharedLSH<T,U,Counters>& lsh,
+      const std::unordered_map<int,std::vector<uint32_t>>& lsh_tenants,
+      const std::vector<std::pair<T,T>>& query_curves,
+      const utils::Span<int>& query_curves_lengths,
+      const utils::Span<int>& query_curves_offsets,
+      const utils::Span<double>& qvectors,
+      const int idx, const int, const U) {
+
+        const typename Timing::Stamp start = Timing::Start();
+        /* Initialize min_dist to max value of type T */
+        T min_dist = std::numeric_limits<T>::max();
+        /* Initialize correspodent min_id using the C++11 way */
+        U min_id{};
+        Counters::Add(utils::counters::QUERIES);
+        auto group = lsh_tenants.find(idx);
+        if (group != lsh_tenants.end() && !query_curves_offsets.empty()) {
+          CurveCandidates<T,U,Counters> candidates(lsh.GetCurves());
+          lsh.Candidates(group->second, qvectors, idx,
+                         [&](const uint32_t tenant, const uint32_t of) {
+            candidates.Insert(lsh.GetOffsets(tenant)[of],
+                              lsh.GetLengths(tenant)[of],
+                              lsh.GetIds(tenant)[of]);
+          });
+          auto q = std::next(query_curves.begin(), query_curves_offsets[0]);
+          std::tie(min_dist, min_id) = candidates.NearestNeighbor(q,
+                                         std::next(q, query_curves_lengths[0]));
+        }
+        /* return result as a tuple of min_dist, min_id and seconds taken */
+        return std::make_tuple(min_dist,min_id,Timing::Stop(start));
     }
     /** \brief Executes hypercube grid search to compute approximate nearest
       neighbor in curves
+      @par query_curves_lengths - length of the query curve, once per query vector
+      @par query_curves_offsets - offset of the query curve, once per query vector
+      @par qvectors - vectors of the query curve, one per traversal
       @par idx - index to current query
     */
-    template <typename T, typename U>
+    template <typename T, typename U, typename Counters,
+              typename Timing = utils::QueryTiming>
     std::tuple<T,U,double> projection_search(
-      std::unordered_map<int,std::vector<search::curves::HyperCube<T,U>>>& lsh_structures,
+      std::unordered_map<int,std::vector<search::curves::HyperCube<T,U,Counters>>>& lsh_structures,
       const std::vector<std::pair<T,T>>& query_curves,
-      const std::unordered_map<U,std::vector<int>>& query_curves_lengths,
-      const std::unordered_map<U,std::vector<int>>& query_curves_offsets,
-      const std::unordered_map<U,std::vector<double>>& qvectors,
-      const int idx, const int M, const U id) {
+      const utils::Span<int>& query_curves_lengths,
+      const utils::Span<int>& query_curves_offsets,
+      const utils::Span<double>& qvectors,
+      const int idx, const int, const U id) {
 
-        auto start = high_resolution_clock::now();
+        const typename Timing::Stamp start = Timing::Start();
         /* Initialize min_dist to max value of type T */
         T min_dist = std::numeric_limits<T>::max();
         /* Initialize correspodent min_id using the C++11 way */
         U min_id{};
-        /* Lsh returns a pair of min dist and min id found */
-        std::pair<T,U> lsh_result{};
-        if (lsh_structures.find(idx) != lsh_structures.end()) {
-          for (auto& hash_table: lsh_structures.at(idx)) {
-            lsh_result = hash_table.NearestNeighbor(qvectors.at(id),
-                                          idx, query_curves,
-                                          query_curves_lengths.at(id),
-                                          query_curves_offsets.at(id),id);
-            /* get dist and id return by current lsh NN */
-            T dist = std::get<0>(lsh_result);
-            U id = std::get<1>(lsh_result);
-            /* Check if we have found a better neighbor */
-            if (dist < min_dist) {
-              min_dist = dist;
-              min_id = id;
-            }
+        Counters::Add(utils::counters::QUERIES);
+        /* Union of the candidates of all structures of the traversals,
+           probed and scored in parallel */
+        if (lsh_structures.find(idx) != lsh_structures.end() &&
+            !lsh_structures.at(idx).empty()) {
+          auto& structures = lsh_structures.at(idx);
+          CurveCandidates<T,U,Counters> candidates(structures[0].GetCurves());
+          ProbeStructures(structures, qvectors, idx, id, candidates);
+          if (!query_curves_offsets.empty()) {
+            auto q = std::next(query_curves.begin(), query_curves_offsets[0]);
+            std::tie(min_dist, min_id) = candidates.NearestNeighbor(q,
+                                           std::next(q, query_curves_lengths[0]));
           }
         }
-        auto stop = high_resolution_clock::now();
-        duration <double> total_time = duration_cast<duration<double>>(stop - start);
-        /* return result as a tuple of min_dist, min_id and total_time */
-        return std::make_tuple(min_dist,min_id,total_time.count());
+        /* return result as a tuple of min_dist, min_id and seconds taken */
+        return std::make_tuple(min_dist,min_id,Timing::Stop(start));
     }
   }
 }
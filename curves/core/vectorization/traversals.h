@@ -0,0 +1,173 @@
+#ifndef TRAVERSALS
+#define TRAVERSALS
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "../../../core/utils/ragged.h"
+#include "../../../core/utils/snapshot.h"
+
+namespace vectorization {
+  /** \brief Magic string and version of traversals cache files */
+  constexpr const char* kTraversalsMagic = "TRAVERSALS";
+  constexpr uint32_t kTraversalsVersion = 1;
+  /** \brief Traversals - relevant traversals of the cells of the free space
+    of two curves. The traversals of cell (i,j) are all the monotone paths
+    from (0,0) to (i,j) which consist of cells crossed by the diagonal line
+    segment or lying right before them. Only cells whose row and column
+    differ by less than band have traversals. The traversals of a cell are
+    computed on its first use and kept for later uses.
+    Paths of a cell are stored flat: path k is the run of coordinates
+    Data(k)[0..Length(k)), holding row0, column0, row1, column1, ...
+  */
+  class Traversals {
+    private:
+      uint32_t band;
+      std::unordered_map<uint64_t,utils::Ragged<uint32_t>> cells;
+
+      static uint64_t Key(const uint32_t i, const uint32_t j) {
+        return static_cast<uint64_t>(i) << 32 | j;
+      };
+      /** \brief Enumerates the relevant traversals of cell (i,j) in the order
+        right, up, diagonal, using an explicit stack instead of recursion
+      */
+      static utils::Ragged<uint32_t> Compute(const uint32_t i, const uint32_t j) {
+        const int m = i + 1, n = j + 1;
+        // cells crossed by the diagonal line segment and their left neighbors
+        std::unordered_set<uint64_t> relevant;
+        auto insert = [&](const int x, const int y) {
+          relevant.insert(Key(x, y));
+          if (x != 0) {
+            relevant.insert(Key(x - 1, y));
+          }
+        };
+        for (int xi = 0; xi < m; xi++) {
+          insert(xi, round((double) n / m * (double) xi));
+        }
+        for (int yi = 0; yi < n; yi++) {
+          insert(round((double) m / n * (double) yi), yi);
+        }
+        auto is_relevant = [&](const int x, const int y) {
+          return x < m && y < n && relevant.count(Key(x, y)) != 0;
+        };
+
+        utils::Ragged<uint32_t> paths;
+        paths.offsets.push_back(0);
+        // path[k] is the k-th cell of the current path, move[k] its next move
+        std::vector<uint32_t> path{0, 0};
+        std::vector<uint8_t> move{0};
+        static const int dx[3] = {1, 0, 1};
+        static const int dy[3] = {0, 1, 1};
+        while (!move.empty()) {
+          const int x = path[path.size() - 2], y = path.back();
+          if (x == m - 1 && y == n - 1) {
+            paths.values.insert(paths.values.end(), path.begin(), path.end());
+            paths.offsets.push_back(paths.values.size());
+            move.back() = 3;
+          }
+          if (move.back() == 3) {
+            path.resize(path.size() - 2);
+            move.pop_back();
+            continue;
+          }
+          const uint8_t k = move.back()++;
+          if (is_relevant(x + dx[k], y + dy[k])) {
+            path.push_back(x + dx[k]);
+            path.push_back(y + dy[k]);
+            move.push_back(0);
+          }
+        }
+        return paths;
+      };
+    public:
+      /** \brief class Traversals constructor
+        @par const uint32_t band - cells (i,j) with |i - j| < band have traversals
+      */
+      explicit Traversals(const uint32_t band = 4) : band(band) {};
+      /**
+        \brief class Traversals default destructor
+      */
+      ~Traversals() = default;
+      /**
+        \brief returns: true if cell (i,j) lies inside the band
+      */
+      bool InBand(const uint32_t i, const uint32_t j) const {
+        return (i > j ? i - j : j - i) < band;
+      };
+      /**
+        \brief Relevant traversals of cell (i,j), empty outside the band
+      */
+      const utils::Ragged<uint32_t>& Get(const uint32_t i, const uint32_t j) {
+        static const utils::Ragged<uint32_t> none;
+        if (!InBand(i, j)) {
+          return none;
+        }
+        auto cell = cells.find(Key(i, j));
+        if (cell == cells.end()) {
+          cell = cells.emplace(Key(i, j), Compute(i, j)).first;
+        }
+        return cell->second;
+      };
+      uint32_t GetBand(void) const { return band; };
+      size_t Size(void) const { return cells.size(); };
+      /** \brief Add the traversals stored by Save, so that they are not
+          computed again. Throws std::runtime_error if the file is not a
+          traversals cache of the same band
+        @par const std::string& file_name - Path to the cache
+      */
+      void Load(const std::string& file_name) {
+        utils::snapshot::Reader reader(
+          std::make_shared<const utils::snapshot::MappedFile>(file_name));
+        reader.Expect(kTraversalsMagic);
+        if (reader.Read<uint32_t>() != kTraversalsVersion) {
+          throw std::runtime_error("unsupported traversals cache version");
+        }
+        if (reader.Read<uint32_t>() != band) {
+          throw std::runtime_error("traversals cache of a different band");
+        }
+        const uint64_t size = reader.Read<uint64_t>();
+        for (uint64_t c = 0; c < size; ++c) {
+          const uint64_t key = reader.Read<uint64_t>();
+          const uint32_t num_paths = reader.Read<uint32_t>();
+          const uint32_t *offsets = reader.ReadArray<uint32_t>((size_t) num_paths + 1);
+          if (offsets[0] != 0 ||
+              !std::is_sorted(offsets, offsets + (size_t) num_paths + 1)) {
+            throw std::runtime_error("invalid traversals cache");
+          }
+          const uint32_t *values = reader.ReadArray<uint32_t>(offsets[num_paths]);
+          utils::Ragged<uint32_t> paths;
+          paths.offsets.assign(offsets, offsets + num_paths + 1);
+          paths.values.assign(values, values + offsets[num_paths]);
+          cells[key] = std::move(paths);
+        }
+      };
+      /** \brief Persist the traversals computed so far.
+          Throws std::runtime_error on I/O failure
+        @par const std::string& file_name - Path to the cache
+      */
+      void Save(const std::string& file_name) const {
+        utils::snapshot::Writer writer(file_name);
+        writer.WriteMagic(kTraversalsMagic);
+        writer.Write(kTraversalsVersion);
+        writer.Write(band);
+        writer.Write(static_cast<uint64_t>(cells.size()));
+        for (const auto& cell: cells) {
+          writer.Write(cell.first);
+          writer.Write(static_cast<uint32_t>(cell.second.Size()));
+          writer.WriteArray(cell.second.offsets.data(), cell.second.offsets.size());
+          writer.WriteArray(cell.second.values.data(), cell.second.values.size());
+        }
+        writer.Close();
+      };
+  };
+}
+
+#endif
@@ -1,13 +1,18 @@
 #ifndef VECTORIZATION
 #define VECTORIZATION
 
-#include <set>
 #include <cmath>
 #include <tuple>
 #include <vector>
 #include <random>
+#include <string>
 #include <iostream>
-#include "../lib/map_hash.h"
+#include <limits>
+#include <algorithm>
+#include "../../../core/utils/parallel.h"
+#include "../../../core/utils/ragged.h"
+#include "../../../core/utils/span.h"
+#include "traversals.h"
 
 namespace vectorization {
 
@@ -27,14 +32,20 @@ namespace vectorization {
       std::default_random_engine generator;
       std::uniform_real_distribution<double> distribution;
     public:
+      /* number of consecutive curves vectorized by a worker at a time */
+      static constexpr size_t kGrain = 64;
       /** \brief Grid class constructor
         Initializing private members
+        @par const uint64_t random_seed - seed of the shift t, grids built
+          with the same seed and delta vectorize curves the same way
       */
       Grid(const std::vector<std::pair<T,T>>& curves,
         const std::vector<int>& lengths, const std::vector<int>& offsets,
-        const uint32_t N, const uint32_t D, double delta) :
+        const uint32_t N, const uint32_t D, double delta,
+        const uint64_t random_seed =
+          std::chrono::system_clock::now().time_since_epoch().count()) :
           N(N), D(D), delta(delta), distribution(0,delta),
-          generator(std::chrono::system_clock::now().time_since_epoch().count()),
+          generator(random_seed),
           input_curves(curves), input_curves_lengths(lengths),
           input_curves_offsets(offsets) {
           // t is selected uniformly between 0 - delta
@@ -56,82 +67,129 @@ namespace vectorization {
               - removeconsecutiveduplicatesinp1′,...,pm′
         4) Then hδt (P) = the resulting polygonal curve
       */
-      std::vector<double> Vectorize(void) {
+      utils::Ragged<double> Vectorize(void) const {
         /**
-          Vectorize each input curve and store the corresponding vector to
-          an 1D array. Each vector is of dimension D (max curve length) and
-          we have in total_time N curves, and so N vectors.
+          Vectorize each input curve and store the corresponding vector.
+          Each vector is of dimension D (max curve length), but only its
+          snapped coordinates are stored, the rest are implicit padding.
         */
-        std::vector<double> result(D * N);
-        /* Iterave over each curve to compute its vector */
-        for (size_t i = 0; i < N; ++i) {
-          size_t idx = 0;
-          for (size_t j = 0; j < input_curves_lengths[i]; ++j) {
-            double x_1 = std::get<0>(input_curves[input_curves_offsets[i] + j]);
-            double t_1 = std::get<0>(t);
-            double x_2 = std::get<1>(input_curves[input_curves_offsets[i] + j]);
-            double t_2 = std::get<1>(t);
-            double a_1 = round((x_1 - t_1) / delta);
-            double a_2 = round((x_2 - t_2) / delta);
-            double s_1 = a_1 * delta + t_1;
-            double s_2 = a_1 * delta + t_1;
-            result[i * D + (idx++)] = s_1;
-            result[i * D + (idx++)] = s_2;
-          }
-          // remove duplicates
-          std::vector<double>::iterator ip;
-          ip = std::unique(result.begin() + i * D, result.begin() + i * D + idx);
-          result.resize(std::distance(result.begin() + i * D, ip));
-          // Fill with pading coordinates to have equal length vectors
-          size_t start = std::distance(result.begin() + i * D, ip);
-          for (size_t j = start; j < D; ++j) {
-            result[i * D + j] = std::numeric_limits<T>::max();
-          }
-        }
-        return result;
+        return Vectorize(N, input_curves, input_curves_lengths,
+                         input_curves_offsets);
       }
       /**
         \brief Given the query curves perform vectorization as above
       */
-      std::vector<double> Vectorize(const int Q,
+      utils::Ragged<double> Vectorize(const int Q,
         const std::vector<std::pair<T,T>>& query_curves,
         const std::vector<int>& query_curves_lengths,
-        const std::vector<int>& query_curves_offsets) {
-        /**
-          Vectorize each query curve and store the corresponding vector to
-          an 1D array. Each vector is of dimension D (max curve length) and
-          we have in total_time Q query curves, and so Q vectors.
-        */
-        std::vector<double> result(D * Q);
-        /* Iterave over each curve to compute its vector */
-        for (size_t i = 0; i < Q; ++i) {
-          size_t idx = 0;
-          for (size_t j = 0; j < query_curves_lengths[i]; ++j) {
-            double x_1 = std::get<0>(query_curves[query_curves_offsets[i] + j]);
-            double t_1 = std::get<0>(t);
-            double x_2 = std::get<1>(query_curves[query_curves_offsets[i] + j]);
-            double t_2 = std::get<1>(t);
-            double a_1 = round((x_1 - t_1) / delta);
-            double a_2 = round((x_2 - t_2) / delta);
-            double s_1 = a_1 * delta + t_1;
-            double s_2 = a_1 * delta + t_1;
-            result[i * D + (idx++)] = s_1;
-            result[i * D + (idx++)] = s_2;
-          }
-          // remove duplicates
-          std::vector<double>::iterator ip;
-          ip = std::unique(result.begin() + i * D, result.begin() + i * D + idx);
-          result.resize(std::distance(result.begin() + i * D, ip));
-          // Fill with pading coordinates to have equal length vectors
-          size_t start = std::distance(result.begin() + i * D, ip);
-          // Fill with pading coordinates to have eqaal length vectors
-          for (size_t j = start; j < D; ++j) {
-            result[i * D + j] = std::numeric_limits<T>::max();
+        const std::vector<int>& query_curves_offsets) const {
+
+        std::vector<uint32_t> bounds = Bounds(Q, query_curves_lengths);
+        std::vector<uint32_t> sizes(Q);
+        utils::Ragged<double> result;
+        result.D = D;
+        result.values.resize(bounds[Q]);
+        /* Curves are independent, so ranges of curves are vectorized in parallel */
+        utils::parallel::ParallelFor(Q, kGrain, [&](const size_t i) {
+          sizes[i] = Snap(&query_curves[query_curves_offsets[i]],
+                          query_curves_lengths[i], &result.values[bounds[i]]);
+        });
+        Compact(bounds, sizes, result);
+        return result;
+      }
+      /** \brief Snap a curve on the grid and write its vector, i.e the
+        snapped points without consecutive duplicates
+        @par const std::pair<T,T> *curve - the points of the curve
+        @par const int length - number of points of the curve
+        @par double *result - room for the 2 * length coordinates of the vector
+        returns: the number of coordinates of the vector
+      */
+      uint32_t Snap(const std::pair<T,T> *curve, const int length,
+        double *result) const {
+        // Snap all points, a = round((x - t) / delta), s = a * delta + t
+        const double inv_delta = 1.0 / delta;
+        for (size_t j = 0; j < length; ++j) {
+          result[2 * j] = std::fma(
+            std::round((std::get<0>(curve[j]) - t.first) * inv_delta),
+            delta, t.first);
+          result[2 * j + 1] = std::fma(
+            std::round((std::get<1>(curve[j]) - t.second) * inv_delta),
+            delta, t.second);
+        }
+        // remove consecutive duplicate points
+        size_t size = length > 0 ? 2 : 0;
+        for (size_t j = 1; j < length; ++j) {
+          if (result[2 * j] != result[size - 2] ||
+              result[2 * j + 1] != result[size - 1]) {
+            result[size++] = result[2 * j];
+            result[size++] = result[2 * j + 1];
           }
         }
-        return result;
+        return size;
+      }
+      /** \brief Offsets of the room of each curve's vector before removing
+        duplicates, i.e prefix sums of 2 * length
+      */
+      static std::vector<uint32_t> Bounds(const uint32_t N,
+        const std::vector<int>& lengths) {
+        std::vector<uint32_t> bounds(N + 1);
+        for (size_t i = 0; i < N; ++i) {
+          bounds[i + 1] = bounds[i] + 2 * lengths[i];
+        }
+        return bounds;
       }
+      /** \brief Move each vector of size sizes[i] from bounds[i] next to the
+        previous one and set the offsets of the result. Vectors are cut to
+        the dimension of the result, as a query curve may be longer than
+        every dataset curve and hash functions have D coordinates only.
+      */
+      static void Compact(const std::vector<uint32_t>& bounds,
+        const std::vector<uint32_t>& sizes, utils::Ragged<double>& result) {
+        const size_t N = sizes.size();
+        result.offsets.resize(N + 1);
+        result.offsets[0] = 0;
+        for (size_t i = 0; i < N; ++i) {
+          const uint32_t size = std::min(sizes[i], result.D);
+          std::copy(result.values.begin() + bounds[i],
+                    result.values.begin() + bounds[i] + size,
+                    result.values.begin() + result.offsets[i]);
+          result.offsets[i + 1] = result.offsets[i] + size;
+        }
+        result.values.resize(result.offsets[N]);
+        result.values.shrink_to_fit();
+      }
+      uint32_t GetD(void) const { return D; };
   };
+  /** \brief Vectorize the same curves on every grid. Work is split in
+    ranges of curves of every grid, so that all grids are vectorized in
+    parallel, each one into its preallocated vectors.
+    @par const std::vector<Grid<T>>& grids - Pass by reference the grids
+    rest of parameters describe the curves as in Grid::Vectorize
+  */
+  template <typename T>
+  std::vector<utils::Ragged<double>> Vectorize(const std::vector<Grid<T>>& grids,
+    const uint32_t N, const std::vector<std::pair<T,T>>& curves,
+    const std::vector<int>& lengths, const std::vector<int>& offsets) {
+
+    const std::vector<uint32_t> bounds = Grid<T>::Bounds(N, lengths);
+    std::vector<std::vector<uint32_t>> sizes(grids.size(), std::vector<uint32_t>(N));
+    std::vector<utils::Ragged<double>> result(grids.size());
+    for (size_t g = 0; g < grids.size(); ++g) {
+      result[g].D = grids[g].GetD();
+      result[g].values.resize(bounds[N]);
+    }
+    utils::parallel::ParallelFor(grids.size() * N, Grid<T>::kGrain,
+                                 [&](const size_t i) {
+      const size_t g = i / N;
+      const size_t c = i % N;
+      sizes[g][c] = grids[g].Snap(&curves[offsets[c]], lengths[c],
+                                  &result[g].values[bounds[c]]);
+    });
+    utils::parallel::ParallelFor(grids.size(), 1, [&](const size_t g) {
+      Grid<T>::Compact(bounds, sizes[g], result[g]);
+    });
+    return result;
+  }
 
   template <typename T, typename U>
   class Projection  {
@@ -146,49 +204,51 @@ namespace vectorization {
       const std::vector<int>& input_curves_lengths;
       const std::vector<int>& input_curves_offsets;
       const std::vector<U>& input_curves_ids;
-      /* M * M array containing all possible paths from (0,0) to each cell */
-      std::vector<std::vector<std::vector<std::pair<T,T>>>> relevant_traversals;
-      /* Storing datasets vectors' info per traversal */
-      std::unordered_map<std::tuple<int,int,int>,std::vector<double>> vectors;
-      std::unordered_map<std::tuple<int,int,int>,std::vector<int>> vectors_lengths;
-      std::unordered_map<std::tuple<int,int,int>,std::vector<int>> vectors_offsets;
-      std::unordered_map<std::tuple<int,int,int>,std::vector<U>> vectors_ids;
-      /* Storing queries vectors' info per traversal */
-      std::unordered_map<U,std::vector<double>> qvectors;
-      std::unordered_map<U,std::vector<int>> qvectors_lengths;
-      std::unordered_map<U,std::vector<int>> qvectors_offsets;
-      std::unordered_map<U,std::vector<U>> qvectors_ids;
+      /* relevant traversals of the cells used by the curves */
+      Traversals traversals;
+      /* Every (length, j, traversal) used by the dataset curves is a slot.
+       * The first slot of cell (length, j) is cell_slots[Cell(length, j)]
+       * and the traversals of the cell use consecutive slots. */
+      std::vector<int32_t> cell_slots;
+      std::vector<std::tuple<int,int,int>> slot_keys;
+      /* Dataset vectors of slot s are slot_begin[s]..slot_begin[s + 1),
+       * stored slot after slot in one arena per field */
+      std::vector<uint32_t> slot_begin;
+      std::vector<double> vectors;
+      std::vector<int> vectors_lengths;
+      std::vector<int> vectors_offsets;
+      std::vector<U> vectors_ids;
+      /* Query vectors of query i are query_begin[i]..query_begin[i + 1) */
+      std::vector<uint32_t> query_begin;
+      std::vector<double> qvectors;
+      std::vector<int> qvectors_lengths;
+      std::vector<int> qvectors_offsets;
 
       std::default_random_engine generator;
       std::uniform_real_distribution<double> distribution;
     public:
       /**
         \brief Just a constructor
+        @par const uint32_t band - only cells (i,j) with |i - j| < band have
+          relevant traversals
+        @par const uint64_t random_seed - seed of the G matrix
       */
       Projection(std::vector<std::pair<T,T>>& dataset_curves,
         std::vector<int>& dataset_offsets, std::vector<int>& dataset_lengths,
-        std::vector<U>& dataset_ids, uint32_t N, const int K) :
+        std::vector<U>& dataset_ids, uint32_t N, const int K,
+        const uint32_t band = 4,
+        const uint64_t random_seed =
+          std::chrono::system_clock::now().time_since_epoch().count()) :
           d(2), N(N), K(K), distribution(0,1),
-          generator(std::chrono::system_clock::now().time_since_epoch().count()),
+          generator(random_seed),
           input_curves(dataset_curves), input_curves_lengths(dataset_lengths),
-          input_curves_offsets(dataset_offsets), input_curves_ids(dataset_ids) {
+          input_curves_offsets(dataset_offsets), input_curves_ids(dataset_ids),
+          traversals(band) {
 
-        // Get max length from all curves and
-        // store all relevant traversals at an M * M array
+        // Get max length from all curves, relevant traversals are computed
+        // lazily for the cells used by the dataset and query curves
         M = *max_element(std::begin(dataset_lengths), std::end(dataset_lengths));
 
-        // Computing all relevant traversals
-        relevant_traversals = std::vector<std::vector<std::vector<std::pair<T,T>>>> (M * M);
-        int count = 0;
-        for (size_t i = 0; i < M; ++i) {
-          for (size_t j = 0; j < M; ++j) {
-            if (abs(i-j < 4)) {
-              relevant_traversals[i * M + j] = RelevantTraversals(i,j);
-              count += relevant_traversals[i * M + j].size();
-            }
-          }
-        }
-
         /* Generating G matrix with
          * random values ~N(0,1) */
         size_t size_G = K * d;
@@ -202,29 +262,62 @@ namespace vectorization {
        * For every dataset curve replace 1st pair pointer (ui)
        * with actual coordinate. For every value multiply with G
        * matrix, then concat: x = [G*u1|..|G*un]. Store each
-       * vector and its info to map with key the corresponding traversal.
+       * vector and its info to the slot of the corresponding traversal.
        * Each traversal corresponds to a NN structure.
        */
       void Vectorize (void) {
+        // 1st pass assigns slots and counts the vectors of each slot
+        cell_slots.assign((size_t) M * (2 * traversals.GetBand() - 1), -1);
+        std::vector<uint32_t> counts;
         for (size_t i = 0; i < N; ++i) {
           size_t length = input_curves_lengths[i] - 1;
-          for (size_t j = 0; j < M; ++j) {
-            size_t i_traversal = 0;
-            for (const auto& tr:relevant_traversals[length*M+j]) {
-              std::vector<std::pair<T,T>> rep_curve;
-              i_traversal++;
-              for (const auto& pair:tr) {
-                T pos = pair.first;
-                rep_curve.push_back(std::make_pair(input_curves[input_curves_offsets[i] + pos].first,pair.second));
+          for (size_t j = BandBegin(length); j < BandEnd(length); ++j) {
+            const size_t count = traversals.Get(length, j).Size();
+            int32_t& first = cell_slots[Cell(length, j)];
+            if (first < 0) {
+              first = slot_keys.size();
+              for (size_t k = 0; k < count; ++k) {
+                slot_keys.push_back(std::make_tuple(length, j, k + 1));
               }
-              std::tuple<size_t,size_t,size_t> key = std::make_tuple(length,j,i_traversal);
-              std::vector<T> value = CreateVector(rep_curve);
-              for (const auto& ivalue:value) {
-                vectors[key].push_back(ivalue);
+              counts.resize(slot_keys.size(), 0);
+            }
+            for (size_t k = 0; k < count; ++k) {
+              counts[first + k]++;
+            }
+          }
+        }
+        slot_begin.assign(slot_keys.size() + 1, 0);
+        for (size_t s = 0; s < slot_keys.size(); ++s) {
+          slot_begin[s + 1] = slot_begin[s] + counts[s];
+        }
+        const size_t dim = K * d;
+        vectors.resize((size_t) slot_begin.back() * dim);
+        vectors_lengths.resize(slot_begin.back());
+        vectors_offsets.resize(slot_begin.back());
+        vectors_ids.resize(slot_begin.back());
+        // 2nd pass writes every vector to the next free position of its slot
+        std::vector<uint32_t> cursor(slot_begin.begin(), slot_begin.end() - 1);
+        std::vector<T> sums;
+        for (size_t i = 0; i < N; ++i) {
+          size_t length = input_curves_lengths[i] - 1;
+          for (size_t j = BandBegin(length); j < BandEnd(length); ++j) {
+            const utils::Ragged<uint32_t>& paths = traversals.Get(length, j);
+            const size_t count = paths.Size();
+            // sum of the coordinates matched by each traversal
+            sums.assign(count, T{});
+            for (size_t k = 0; k < count; ++k) {
+              const uint32_t *tr = paths.Data(k);
+              for (size_t c = 0; c < paths.Length(k); c += 2) {
+                sums[k] += input_curves[input_curves_offsets[i] + tr[c]].first;
               }
-              vectors_lengths[key].push_back(input_curves_lengths[i]);
-              vectors_offsets[key].push_back(input_curves_offsets[i]);
-              vectors_ids[key].push_back(input_curves_ids[i]);
+            }
+            const int32_t first = cell_slots[Cell(length, j)];
+            for (size_t k = 0; k < count; ++k) {
+              const uint32_t pos = cursor[first + k]++;
+              Project(&sums[k], 1, &vectors[(size_t) pos * dim]);
+              vectors_lengths[pos] = input_curves_lengths[i];
+              vectors_offsets[pos] = input_curves_offsets[i];
+              vectors_ids[pos] = input_curves_ids[i];
             }
           }
         }
@@ -236,183 +329,138 @@ namespace vectorization {
       void Vectorize(const int Q,
         const std::vector<std::pair<T,T>>& query_curves,
         const std::vector<int>& query_curves_lengths,
-        const std::vector<int>& query_curves_offsets,
-        const std::vector<U>& query_curves_ids) {
+        const std::vector<int>& query_curves_offsets) {
+          const size_t dim = K * d;
+          std::vector<T> sums;
+          // vectors of a previous query file are replaced
+          query_begin.assign(1, 0);
+          qvectors.clear();
+          qvectors_lengths.clear();
+          qvectors_offsets.clear();
           for (size_t i = 0; i < Q; ++i) {
             size_t length = query_curves_lengths[i] - 1;
-            for (size_t j = 0; j < M; ++j) {
-              size_t i_traversal = 0;
-              for (const auto& tr:relevant_traversals[j*M+length]) {
-                std::vector<std::pair<T,T>> rep_curve;
-                i_traversal++;
-                for (const auto& pair:tr) {
-                  T pos = pair.second;
-                  rep_curve.push_back(std::make_pair(pair.first,input_curves[input_curves_offsets[i] + pos].second));
-                }
-                U key = query_curves_ids[i];
-                std::vector<T> value = qCreateVector(rep_curve);
-                for (const auto& ivalue:value) {
-                  qvectors[key].push_back(ivalue);
+            for (size_t j = BandBegin(length); j < BandEnd(length); ++j) {
+              const utils::Ragged<uint32_t>& paths = traversals.Get(j, length);
+              const size_t count = paths.Size();
+              // sum of the coordinates matched by each traversal
+              sums.assign(count, T{});
+              for (size_t k = 0; k < count; ++k) {
+                const uint32_t *tr = paths.Data(k);
+                for (size_t c = 0; c < paths.Length(k); c += 2) {
+                  sums[k] += query_curves[query_curves_offsets[i] + tr[c + 1]].second;
                 }
-                qvectors_lengths[key].push_back(query_curves_lengths[i]);
-                qvectors_offsets[key].push_back(query_curves_offsets[i]);
-                qvectors_ids[key].push_back(query_curves_ids[i]);
               }
+              // vectors of a query are consecutive, so the batch is
+              // projected in place
+              const size_t pos = qvectors_lengths.size();
+              qvectors.resize((pos + count) * dim);
+              Project(sums.data(), count, &qvectors[pos * dim]);
+              qvectors_lengths.resize(pos + count, query_curves_lengths[i]);
+              qvectors_offsets.resize(pos + count, query_curves_offsets[i]);
             }
+            query_begin.push_back(qvectors_lengths.size());
           }
       };
 
-      const std::unordered_map<std::tuple<int,int,int>,
-                              std::vector<double>>& GetVectors() {
-                              return vectors;
-                        };
-
-      const std::unordered_map<std::tuple<int,int,int>,
-                              std::vector<int>>& GetVectorsLengths() {
-                              return vectors_lengths;
-                        };
-
-      const std::unordered_map<std::tuple<int,int,int>,
-                              std::vector<int>>& GetVectorsOffsets() {
-                              return vectors_offsets;
-                        };
-
-      const std::unordered_map<std::tuple<int,int,int>,
-                              std::vector<U>>& GetVectorsIds() {
-                              return vectors_ids;
-                        };
-
-      const std::unordered_map<U,
-                              std::vector<double>>& qGetVectors() {
-                              return qvectors;
-                        };
-
-      const std::unordered_map<U,
-                              std::vector<int>>& qGetVectorsLengths() {
-                              return qvectors_lengths;
-                        };
-
-      const std::unordered_map<U,
-                              std::vector<int>>& qGetVectorsOffsets() {
-                              return qvectors_offsets;
-                        };
-
-      const std::unordered_map<U,
-                              std::vector<U>>& qGetVectorsIds() {
-                              return qvectors_ids;
-                        };
-
-      std::vector<T> CreateVector(std::vector<std::pair<T,T>>& traversal) {
-        std::vector<std::vector<T>> v;
-        std::vector<T> x (K*d);
-        for (const auto& ui:traversal) {
-          std::vector<T> xi;
-          for (size_t i = 0; i < K * d; ++i) {
-            xi.push_back(ui.first * G[i]);
-          }
-          v.push_back(xi);
-        }
-        for (size_t i = 0; i < v.size(); ++i) {
-          for (size_t j = 0; j < v[i].size(); ++j) {
-            x[j] += v[i][j];
-          }
-        }
-        return x;
+      /** \brief Add the relevant traversals of a cache file written by
+          SaveTraversals. Throws std::runtime_error if the file is not a cache
+          of the same band
+      */
+      void LoadTraversals(const std::string& file_name) {
+        traversals.Load(file_name);
       };
-
-      std::vector<T> qCreateVector(std::vector<std::pair<T,T>>& traversal) {
-        std::vector<std::vector<T>> v;
-        std::vector<T> x (K*d);
-        for (const auto& ui:traversal) {
-          std::vector<T> xi;
-          for (size_t i = 0; i < K * d; ++i) {
-            xi.push_back(ui.second * G[i]);
-          }
-          v.push_back(xi);
-        }
-        for (size_t i = 0; i < v.size(); ++i) {
-          for (size_t j = 0; j < v[i].size(); ++j) {
-            x[j] += v[i][j];
-          }
-        }
-        return x;
+      /** \brief Persist the relevant traversals computed so far.
+          Throws std::runtime_error on I/O failure
+      */
+      void SaveTraversals(const std::string& file_name) const {
+        traversals.Save(file_name);
       };
 
-      std::vector<std::vector<std::pair<T,T>>> RelevantTraversals(int i, int j) {
-        std::set<std::pair<T,T>> diag_cells;
-        std::set<std::pair<T,T>> rel_cells;
-        diag_cells = DrawLineSegment(i, j, i+1, j+1);
-        rel_cells = FindNeighbors(diag_cells,i,j);
-        std::vector<std::pair<T,T>> path;
-        std::vector<std::vector<std::pair<T,T>>> paths;
-        FindTraversals(path, paths, rel_cells, 0, 0, i+1, j+1);
-        return paths;
-      }
-
-      /** \brief
-          Find cells that are crossed by main diagonal line segment
+      /**
+        \brief Number of slots, i.e. of (length, j, traversal) with vectors
       */
-      std::set<std::pair<T,T>> DrawLineSegment(int x, int y, int m, int n) {
-        std::set<std::pair<T,T>> diag_cells;
-        for (int xi = 0; xi < m; xi++) {
-          int yi = round((double) n/m * (double)xi);
-          diag_cells.insert(std::make_pair(xi,yi));
-        }
-        for (int yi = 0; yi < n; yi++) {
-          int xi = round((double) m/n * (double)yi);
-          diag_cells.insert(std::make_pair(xi,yi));
-        }
-        return diag_cells;
-      }
-
-      /** \brief
-          Find cells that are crossed by main diagonal line segment
+      uint32_t GetSlots(void) const { return slot_keys.size(); };
+      /**
+        \brief (length, j, traversal) of slot s
+      */
+      const std::tuple<int,int,int>& GetSlot(const uint32_t s) const {
+        return slot_keys[s];
+      };
+      /**
+        \brief Vectors of slot s, K * d coordinates each
+      */
+      utils::Span<double> GetVectors(const uint32_t s) const {
+        return utils::Span<double>(vectors.data() + (size_t) slot_begin[s] * K * d,
+          (size_t) (slot_begin[s + 1] - slot_begin[s]) * K * d);
+      };
+      utils::Span<int> GetVectorsLengths(const uint32_t s) const {
+        return utils::Span<int>(vectors_lengths.data() + slot_begin[s],
+                                slot_begin[s + 1] - slot_begin[s]);
+      };
+      utils::Span<int> GetVectorsOffsets(const uint32_t s) const {
+        return utils::Span<int>(vectors_offsets.data() + slot_begin[s],
+                                slot_begin[s + 1] - slot_begin[s]);
+      };
+      utils::Span<U> GetVectorsIds(const uint32_t s) const {
+        return utils::Span<U>(vectors_ids.data() + slot_begin[s],
+                              slot_begin[s + 1] - slot_begin[s]);
+      };
+      /**
+        \brief Vectors of the i-th query curve, K * d coordinates each
       */
-      std::set<std::pair<T,T>> FindNeighbors(std::set<std::pair<T,T>>& diag_cells,
-          int m, int n) {
+      utils::Span<double> qGetVectors(const uint32_t i) const {
+        return utils::Span<double>(qvectors.data() + (size_t) query_begin[i] * K * d,
+          (size_t) (query_begin[i + 1] - query_begin[i]) * K * d);
+      };
+      utils::Span<int> qGetVectorsLengths(const uint32_t i) const {
+        return utils::Span<int>(qvectors_lengths.data() + query_begin[i],
+                                query_begin[i + 1] - query_begin[i]);
+      };
+      utils::Span<int> qGetVectorsOffsets(const uint32_t i) const {
+        return utils::Span<int>(qvectors_offsets.data() + query_begin[i],
+                                query_begin[i + 1] - query_begin[i]);
+      };
 
-        std::set<std::pair<T,T>> rel_cells (diag_cells);
-        for (const auto& p:diag_cells) {
-          if (p.first != 0) {
-            rel_cells.insert(std::make_pair(p.first-1,p.second));
+      /** \brief Fused projection kernel of a batch of traversals of a curve.
+        The vector of a traversal is the sum of G * u_i over its steps and
+        every u_i is a single coordinate, so it equals (u_1 + .. + u_n) * G.
+        The vectors of the batch are the outer product of the sums with G,
+        written straight to result without intermediate vectors.
+        @par const T *sums - sum of the coordinates of each traversal
+        @par const size_t count - number of traversals
+        @par T *result - count vectors of dimension K * d, one after the other
+      */
+      void Project(const T *sums, const size_t count, T *result) const {
+        const size_t dim = K * d;
+        const double *g = G.data();
+        for (size_t p = 0; p < count; ++p) {
+          const T s = sums[p];
+          T *x = result + p * dim;
+          for (size_t c = 0; c < dim; ++c) {
+            x[c] = s * g[c];
           }
         }
-        return rel_cells;
-      }
+      };
 
-      /** \brief
-          A path is relevant when it consists of cells that are either on
-          main diagonal line segment or have a distance of 1.
+    private:
+      /**
+        \brief Index of cell (i,j) of the band in cell_slots
       */
-      const bool isRelevant(std::set<std::pair<T,T>>& s, int i, int j, int m, int n) {
-        return s.find(std::make_pair(i,j)) != s.end();
-      }
-
-      void FindTraversals(std::vector<std::pair<T,T>>& path, std::vector<std::vector<std::pair<T,T>>>& paths,
-        std::set<std::pair<T,T>>& s, int i, int j, int m, int n) {
-        //destination point reached
-        if ((i == m-1) && (j == n-1)) {
-          path.push_back(std::make_pair(i,j));
-          paths.push_back(path);
-          path.pop_back();
-          return;
-        }
-        //add curr cell to path
-        path.push_back(std::make_pair(i,j));
-        //move right
-        if (isRelevant(s, i+1, j, m, n)) {
-          FindTraversals(path, paths, s, i+1, j, m, n);
-        }
-        //move left
-        if (isRelevant(s, i, j+1, m, n)) {
-          FindTraversals(path, paths, s, i, j+1, m, n);
-        }
-        if (isRelevant(s, i+1, j+1, m, n)) {
-          FindTraversals(path, paths, s, i+1, j+1, m, n);
-        }
-        //delete last pair
-        path.pop_back();
-      }
+      size_t Cell(const size_t i, const size_t j) const {
+        return i * (2 * traversals.GetBand() - 1) + j + traversals.GetBand() - 1 - i;
+      };
+      /**
+        \brief First column of the band of row i
+      */
+      size_t BandBegin(const size_t i) const {
+        return i + 1 > traversals.GetBand() ? i + 1 - traversals.GetBand() : 0;
+      };
+      /**
+        \brief End of the columns of the band of row i, at most M
+      */
+      size_t BandEnd(const size_t i) const {
+        return std::min<size_t>(M, i + traversals.GetBand());
+      };
   };
 }
 
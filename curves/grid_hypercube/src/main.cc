@@ -3,7 +3,10 @@
 #include <cmath>
 #include <iostream>
 #include <iterator>
+#include <limits>
+#include <memory>
 #include <random>
+#include <stdexcept>
 #include <string>
 #include <tuple>
 #include <utility>
@@ -11,11 +14,18 @@
 
 #include "../../../core/hash/hash_function.h"
 #include "../../../core/metric/metric.h"
+#include "../../../core/metric/report.h"
 #include "../../../core/search/brute_force.h"
 #include "../../../core/search/hypercube.h"
+#include "../../../core/utils/counters.h"
+#include "../../../core/utils/estimate.h"
+#include "../../../core/utils/parallel.h"
+#include "../../../core/utils/timing.h"
 #include "../../../core/utils/utils.h"
 
 #include "../../core/vectorization/vectorization.h"
+#include "../../core/search/grid_hierarchy.h"
+#include "../../core/search/grid_index.h"
 #include "../../core/search/grid_search.h"
 
 #include "../includes/args_utils.h"
@@ -105,6 +115,125 @@ int main(int argc, char **argv) {
   std::cout << "Time elapsed: " << total_time.count() << " seconds"
             << std::endl;
 
+  /* Create BruteForce class object, it is shared by every query file */
+  start = high_resolution_clock::now();
+  std::cout << "\nBuilding Brute Force.." << std::endl;
+  search::curves::BruteForce<T,U> bf{dataset_curves, dataset_curves_ids,
+                                     dataset_curves_lengths,
+                                     dataset_curves_offsets};
+  stop = high_resolution_clock::now();
+  total_time = duration_cast<duration<double>>(stop - start);
+  std::cout << "Building Brute Force completed successfully." << std::endl;
+  std::cout << "Time elapsed: " << total_time.count() << " seconds"
+            << std::endl;
+
+  /* Computing delta parameter for grid */
+  start = high_resolution_clock::now();
+  std::cout << "\nComputing grid hyperparameters.." << std::endl;
+  delta = utils::ComputeDelta(dataset_curves, dataset_curves_lengths,
+                              dataset_curves_offsets);
+  D_vec = 2 * *max_element(std::begin(dataset_curves_lengths),
+                           std::end(dataset_curves_lengths));
+  stop = high_resolution_clock::now();
+  total_time = duration_cast<duration<double>>(stop - start);
+  std::cout << "Computing grid hyperparameters completed successfully."
+            << std::endl;
+  std::cout << "Time elapsed: " << total_time.count() << " seconds"
+            << std::endl;
+
+  /* Grids are built from a seed, which is stored in HyperCube snapshots
+     so that the vectors of loaded snapshots are computed again */
+  uint64_t seed = std::chrono::system_clock::now().time_since_epoch().count();
+  uint32_t index_count = 0;
+  std::unique_ptr<utils::snapshot::Reader> index;
+  if (!input_info.load_index_file.empty()) {
+    try {
+      index.reset(new utils::snapshot::Reader(search::OpenHyperCubeSnapshot(
+                    input_info.load_index_file, seed, index_count)));
+    } catch (const std::exception& e) {
+      std::cout << "\n" << e.what() << std::endl;
+      utils::report::ReportError(utils::INVALID_INDEX);
+    }
+  }
+
+  /* Building L_grid Grids */
+  start = high_resolution_clock::now();
+  std::cout << "\nBuilding " << static_cast<unsigned int>(input_info.L_grid)
+            << " grids.." << std::endl;
+  std::vector<vectorization::Grid<T>> grids;
+  for (size_t i = 0; i < input_info.L_grid; ++i) {
+    grids.push_back(vectorization::Grid<T>(dataset_curves,
+                                           dataset_curves_lengths,
+                                           dataset_curves_offsets,
+                                           input_info.N, D_vec, factor * delta,
+                                           seed + i * 0x9E3779B97F4A7C15ULL));
+  }
+  stop = high_resolution_clock::now();
+  total_time = duration_cast<duration<double>>(stop - start);
+  std::cout << "Building " << static_cast<unsigned int>(input_info.L_grid)
+            << " grids completed successfully." << std::endl;
+  std::cout << "Time elapsed: " << total_time.count() << " seconds"
+            << std::endl;
+
+  /* For each curve find an equivalent vector. Do this for L_grid grids */
+  start = high_resolution_clock::now();
+  std::cout << "\nVectorizing dataset curves using grid method.." << std::endl;
+  std::vector<utils::Ragged<double>> L_grid_dataset_vectors =
+    vectorization::Vectorize(grids, input_info.N, dataset_curves,
+                             dataset_curves_lengths, dataset_curves_offsets);
+  stop = high_resolution_clock::now();
+  total_time = duration_cast<duration<double>>(stop - start);
+  std::cout << "Vectorizing dataset curves using grid method completed."
+            << std::endl;
+  std::cout << "Time elapsed: " << total_time.count() << " seconds"
+            << std::endl;
+
+  /* Building exact grid curve indices */
+  std::vector<search::curves::GridIndex<T,U>> grid_indices;
+  if (input_info.exact_grid) {
+    start = high_resolution_clock::now();
+    std::cout << "\nBuilding exact grid indices.." << std::endl;
+    for (size_t i = 0; i < input_info.L_grid; ++i) {
+      grid_indices.push_back(search::curves::GridIndex<T,U>(
+                               L_grid_dataset_vectors[i], dataset_curves,
+                               dataset_curves_ids, dataset_curves_lengths,
+                               dataset_curves_offsets));
+    }
+    stop = high_resolution_clock::now();
+    total_time = duration_cast<duration<double>>(stop - start);
+    std::cout << "Building exact grid indices completed successfully."
+              << std::endl;
+    std::cout << "Time elapsed: " << total_time.count() << " seconds"
+              << std::endl;
+  }
+
+  /* Building grid hierarchy of geometrically increasing delta */
+  std::unique_ptr<search::curves::GridHierarchy<T,U>> grid_hierarchy;
+  if (input_info.grid_levels > 0) {
+    start = high_resolution_clock::now();
+    std::cout << "\nBuilding grid hierarchy.." << std::endl;
+    grid_hierarchy.reset(new search::curves::GridHierarchy<T,U>(
+                           input_info.grid_levels, factor * delta, 2.0,
+                           input_info.min_candidates, dataset_curves,
+                           dataset_curves_ids, dataset_curves_lengths,
+                           dataset_curves_offsets, input_info.N, D_vec));
+    stop = high_resolution_clock::now();
+    total_time = duration_cast<duration<double>>(stop - start);
+    std::cout << "Building grid hierarchy completed successfully."
+              << std::endl;
+    std::cout << "Time elapsed: " << total_time.count() << " seconds"
+              << std::endl;
+  }
+
+  /* Start the threads of the shared pool and calibrate the query timer
+     before any query is timed */
+  utils::parallel::SharedPool();
+  utils::QueryTiming::Calibrate();
+
+  /* HyperCube structures are built for the first query file and searched
+     by the rest */
+  std::vector<search::curves::HyperCube<T,U>> hypercube_structures;
+  size_t next_query = 1;
   do {
     /* Preprocessing query file to get number of query curves */
     start = high_resolution_clock::now();
@@ -143,88 +272,31 @@ int main(int argc, char **argv) {
     /* Print input info */
     input_info.Print();
 
-    /* Create BruteForce class object and a vector to store exact-NN results */
-    start = high_resolution_clock::now();
-    std::cout << "\nBuilding Brute Force.." << std::endl;
-    std::vector<std::tuple<T,U,double>> bf_nn_results(input_info.Q);
-    search::curves::BruteForce<T,U> bf{dataset_curves, dataset_curves_ids,
-                                       dataset_curves_lengths,
-                                       dataset_curves_offsets};
-    stop = high_resolution_clock::now();
-    total_time = duration_cast<duration<double>>(stop - start);
-    std::cout << "Building Brute Force completed successfully." << std::endl;
-    std::cout << "Time elapsed: " << total_time.count() << " seconds"
-              << std::endl;
-
-    /* Executing Exact Nearest Neighbor using BruteForce */
-    start = high_resolution_clock::now();
-    std::cout << "\nExecuting Nearest Neighbor using Brute Force.." << std::endl;
-    for (size_t i = 0; i < input_info.Q; ++i) {
-      bf_nn_results[i] = bf.NearestNeighbor(query_curves, query_curves_lengths,
-                                            query_curves_offsets, i);
-    }
-    stop = high_resolution_clock::now();
-    total_time = duration_cast<duration<double>>(stop - start);
-    std::cout << "Executing Nearest Neighbor using Brute Force completed successfully."
-              << std::endl;
-    std::cout << "Time elapsed: " << total_time.count() << " seconds"
-              << std::endl;
-
-    /* Computing delta parameter for grid */
-    start = high_resolution_clock::now();
-    std::cout << "\nComputing grid hyperparameters.." << std::endl;
-    delta = utils::ComputeDelta(dataset_curves, dataset_curves_lengths,
-                                dataset_curves_offsets);
-    D_vec = 2 * *max_element(std::begin(dataset_curves_lengths),
-                             std::end(dataset_curves_lengths));
-    stop = high_resolution_clock::now();
-    total_time = duration_cast<duration<double>>(stop - start);
-    std::cout << "Computing grid hyperparameters completed successfully."
-              << std::endl;
-    std::cout << "Time elapsed: " << total_time.count() << " seconds"
-              << std::endl;
-
-    /* Building L_grid Grids */
-    start = high_resolution_clock::now();
-    std::cout << "\nBuilding " << static_cast<unsigned int>(input_info.L_grid)
-              << " grids.." << std::endl;
-    std::vector<vectorization::Grid<T>> grids;
-    for (size_t i = 0; i < input_info.L_grid; ++i) {
-      grids.push_back(vectorization::Grid<T>(dataset_curves,
-                                             dataset_curves_lengths,
-                                             dataset_curves_offsets,
-                                             input_info.N, D_vec, factor * delta));
-    }
-    stop = high_resolution_clock::now();
-    total_time = duration_cast<duration<double>>(stop - start);
-    std::cout << "Building " << static_cast<unsigned int>(input_info.L_grid)
-              << " grids completed successfully." << std::endl;
-    std::cout << "Time elapsed: " << total_time.count() << " seconds"
-              << std::endl;
-
-    /* For each curve find an equivalent vector. Do this for L_grid grids */
-    start = high_resolution_clock::now();
-    std::cout << "\nVectorizing dataset curves using grid method.." << std::endl;
-    std::vector<std::vector<double>> L_grid_dataset_vectors(input_info.L_grid);
-    for (size_t i = 0; i < input_info.L_grid; ++i) {
-      L_grid_dataset_vectors[i] = grids[i].Vectorize();
+    /* Executing Exact Nearest Neighbor using BruteForce, unless skipped */
+    std::vector<std::tuple<T,U,double>> bf_nn_results(input_info.Q,
+      std::make_tuple(std::numeric_limits<T>::max(), U{},
+                      utils::timing::kNotTimed));
+    if (!input_info.no_exact) {
+      start = high_resolution_clock::now();
+      std::cout << "\nExecuting Nearest Neighbor using Brute Force.." << std::endl;
+      for (size_t i = 0; i < input_info.Q; ++i) {
+        bf_nn_results[i] = bf.NearestNeighbor(query_curves, query_curves_lengths,
+                                              query_curves_offsets, i);
+      }
+      stop = high_resolution_clock::now();
+      total_time = duration_cast<duration<double>>(stop - start);
+      std::cout << "Executing Nearest Neighbor using Brute Force completed successfully."
+                << std::endl;
+      std::cout << "Time elapsed: " << total_time.count() << " seconds"
+                << std::endl;
     }
-    stop = high_resolution_clock::now();
-    total_time = duration_cast<duration<double>>(stop - start);
-    std::cout << "Vectorizing dataset curves using grid method completed."
-              << std::endl;
-    std::cout << "Time elapsed: " << total_time.count() << " seconds"
-              << std::endl;
 
     /* Vectorizing query curves */
     start = high_resolution_clock::now();
     std::cout << "\nVectorizing query curves using grid method.." << std::endl;
-    std::vector<std::vector<double>> L_grid_query_vectors(input_info.L_grid);
-    for (size_t i = 0; i < input_info.L_grid; ++i) {
-      L_grid_query_vectors[i] = grids[i].Vectorize(input_info.Q, query_curves,
-                                                   query_curves_lengths,
-                                                   query_curves_offsets);
-    }
+    std::vector<utils::Ragged<double>> L_grid_query_vectors =
+      vectorization::Vectorize(grids, input_info.Q, query_curves,
+                               query_curves_lengths, query_curves_offsets);
     stop = high_resolution_clock::now();
     total_time = duration_cast<duration<double>>(stop - start);
     std::cout << "Vectorizing query curves using grid method completed."
@@ -232,49 +304,109 @@ int main(int argc, char **argv) {
     std::cout << "Time elapsed: " << total_time.count() << " seconds"
               << std::endl;
 
-    /* Comptuing window parameter as k * R used by LSH and HyperCube */
-    start = high_resolution_clock::now();
-    std::cout << "\nComputing window parameter.." << std::endl;
-    double r[input_info.L_grid];
-    for (size_t i = 0; i < input_info.L_grid; ++i) {
-      std::vector<std::tuple<T,U,double>> temp_bf_nn_results(input_info.Q);
-      search::vectors::BruteForce<T,U> temp_bf{input_info.N, D_vec,
-                                               L_grid_dataset_vectors[i],
-                                               dataset_curves_ids};
-      for (size_t j = 0; j < input_info.Q; ++j) {
-       temp_bf_nn_results[j] = temp_bf.NearestNeighbor(L_grid_query_vectors[i], j);
+    if (hypercube_structures.empty() && !input_info.load_index_file.empty()) {
+      /* Loading HyperCube structures of the same grids */
+      start = high_resolution_clock::now();
+      std::cout << "\nLoading HyperCube structures.." << std::endl;
+      try {
+        if (index_count != input_info.L_grid) {
+          throw std::runtime_error("snapshot of a different number of grids");
+        }
+        for (size_t i = 0; i < input_info.L_grid; ++i) {
+          hypercube_structures.
+            push_back(search::curves::HyperCube<T,U>(*index, input_info.M,
+                        input_info.N, input_info.probes,
+                        dataset_curves, dataset_curves_ids,
+                        dataset_curves_lengths, dataset_curves_offsets,
+                        L_grid_dataset_vectors[i]));
+        }
+      } catch (const std::exception& e) {
+        std::cout << "\n" << e.what() << std::endl;
+        utils::report::ReportError(utils::INVALID_INDEX);
       }
-     r[i] = utils::ComputeParameterR(temp_bf_nn_results);
+      stop = high_resolution_clock::now();
+      total_time = duration_cast<duration<double>>(stop - start);
+      std::cout << "Loading HyperCube structures completed successfully."
+                << std::endl;
+      std::cout << "Time elapsed: " << total_time.count() << " seconds"
+                << std::endl;
     }
-    stop = high_resolution_clock::now();
-    total_time = duration_cast<duration<double>>(stop - start);
-    std::cout << "Computing window parameter completed successfully."
-              << std::endl;
-    std::cout << "Time elapsed: " << total_time.count() << " seconds"
-              << std::endl;
+    if (hypercube_structures.empty()) {
+      /* Comptuing window parameter as k * R used by LSH and HyperCube */
+      start = high_resolution_clock::now();
+      std::cout << "\nComputing window parameter.." << std::endl;
+      double r[input_info.L_grid];
+      for (size_t i = 0; i < input_info.L_grid; ++i) {
+        if (input_info.r_samples > 0 || input_info.no_exact) {
+          uint32_t samples;
+          std::tie(r[i], samples) = utils::EstimateParameterR(
+            utils::RaggedView<T>(L_grid_dataset_vectors[i]), input_info.N,
+            input_info.r_samples > 0 ? input_info.r_samples : utils::kRSamples);
+          std::cout << "Estimated R of grid " << i << " from " << samples
+                    << " sampled curves" << std::endl;
+          continue;
+        }
+        std::vector<std::tuple<T,U,double>> temp_bf_nn_results(input_info.Q);
+        search::vectors::BruteForce<T,U> temp_bf{input_info.N,
+                                                 L_grid_dataset_vectors[i],
+                                                 dataset_curves_ids};
+        for (size_t j = 0; j < input_info.Q; ++j) {
+          temp_bf_nn_results[j] = temp_bf.NearestNeighbor(L_grid_query_vectors[i], j);
+        }
+        r[i] = utils::ComputeParameterR(temp_bf_nn_results);
+      }
+      stop = high_resolution_clock::now();
+      total_time = duration_cast<duration<double>>(stop - start);
+      std::cout << "Computing window parameter completed successfully."
+                << std::endl;
+      std::cout << "Time elapsed: " << total_time.count() << " seconds"
+                << std::endl;
               
-    /* Bulding HyperCube structures */
-    start = high_resolution_clock::now();
-    std::cout << "\nBuilding HyperCube structures.." << std::endl;
-    std::vector<search::curves::HyperCube<T,U>> hypercube_structures;
-    for (size_t i = 0; i < input_info.L_grid; ++i) {
-      hypercube_structures.
-        push_back(search::curves::HyperCube<T,U>(input_info.k_hypercube,
-                                                 input_info.M, D_vec, input_info.N,
-                                                 input_info.probes, r[i],
-                                                 dataset_curves,
-                                                 dataset_curves_ids,
-                                                 dataset_curves_lengths,
-                                                 dataset_curves_offsets,
-                                                 L_grid_dataset_vectors[i]));
+      /* Bulding HyperCube structures */
+      start = high_resolution_clock::now();
+      std::cout << "\nBuilding HyperCube structures.." << std::endl;
+      if (!search::ValidCubeDimensions(input_info.k_hypercube,
+                                         input_info.N)) {
+        utils::report::ReportError(utils::INVALID_k_hypercube);
+      }
+      for (size_t i = 0; i < input_info.L_grid; ++i) {
+        hypercube_structures.
+          push_back(search::curves::HyperCube<T,U>(input_info.k_hypercube,
+                                                   input_info.M, input_info.N,
+                                                   input_info.probes, r[i],
+                                                   dataset_curves,
+                                                   dataset_curves_ids,
+                                                   dataset_curves_lengths,
+                                                   dataset_curves_offsets,
+                                                   L_grid_dataset_vectors[i],
+                                                   search::HAMMING_ORDER,
+                                                   search::RANDOM_SAMPLING,
+                                                   search::AMPLIFIED_HASH,
+                                                   input_info.cubes));
+      }
+      if (!input_info.save_index_file.empty()) {
+        try {
+          utils::snapshot::Writer writer(input_info.save_index_file);
+          search::WriteHyperCubeHeader(writer, seed, input_info.L_grid);
+          for (size_t i = 0; i < input_info.L_grid; ++i) {
+            hypercube_structures[i].Save(writer);
+          }
+          writer.Close();
+        } catch (const std::exception& e) {
+          std::cout << "\n" << e.what() << std::endl;
+          utils::report::ReportError(utils::INVALID_INDEX);
+        }
+      }
+      stop = high_resolution_clock::now();
+      total_time = duration_cast<duration<double>>(stop - start);
+      std::cout << "Building HyperCube structures completed successfully."
+                << std::endl;
+      std::cout << "Time elapsed: " << total_time.count() << " seconds"
+                << std::endl;
     }
-    stop = high_resolution_clock::now();
-    total_time = duration_cast<duration<double>>(stop - start);
-    std::cout << "Building HyperCube structures completed successfully."
-              << std::endl;
-    std::cout << "Time elapsed: " << total_time.count() << " seconds"
-              << std::endl;
 
+    /* Counting the work of the queries, if built with COUNTERS=1 */
+    utils::SearchCounters::Reset();
     /* Executing approximate Nearest Neighbor using HyperCube */
     start = high_resolution_clock::now();
     std::cout << "\nExecuting Nearest Neighbor using HyperCube.." << std::endl;
@@ -285,35 +417,85 @@ int main(int argc, char **argv) {
                                                   query_curves,
                                                   query_curves_lengths,
                                                   query_curves_offsets,
-                                                  L_grid_query_vectors, i);
+                                                  L_grid_query_vectors, i,
+                                                  input_info.exact_grid ?
+                                                    &grid_indices : nullptr,
+                                                  grid_hierarchy.get());
     }
     stop = high_resolution_clock::now();
     total_time = duration_cast<duration<double>>(stop - start);
+    const double search_seconds = total_time.count();
     std::cout << "Executing Nearest Neighbor using HyperCube completed successfully."
               << std::endl;
     std::cout << "Time elapsed: " << total_time.count() << " seconds"
               << std::endl;
 
-    /* Compute Max and Average ratio hypercube_nn_results / bf_nn_results */
-    start = high_resolution_clock::now();
-    std::cout << "\nCalculating evaluation metric.." << std::endl;
-    std::tuple<double,double,int> metric_res{};
-    metric_res = metric::EvaluationMetric(bf_nn_results, approx_nn_results);
-    stop = high_resolution_clock::now();
-    total_time = duration_cast<duration<double>>(stop - start);
-    std::cout << "Calculating evaluation metric completed successfully."
-              << std::endl;
-    std::cout << "Time elapsed: " << total_time.count() << " seconds"
-              << std::endl;
-    std::cout << "\nMax Af: " << std::get<0>(metric_res) << std::endl;
-    std::cout << "Average Af: " << std::get<1>(metric_res) << std::endl;
-    std::cout << "Not found: " << std::get<2>(metric_res) << std::endl;
+    /* Without exact NN there is nothing to compare the results against */
+    if (input_info.no_exact) {
+      std::cout << "\nExact Nearest Neighbor skipped, no Af is computed"
+                << std::endl;
+      std::cout << "Not found: " << std::count_if(approx_nn_results.begin(),
+        approx_nn_results.end(), [](const std::tuple<T,U,double>& result) {
+          return std::get<0>(result) == std::numeric_limits<T>::max();
+        }) << std::endl;
+      utils::counters::Print<utils::SearchCounters>();
+    } else {
+      /* Compute Max and Average ratio hypercube_nn_results / bf_nn_results */
+      start = high_resolution_clock::now();
+      std::cout << "\nCalculating evaluation metric.." << std::endl;
+      std::tuple<double,double,int> metric_res{};
+      metric_res = metric::EvaluationMetric(bf_nn_results, approx_nn_results);
+      stop = high_resolution_clock::now();
+      total_time = duration_cast<duration<double>>(stop - start);
+      std::cout << "Calculating evaluation metric completed successfully."
+                << std::endl;
+      std::cout << "Time elapsed: " << total_time.count() << " seconds"
+                << std::endl;
+      std::cout << "\nMax Af: " << std::get<0>(metric_res) << std::endl;
+      std::cout << "Average Af: " << std::get<1>(metric_res) << std::endl;
+      std::cout << "Not found: " << std::get<2>(metric_res) << std::endl;
+      utils::counters::Print<utils::SearchCounters>();
+
+      /* Writing recall, Af and latency percentiles to the report file */
+      if (!input_info.report_file.empty()) {
+        start = high_resolution_clock::now();
+        std::cout << "\nWriting evaluation report.." << std::endl;
+        std::vector<T> kth_nn_distances;
+        if (input_info.recall_k > 1) {
+          for (size_t i = 0; i < input_info.Q; ++i) {
+            kth_nn_distances.push_back(bf.KthNearestDistance(query_curves,
+              query_curves_lengths, query_curves_offsets, i, input_info.recall_k));
+          }
+        }
+        const metric::Report report = metric::Evaluate(bf_nn_results,
+                                       approx_nn_results, kth_nn_distances,
+                                       input_info.recall_k, search_seconds);
+        try {
+          metric::WriteReport(input_info.report_file, report);
+        } catch (const std::exception& e) {
+          utils::report::ReportError(utils::INVALID_OUTPUT);
+        }
+        stop = high_resolution_clock::now();
+        total_time = duration_cast<duration<double>>(stop - start);
+        std::cout << "Writing evaluation report completed successfully."
+                  << std::endl;
+        std::cout << "Time elapsed: " << total_time.count() << " seconds"
+                  << std::endl;
+        std::cout << "\nRecall@1: " << report.recall_at_1 << std::endl;
+        std::cout << "Recall@" << report.k << ": " << report.recall_at_k << std::endl;
+        std::cout << "Latency p50: " << report.latency.Percentile(0.5)
+                  << " seconds, p99: " << report.latency.Percentile(0.99)
+                  << " seconds" << std::endl;
+        std::cout << "QPS: " << report.qps << std::endl;
+      }
+    }
 
     /* Writing results to the output file */
     start = high_resolution_clock::now();
     std::cout << "\nWriting results to the output file.." << std::endl;
     exit_code = utils::io::WriteFile<T,U>(input_info.output_file,
-      query_curves_ids, bf_nn_results, approx_nn_results, status);
+      query_curves_ids, bf_nn_results, approx_nn_results, input_info.format,
+      status);
     if (exit_code != utils::SUCCESS) {
       utils::report::ReportError(status);
     }
@@ -324,7 +506,17 @@ int main(int argc, char **argv) {
     std::cout << "Time elapsed: " << total_time.count() << " seconds"
               << std::endl;
 
-    /* Ask user if he want to repeat with a different query file */
+    /* Continue with the next query file of the arguments, or ask user if he
+       want to repeat with a different query file */
+    if (next_query < input_info.query_files.size()) {
+      input_info.query_file = input_info.query_files[next_query];
+      input_info.output_file = input_info.output_files[next_query++];
+      input_buffer = "y";
+      continue;
+    }
+    if (input_info.batch) {
+      break;
+    }
     do {
       std::cout << "\nDo you want to provide a different query file (y/n)? : ";
       std::cin >> input_buffer;
@@ -39,6 +39,17 @@ void utils::report::ReportError(const utils::ExitCode& code) {
     case MEMORY_ERROR:
       std::cout << "\n[ERROR]: " << "System ran out of memory" << std::endl;
       break;
+    case INVALID_FORMAT:
+      std::cout << "\n[ERROR]: " << "Invalid output format, expected text,"
+                << " csv, jsonl or binary" << std::endl;
+      break;
+    case MISSING_OUTPUT:
+      std::cout << "\n[ERROR]: " << "Every query file needs an output file"
+                << std::endl;
+      break;
+    case INVALID_INDEX:
+      std::cout << "\n[ERROR]: " << "Invalid HyperCube snapshot" << std::endl;
+      break;
     default:
       abort();
   }
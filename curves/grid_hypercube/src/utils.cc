@@ -7,13 +7,17 @@ void utils::ShowUsage(const std::string &program_name,
   std::cerr << "usage: " << program_name << " [--help] [-d INPUT FILE]"
             << " [-q QUERY FILE] [--k_hypercube INT] [-M INT]"
             << " [--probes INT] [-L_grid INT] [-o OUTPUT FILE]"
+            << " [--cubes INT] [--save_index FILE] [--load_index FILE]"
+            << " [--exact_grid] [--grid_levels INT] [--min_candidates INT]"
+            << " [--r_samples INT] [--report FILE] [--recall_k INT] [--format FORMAT] [--no_exact] [--batch]"
             << "\n\n"
             << "optional arguments:\n"
             << "  --help\tshow this help message and exit\n"
             << "  -d\tdefine the input file\n"
-            << "  -q\tdefine the query file\n"
+            << "  -q\tdefine a query file, repeat -q and -o to search several"
+            << " query files with the same index\n"
             << "  --k_hypercube\tdefine the number of reduced dimensions (default = "
-                  << input_info.k_hypercube << ")\n"
+                  << input_info.k_hypercube << ", at most ceil(log2 N) + 4)\n"
             << "  -M\tdefine max number of candidate points to be checked (default = "
                   << input_info.M << ")\n"
             << "  --probes\tdefine max number of probes to be checked (default = "
@@ -21,6 +25,32 @@ void utils::ShowUsage(const std::string &program_name,
             << "  -L_grid\tdefine the number of LSH hash tables (default = "
                   << input_info.L_grid << ")\n"
             << "  -o\tdefine the output file\n"
+            << "  --exact_grid\tanswer queries with an exact grid curve match before HyperCube\n"
+            << "  --grid_levels\tdefine the number of levels of the grid hierarchy,"
+            << " searched from finest to coarsest before HyperCube (default = "
+                  << static_cast<unsigned int>(input_info.grid_levels) << ")\n"
+            << "  --min_candidates\tdefine the number of candidates needed to stop at"
+            << " a grid hierarchy level (default = "
+                  << input_info.min_candidates << ")\n"
+            << "  --cubes\tdefine the number of independent cubes of each HyperCube (default = "
+                  << static_cast<unsigned int>(input_info.cubes) << ")\n"
+            << "  --save_index\tsave the HyperCubes and the seed of the grids"
+            << " to a snapshot file\n"
+            << "  --load_index\tload the HyperCubes and the grids from a"
+            << " snapshot file instead of building them\n"
+            << "  --r_samples\tdefine the number of dataset curves sampled to estimate R,"
+            << " 0 to average the exact NN distances of the queries (default = "
+                  << input_info.r_samples << ")\n"
+            << "  --report\twrite recall, Af and latency percentiles and QPS to a"
+            << " JSON file, or a CSV file if FILE ends in .csv\n"
+            << "  --recall_k\tdefine k of the recall at k of the report (default = "
+                  << input_info.recall_k << ")\n"
+            << "  --format\tdefine the output file format: text, or csv, jsonl and"
+            << " binary written by a buffered writer (default = "
+                  << input_info.format << ")\n"
+            << "  --no_exact\tskip exact Nearest Neighbor, no Af, recall or"
+            << " report is computed\n"
+            << "  --batch\tnever read stdin, exit after the last query file\n"
             << std::endl;
   exit(EXIT_FAILURE);
 }
@@ -30,16 +60,31 @@ void utils::InputInfo::Print(void) {
   std::cout << "Input file: " << input_file << std::endl;
   std::cout << "Query file: " << query_file << std::endl;
   std::cout << "Output file: " << output_file << std::endl;
+  std::cout << "Exact grid matches: "
+            << (exact_grid ? "yes" : "no") << std::endl;
+  std::cout << "Grid hierarchy levels: "
+            << static_cast<unsigned int>(grid_levels) << std::endl;
+  std::cout << "Grid hierarchy min candidates: "
+            << min_candidates << std::endl;
   std::cout << "Number of dataset points: "
             << static_cast<unsigned int>(N) << std::endl;
   std::cout << "Number of query points: "
             << static_cast<unsigned int>(Q) << std::endl;
   std::cout << "Number of reduced dimensions: "
             << static_cast<unsigned int>(k_hypercube) << std::endl;
+  std::cout << "Number of cubes per HyperCube: "
+            << static_cast<unsigned int>(cubes) << std::endl;
   std::cout << "Number of candidate probes to be checked: "
             << static_cast<unsigned int>(probes) << std::endl;
   std::cout << "Number of candidate points to be checked: "
             << static_cast<unsigned int>(M) << std::endl;
   std::cout << "Number of HyperCube structures: "
             << static_cast<unsigned int>(L_grid) << std::endl;
+  std::cout << "Curves sampled to estimate R: " << r_samples << std::endl;
+  std::cout << "Report file: "
+            << (report_file.empty() ? "none" : report_file) << std::endl;
+  std::cout << "Recall at k: " << recall_k << std::endl;
+  std::cout << "Output format: " << format << std::endl;
+  std::cout << "Exact NN: " << (no_exact ? "no" : "yes") << std::endl;
+  std::cout << "Batch: " << (batch ? "yes" : "no") << std::endl;
 }
@@ -7,6 +7,8 @@
 #include <tuple>
 #include <vector>
 
+#include "../../../core/utils/results.h"
+
 namespace utils {
   namespace io {
     /** \brief ReadFile - Reads file provided by user
@@ -68,16 +70,41 @@ namespace utils {
       @par std::vector<std::tuple<T,U,double>> &approx - Results from LSH
       @par std::vector<std::vector<std::pair<T,U>>> &radius_nn - Results from
         radius NN
+      @par const std::string& format - text, or csv, jsonl and binary written
+        by utils::results::Writer
       @par ExitCode &statues - enumerated ExitCode provided from namespace utils
       return: SUCCESS or FAIL
     */
     template <typename T, typename U>
     int WriteFile(std::string &file_name, std::vector<U>& query_curves_ids,
       std::vector<std::tuple<T,U,double>> &exact,
-      std::vector<std::tuple<T,U,double>> &approx, utils::ExitCode &status) {
+      std::vector<std::tuple<T,U,double>> &approx, const std::string& format,
+      utils::ExitCode &status) {
+
+      utils::results::Format results_format;
+      if (!utils::results::ParseFormat(format, results_format)) {
+        status = INVALID_FORMAT;
+        return FAIL;
+      }
+      if (results_format != utils::results::TEXT) {
+        try {
+          utils::results::Writer<T,U> writer(file_name, results_format);
+          for (size_t i = 0; i < query_curves_ids.size(); ++i) {
+            writer.Write(query_curves_ids[i], approx[i], exact[i]);
+          }
+          writer.Close();
+        } catch (const std::exception& e) {
+          status = INVALID_OUTPUT;
+          return FAIL;
+        }
+        return SUCCESS;
+      }
 
       // Open file
+      // a large buffer and no flush per line, it outlives the stream
+      std::vector<char> buffer(utils::results::kBufferSize);
       std::ofstream outfile;
+      outfile.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
       outfile.open(file_name);
       // Check if file is opened
       if (outfile.is_open()) {
@@ -85,20 +112,20 @@ namespace utils {
         const int Q = query_curves_ids.size();
         /* Print info for each query */
         for (int i = 0; i < Q; ++i) {
-          outfile << "Query: " << query_curves_ids[i] << std::endl;
-          outfile << "Method: Grid" << std::endl;
-          outfile << "HashFunction: LSH" << std::endl;
+          outfile << "Query: " << query_curves_ids[i] << '\n';
+          outfile << "Method: Grid" << '\n';
+          outfile << "HashFunction: LSH" << '\n';
           outfile << "Found Nearest Neighbor: " << std::get<1>(approx[i])
-                  << std::endl;
+                  << '\n';
           outfile << "True Nearest Neighbor: " << std::get<1>(exact[i])
-                  << std::endl;
-          outfile << "distanceFound: " << std::get<0>(approx[i]) << std::endl;
-          outfile << "distanceTrue: " << std::get<0>(exact[i]) << std::endl;
+                  << '\n';
+          outfile << "distanceFound: " << std::get<0>(approx[i]) << '\n';
+          outfile << "distanceTrue: " << std::get<0>(exact[i]) << '\n';
           outfile << "tLSH: " << std::get<2>(approx[i]) << " seconds"
-                  << std::endl;
+                  << '\n';
           outfile << "tTrue: " << std::get<2>(exact[i]) << " seconds"
-                  << std::endl;
-          outfile << std::endl;
+                  << '\n';
+          outfile << '\n';
         }
 
       } else {
@@ -21,7 +21,9 @@ namespace utils {
     INVALID_OUTPUT,
     DATASET_ERROR,
     QUERY_ERROR,
-    MEMORY_ERROR
+    MEMORY_ERROR,
+    INVALID_FORMAT,
+    MISSING_OUTPUT
   } ExitCode;
   /**
     InputInfo - Group all input parameters of curve_grid_lsh in a struct
@@ -32,8 +34,19 @@ namespace utils {
     std::string output_file;     // name of the relative path to the output file
     uint8_t K_vec = 4;           // number of LSH hash functions for each hashTable
     uint8_t L_grid = 5;          // number of LSH Structures
+    bool exact_grid = false;     // answer exact grid curve matches before LSH
+    uint8_t grid_levels = 0;     // number of levels of the grid hierarchy, 0 for none
+    uint32_t min_candidates = 8; // candidates needed to stop at a grid hierarchy level
     uint32_t N;                  // number of dataset curves
     uint32_t Q;                  // number of query curves
+    uint32_t r_samples = 0;      // dataset curves sampled to estimate R, 0 for exact NN
+    std::string report_file;     // evaluation report, CSV if it ends in .csv else JSON
+    uint32_t recall_k = 10;      // rank of the recall at k of the report
+    std::string format = "text"; // output file format: text, csv, jsonl or binary
+    std::vector<std::string> query_files;  // query files of the arguments
+    std::vector<std::string> output_files; // output file of each query file
+    bool no_exact = false;       // skip exact NN, so no Af, recall or report
+    bool batch = false;          // never read stdin, exit after the last query file
     void Print(void);            // print method of the InputInfo struct
   };
   /** \brief ShowUsage - Prints the usage of the program
@@ -6,6 +6,8 @@
 #include <string>
 #include <string.h>
 
+#include "../../../core/utils/results.h"
+
 #include "../includes/utils.h"
 #include "../includes/args_utils.h"
 
@@ -70,13 +72,22 @@ int utils::args::ReadArguments(int argc, char **argv,
     }
   }
 
-  const char * const short_opts = "d:q:k:L:o:";
+  const char * const short_opts = "d:q:k:L:o:xg:m:r:E:K:F:nB";
   const option long_opts[] = {
            {"input", required_argument, nullptr, 'd'},
            {"query", required_argument, nullptr, 'q'},
            {"k_vec", optional_argument, nullptr, 'k'},
            {"L_grid", optional_argument, nullptr, 'L'},
            {"output", required_argument, nullptr, 'o'},
+           {"exact_grid", no_argument, nullptr, 'x'},
+           {"grid_levels", required_argument, nullptr, 'g'},
+           {"min_candidates", required_argument, nullptr, 'm'},
+           {"r_samples", required_argument, nullptr, 'r'},
+           {"report", required_argument, nullptr, 'E'},
+           {"recall_k", required_argument, nullptr, 'K'},
+           {"format", required_argument, nullptr, 'F'},
+           {"no_exact", no_argument, nullptr, 'n'},
+           {"batch", no_argument, nullptr, 'B'},
            {nullptr, no_argument, nullptr, 0}
    };
 
@@ -94,7 +105,7 @@ int utils::args::ReadArguments(int argc, char **argv,
         break;
       }
       case 'q' : {
-        input_info.query_file = optarg;
+        input_info.query_files.push_back(optarg);
         break;
       }
       case 'k': {
@@ -120,7 +131,48 @@ int utils::args::ReadArguments(int argc, char **argv,
         break;
       }
       case 'o': {
-        input_info.output_file = optarg;
+        input_info.output_files.push_back(optarg);
+        break;
+      }
+      case 'x': {
+        input_info.exact_grid = true;
+        break;
+      }
+      case 'g': {
+        input_info.grid_levels = atoi(optarg);
+        break;
+      }
+      case 'm': {
+        input_info.min_candidates = atoi(optarg);
+        break;
+      }
+      case 'r': {
+        input_info.r_samples = atoi(optarg);
+        break;
+      }
+      case 'E': {
+        input_info.report_file = optarg;
+        break;
+      }
+      case 'K': {
+        input_info.recall_k = std::max(atoi(optarg), 1);
+        break;
+      }
+      case 'F': {
+        utils::results::Format format;
+        if (!utils::results::ParseFormat(optarg, format)) {
+          status = INVALID_FORMAT;
+          return FAIL;
+        }
+        input_info.format = optarg;
+        break;
+      }
+      case 'n': {
+        input_info.no_exact = true;
+        break;
+      }
+      case 'B': {
+        input_info.batch = true;
         break;
       }
       case '?':
@@ -129,5 +181,14 @@ int utils::args::ReadArguments(int argc, char **argv,
         abort();
     }
   }
+  /* the first query file is searched first, the rest by main */
+  if (input_info.query_files.size() != input_info.output_files.size()) {
+    status = MISSING_OUTPUT;
+    return FAIL;
+  }
+  if (!input_info.query_files.empty()) {
+    input_info.query_file = input_info.query_files[0];
+    input_info.output_file = input_info.output_files[0];
+  }
   return SUCCESS;
 }
@@ -24,7 +24,10 @@ namespace utils {
     INVALID_OUTPUT,
     DATASET_ERROR,
     QUERY_ERROR,
-    MEMORY_ERROR
+    MEMORY_ERROR,
+    INVALID_FORMAT,
+    MISSING_OUTPUT,
+    INVALID_INDEX
   } ExitCode;
   /**
     InputInfo - Group all input parameters of curve_grid_lsh in a struct
@@ -36,10 +39,23 @@ namespace utils {
     uint8_t M = 10;              // max number of HyperCube's candidate points to be checked
     uint8_t probes = 2;          // max number of HyperCube's verteces to be checked
     uint16_t k_hypercube = 3;    // reduces dimensional space
+    uint8_t cubes = 1;           // number of independent cubes of each HyperCube
     uint8_t L_vec = 5;           // number of HyperCube Structures
     float e = 0.5;               // error rate
+    uint32_t band = 4;           // band of the cells with relevant traversals
+    std::string traversals_cache;// relevant traversals cache file, empty for none
+    std::string load_index_file; // HyperCube snapshots to be loaded instead of built
+    std::string save_index_file; // path to save the HyperCube snapshots
     uint32_t N;                  // number of dataset curves
     uint32_t Q;                  // number of query curves
+    uint32_t r_samples = 0;      // dataset curves sampled to estimate R, 0 for exact NN
+    std::string report_file;     // evaluation report, CSV if it ends in .csv else JSON
+    uint32_t recall_k = 10;      // rank of the recall at k of the report
+    std::string format = "text"; // output file format: text, csv, jsonl or binary
+    std::vector<std::string> query_files;  // query files of the arguments
+    std::vector<std::string> output_files; // output file of each query file
+    bool no_exact = false;       // skip exact NN, so no Af, recall or report
+    bool batch = false;          // never read stdin, exit after the last query file
     void Print(void);            // print method of the InputInfo struct
   };
   /** \brief ShowUsage - Prints the usage of the program
@@ -1,18 +1,28 @@
 #include <algorithm>
 #include <chrono>
 #include <cmath>
+#include <fstream>
 #include <iostream>
 #include <iterator>
+#include <limits>
+#include <memory>
 #include <random>
+#include <stdexcept>
 #include <string>
 #include <tuple>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include "../../../core/hash/hash_function.h"
 #include "../../../core/metric/metric.h"
+#include "../../../core/metric/report.h"
 #include "../../../core/search/brute_force.h"
 #include "../../../core/search/hypercube.h"
+#include "../../../core/utils/counters.h"
+#include "../../../core/utils/estimate.h"
+#include "../../../core/utils/parallel.h"
+#include "../../../core/utils/timing.h"
 #include "../../../core/utils/utils.h"
 
 #include "../../core/vectorization/vectorization.h"
@@ -106,6 +116,78 @@ int main(int argc, char **argv) {
   std::cout << "Time elapsed: " << total_time.count() << " seconds"
             << std::endl;
   M = *max_element(dataset_curves_lengths.begin(), dataset_curves_lengths.end());
+
+  /* Create BruteForce class object, it is shared by every query file */
+  start = high_resolution_clock::now();
+  std::cout << "\nBuilding Brute Force.." << std::endl;
+  search::curves::BruteForce<T,U> bf{dataset_curves, dataset_curves_ids,
+                                     dataset_curves_lengths,
+                                     dataset_curves_offsets};
+  stop = high_resolution_clock::now();
+  total_time = duration_cast<duration<double>>(stop - start);
+  std::cout << "Building Brute Force completed successfully." << std::endl;
+  std::cout << "Time elapsed: " << total_time.count() << " seconds"
+            << std::endl;
+
+  /* The projection is built from a seed, which is stored in HyperCube
+     snapshots so that the vectors of loaded snapshots are computed again */
+  uint64_t seed = std::chrono::system_clock::now().time_since_epoch().count();
+  uint32_t index_count = 0;
+  std::unique_ptr<utils::snapshot::Reader> index;
+  if (!input_info.load_index_file.empty()) {
+    try {
+      index.reset(new utils::snapshot::Reader(search::OpenHyperCubeSnapshot(
+                    input_info.load_index_file, seed, index_count)));
+    } catch (const std::exception& e) {
+      std::cout << "\n" << e.what() << std::endl;
+      utils::report::ReportError(utils::INVALID_INDEX);
+    }
+  }
+
+  /* Create Random Projection class object, dataset curves are vectorized once */
+  start = high_resolution_clock::now();
+  std::cout << "\nBuilding Random Projection.." << std::endl;
+  K = 2 * (-1) * log2(input_info.e) / (input_info.e * input_info.e);
+  vectorization::Projection<T,U> rp{dataset_curves, dataset_curves_offsets,
+                                    dataset_curves_lengths, dataset_curves_ids,
+                                    input_info.N, K, input_info.band, seed};
+  if (!input_info.traversals_cache.empty() &&
+      std::ifstream(input_info.traversals_cache).good()) {
+    try {
+      rp.LoadTraversals(input_info.traversals_cache);
+    } catch (const std::exception& e) {
+      std::cout << "\n" << e.what() << ", computing relevant traversals"
+                << std::endl;
+    }
+  }
+  stop = high_resolution_clock::now();
+  total_time = duration_cast<duration<double>>(stop - start);
+  std::cout << "Building Random Projection completed successfully."
+            << std::endl;
+  std::cout << "Time elapsed: " << total_time.count() << " seconds"
+            << std::endl;
+
+  start = high_resolution_clock::now();
+  std::cout << "\nVectorizing dataset curves using Random Projection method.."
+            << std::endl;
+  rp.Vectorize();
+  stop = high_resolution_clock::now();
+  total_time = duration_cast<duration<double>>(stop - start);
+  std::cout << "Vectorizing dataset curves using Random Projection method completed."
+            << std::endl;
+  std::cout << "Time elapsed: " << total_time.count() << " seconds"
+            << std::endl;
+
+  /* Start the threads of the shared pool and calibrate the query timer
+     before any query is timed */
+  utils::parallel::SharedPool();
+  utils::QueryTiming::Calibrate();
+
+  /* HyperCube structures are built for the first query file and searched
+     by the rest */
+  std::unordered_map<int,std::vector<search::curves::HyperCube<T,U>>> hypercube_structures;
+  bool built = false;
+  size_t next_query = 1;
   do {
     /* Preprocessing query file to get number of query curves */
     start = high_resolution_clock::now();
@@ -143,64 +225,37 @@ int main(int argc, char **argv) {
 
     /* Print input info */
     input_info.Print();
-    /* Create BruteForce class object and a vector to store exact-NN results */
-    start = high_resolution_clock::now();
-    std::cout << "\nBuilding Brute Force.." << std::endl;
-    std::vector<std::tuple<T,U,double>> bf_nn_results(input_info.Q);
-    search::curves::BruteForce<T,U> bf{dataset_curves, dataset_curves_ids,
-                                       dataset_curves_lengths,
-                                       dataset_curves_offsets};
-    stop = high_resolution_clock::now();
-    total_time = duration_cast<duration<double>>(stop - start);
-    std::cout << "Building Brute Force completed successfully." << std::endl;
-    std::cout << "Time elapsed: " << total_time.count() << " seconds"
-              << std::endl;
-
-    /* Executing Exact Nearest Neighbor using BruteForce */
-    start = high_resolution_clock::now();
-    std::cout << "\nExecuting Nearest Neighbor using Brute Force.." << std::endl;
-    for (size_t i = 0; i < input_info.Q; ++i) {
-      bf_nn_results[i] = bf.NearestNeighbor(query_curves, query_curves_lengths,
-                                            query_curves_offsets, i);
+    /* Executing Exact Nearest Neighbor using BruteForce, unless skipped */
+    std::vector<std::tuple<T,U,double>> bf_nn_results(input_info.Q,
+      std::make_tuple(std::numeric_limits<T>::max(), U{},
+                      utils::timing::kNotTimed));
+    if (!input_info.no_exact) {
+      start = high_resolution_clock::now();
+      std::cout << "\nExecuting Nearest Neighbor using Brute Force.." << std::endl;
+      for (size_t i = 0; i < input_info.Q; ++i) {
+        bf_nn_results[i] = bf.NearestNeighbor(query_curves, query_curves_lengths,
+                                              query_curves_offsets, i);
+      }
+      stop = high_resolution_clock::now();
+      total_time = duration_cast<duration<double>>(stop - start);
+      std::cout << "Executing Nearest Neighbor using Brute Force completed successfully."
+                << std::endl;
+      std::cout << "Time elapsed: " << total_time.count() << " seconds"
+                << std::endl;
     }
-    stop = high_resolution_clock::now();
-    total_time = duration_cast<duration<double>>(stop - start);
-    std::cout << "Executing Nearest Neighbor using Brute Force completed successfully."
-              << std::endl;
-    std::cout << "Time elapsed: " << total_time.count() << " seconds"
-              << std::endl;
-
-    /* Create Random Projection class object and a vector to store exact-NN results */
-    start = high_resolution_clock::now();
-    std::cout << "\nBuilding Random Projection.." << std::endl;
-    K = 2 * (-1) * log2(input_info.e) / (input_info.e * input_info.e);
-    std::vector<std::tuple<T,U,double>> rp_nn_results(input_info.Q);
-    vectorization::Projection<T,U> rp{dataset_curves, dataset_curves_offsets,
-                                      dataset_curves_lengths, dataset_curves_ids,
-                                      input_info.N, K};
-    stop = high_resolution_clock::now();
-    total_time = duration_cast<duration<double>>(stop - start);
-    std::cout << "Building Random Projection completed successfully."
-              << std::endl;
-    std::cout << "Time elapsed: " << total_time.count() << " seconds"
-              << std::endl;
-
-    start = high_resolution_clock::now();
-    std::cout << "\nVectorizing dataset curves using Random Projection method.."
-              << std::endl;
-    rp.Vectorize();
-    stop = high_resolution_clock::now();
-    total_time = duration_cast<duration<double>>(stop - start);
-    std::cout << "Vectorizing dataset curves using Random Projection method completed."
-              << std::endl;
-    std::cout << "Time elapsed: " << total_time.count() << " seconds"
-              << std::endl;
 
     start = high_resolution_clock::now();
     std::cout << "\nVectorizing query curves using Random Projection method.."
               << std::endl;
     rp.Vectorize(input_info.Q, query_curves, query_curves_lengths,
-                 query_curves_offsets, query_curves_ids);
+                 query_curves_offsets);
+    if (!input_info.traversals_cache.empty()) {
+      try {
+        rp.SaveTraversals(input_info.traversals_cache);
+      } catch (const std::exception& e) {
+        std::cout << "\n" << e.what() << std::endl;
+      }
+    }
     stop = high_resolution_clock::now();
     total_time = duration_cast<duration<double>>(stop - start);
     std::cout << "Vectorizing dataset curves using Random Projection method completed."
@@ -208,61 +263,107 @@ int main(int argc, char **argv) {
     std::cout << "Time elapsed: " << total_time.count() << " seconds"
               << std::endl;
 
-    /* Comptuing window parameter as k * R used by LSH and HyperCube */
-    start = high_resolution_clock::now();
-    std::cout << "\nComputing window parameter.." << std::endl;
-    r = utils::ComputeParameterR(bf_nn_results);
-    stop = high_resolution_clock::now();
-    total_time = duration_cast<duration<double>>(stop - start);
-    std::cout << "Computing window parameter completed successfully."
-              << std::endl;
-    std::cout << "Time elapsed: " << total_time.count() << " seconds"
-              << std::endl;
-
-    std::unordered_map<std::tuple<int,int,int>,
-        std::vector<double>> vectors = rp.GetVectors();
-    const std::unordered_map<std::tuple<int,int,int>,
-        std::vector<int>>& vectors_length = rp.GetVectorsLengths();
-    const std::unordered_map<std::tuple<int,int,int>,
-        std::vector<int>>& vectors_offsets = rp.GetVectorsOffsets();
-    const std::unordered_map<std::tuple<int,int,int>,
-        std::vector<U>>& vectors_ids = rp.GetVectorsIds();
-
-    std::unordered_map<U,
-        std::vector<double>> qvectors = rp.qGetVectors();
-    const std::unordered_map<U,
-        std::vector<int>>& qvectors_length = rp.qGetVectorsLengths();
-    const std::unordered_map<U,
-        std::vector<int>>& qvectors_offsets = rp.qGetVectorsOffsets();
-    const std::unordered_map<U,
-        std::vector<U>>& qvectors_ids = rp.qGetVectorsIds();
+    if (!built && !input_info.load_index_file.empty()) {
+      /* Loading HyperCube structures of the same projection */
+      start = high_resolution_clock::now();
+      std::cout << "\nLoading HyperCube structures.." << std::endl;
+      try {
+        if (index_count != rp.GetSlots()) {
+          throw std::runtime_error("snapshot of a different projection");
+        }
+        for (uint32_t s = 0; s < rp.GetSlots(); ++s) {
+          hypercube_structures[std::get<1>(rp.GetSlot(s))].
+            push_back(search::curves::HyperCube<T,U>(
+                        *index, input_info.M, rp.GetVectors(s).size() / K,
+                        input_info.probes, dataset_curves,
+                        rp.GetVectorsIds(s), rp.GetVectorsLengths(s),
+                        rp.GetVectorsOffsets(s),
+                        utils::RaggedView<double>(rp.GetVectors(s).data(), K)));
+        }
+      } catch (const std::exception& e) {
+        std::cout << "\n" << e.what() << std::endl;
+        utils::report::ReportError(utils::INVALID_INDEX);
+      }
+      stop = high_resolution_clock::now();
+      total_time = duration_cast<duration<double>>(stop - start);
+      std::cout << "Loading HyperCube structures completed successfully."
+                << std::endl;
+      std::cout << "Time elapsed: " << total_time.count() << " seconds"
+                << std::endl;
+      built = true;
+    }
+    if (!built) {
+      /* Comptuing window parameter as k * R used by LSH and HyperCube */
+      start = high_resolution_clock::now();
+      std::cout << "\nComputing window parameter.." << std::endl;
+      if (input_info.r_samples > 0 || input_info.no_exact) {
+        uint32_t samples;
+        std::tie(r, samples) = utils::EstimateParameterR(dataset_curves,
+          dataset_curves_lengths, dataset_curves_offsets,
+          input_info.r_samples > 0 ? input_info.r_samples : utils::kRSamples);
+        std::cout << "Estimated R from " << samples << " sampled curves"
+                  << std::endl;
+      } else {
+        r = utils::ComputeParameterR(bf_nn_results);
+      }
+      stop = high_resolution_clock::now();
+      total_time = duration_cast<duration<double>>(stop - start);
+      std::cout << "Computing window parameter completed successfully."
+                << std::endl;
+      std::cout << "Time elapsed: " << total_time.count() << " seconds"
+                << std::endl;
 
-    // /* Bulding HyperCube structures */
-    start = high_resolution_clock::now();
-    std::cout << "\nBuilding HyperCube structures.." << std::endl;
-    std::unordered_map<int,std::vector<search::curves::HyperCube<T,U>>> hypercube_structures;
-    for (auto& bucket:vectors) {
-      std::tuple<int,int,int> key = std::make_tuple(std::get<0>(bucket.first),
-                                                    std::get<1>(bucket.first),
-                                                    std::get<2>(bucket.first));
-      hypercube_structures[std::get<1>(bucket.first)].
-        push_back(search::curves::HyperCube<T,U>(input_info.k_hypercube,
-                                                 input_info.M, K,
-                                                 bucket.second.size() / K,
-                                                 input_info.probes, r,
-                                                 dataset_curves,
-                                                 vectors_ids.at(key),
-                                                 vectors_length.at(key),
-                                                 vectors_offsets.at(key),
-                                                 bucket.second));
+      // /* Bulding HyperCube structures */
+      start = high_resolution_clock::now();
+      std::cout << "\nBuilding HyperCube structures.." << std::endl;
+      if (!search::ValidCubeDimensions(input_info.k_hypercube,
+                                         input_info.N)) {
+        utils::report::ReportError(utils::INVALID_k_hypercube);
+      }
+      for (uint32_t s = 0; s < rp.GetSlots(); ++s) {
+        hypercube_structures[std::get<1>(rp.GetSlot(s))].
+          push_back(search::curves::HyperCube<T,U>(input_info.k_hypercube,
+                                                   input_info.M,
+                                                   rp.GetVectors(s).size() / K,
+                                                   input_info.probes, r,
+                                                   dataset_curves,
+                                                   rp.GetVectorsIds(s),
+                                                   rp.GetVectorsLengths(s),
+                                                   rp.GetVectorsOffsets(s),
+                                                   utils::RaggedView<double>(
+                                                     rp.GetVectors(s).data(), K),
+                                                   search::HAMMING_ORDER,
+                                                   search::RANDOM_SAMPLING,
+                                                   search::AMPLIFIED_HASH,
+                                                   input_info.cubes));
+      }
+      if (!input_info.save_index_file.empty()) {
+        try {
+          /* slots are saved in order, those of a key share its vector */
+          utils::snapshot::Writer writer(input_info.save_index_file);
+          search::WriteHyperCubeHeader(writer, seed, rp.GetSlots());
+          std::unordered_map<int,size_t> next;
+          for (uint32_t s = 0; s < rp.GetSlots(); ++s) {
+            const int key = std::get<1>(rp.GetSlot(s));
+            hypercube_structures[key][next[key]++].Save(writer);
+          }
+          writer.Close();
+        } catch (const std::exception& e) {
+          std::cout << "\n" << e.what() << std::endl;
+          utils::report::ReportError(utils::INVALID_INDEX);
+        }
+      }
+      stop = high_resolution_clock::now();
+      total_time = duration_cast<duration<double>>(stop - start);
+      std::cout << "Building HyperCube structures completed successfully."
+                << std::endl;
+      std::cout << "Time elapsed: " << total_time.count() << " seconds"
+                << std::endl;
+      built = true;
     }
-    stop = high_resolution_clock::now();
-    total_time = duration_cast<duration<double>>(stop - start);
-    std::cout << "Building HyperCube structures completed successfully."
-              << std::endl;
-    std::cout << "Time elapsed: " << total_time.count() << " seconds"
-              << std::endl;
 
+    /* Counting the work of the queries, if built with COUNTERS=1 */
+    utils::SearchCounters::Reset();
     /* Executing approximate Nearest Neighbor using HyperCube */
     start = high_resolution_clock::now();
     std::cout << "\nExecuting Nearest Neighbor using HyperCube.." << std::endl;
@@ -272,39 +373,86 @@ int main(int argc, char **argv) {
       approx_nn_results[i] = search::curves::projection_search(
                                                   hypercube_structures,
                                                   query_curves,
-                                                  qvectors_length,
-                                                  qvectors_offsets,
-                                                  qvectors,
+                                                  rp.qGetVectorsLengths(i),
+                                                  rp.qGetVectorsOffsets(i),
+                                                  rp.qGetVectors(i),
                                                   query_curves_lengths[i]-1, M,
                                                   id);
     }
     stop = high_resolution_clock::now();
     total_time = duration_cast<duration<double>>(stop - start);
+    const double search_seconds = total_time.count();
     std::cout << "Executing Nearest Neighbor using HyperCube completed successfully."
               << std::endl;
     std::cout << "Time elapsed: " << total_time.count() << " seconds"
               << std::endl;
 
-    /* Compute Max and Average ratio hypercube_nn_results / bf_nn_results */
-    start = high_resolution_clock::now();
-    std::cout << "\nCalculating evaluation metric.." << std::endl;
-    std::tuple<double,double,int> metric_res{};
-    metric_res = metric::EvaluationMetric(bf_nn_results, approx_nn_results);
-    stop = high_resolution_clock::now();
-    total_time = duration_cast<duration<double>>(stop - start);
-    std::cout << "Calculating evaluation metric completed successfully."
-              << std::endl;
-    std::cout << "Time elapsed: " << total_time.count() << " seconds"
-              << std::endl;
-    std::cout << "\nMax Af: " << std::get<0>(metric_res) << std::endl;
-    std::cout << "Average Af: " << std::get<1>(metric_res) << std::endl;
-    std::cout << "Not found: " << std::get<2>(metric_res) << std::endl;
+    /* Without exact NN there is nothing to compare the results against */
+    if (input_info.no_exact) {
+      std::cout << "\nExact Nearest Neighbor skipped, no Af is computed"
+                << std::endl;
+      std::cout << "Not found: " << std::count_if(approx_nn_results.begin(),
+        approx_nn_results.end(), [](const std::tuple<T,U,double>& result) {
+          return std::get<0>(result) == std::numeric_limits<T>::max();
+        }) << std::endl;
+      utils::counters::Print<utils::SearchCounters>();
+    } else {
+      /* Compute Max and Average ratio hypercube_nn_results / bf_nn_results */
+      start = high_resolution_clock::now();
+      std::cout << "\nCalculating evaluation metric.." << std::endl;
+      std::tuple<double,double,int> metric_res{};
+      metric_res = metric::EvaluationMetric(bf_nn_results, approx_nn_results);
+      stop = high_resolution_clock::now();
+      total_time = duration_cast<duration<double>>(stop - start);
+      std::cout << "Calculating evaluation metric completed successfully."
+                << std::endl;
+      std::cout << "Time elapsed: " << total_time.count() << " seconds"
+                << std::endl;
+      std::cout << "\nMax Af: " << std::get<0>(metric_res) << std::endl;
+      std::cout << "Average Af: " << std::get<1>(metric_res) << std::endl;
+      std::cout << "Not found: " << std::get<2>(metric_res) << std::endl;
+      utils::counters::Print<utils::SearchCounters>();
+
+      /* Writing recall, Af and latency percentiles to the report file */
+      if (!input_info.report_file.empty()) {
+        start = high_resolution_clock::now();
+        std::cout << "\nWriting evaluation report.." << std::endl;
+        std::vector<T> kth_nn_distances;
+        if (input_info.recall_k > 1) {
+          for (size_t i = 0; i < input_info.Q; ++i) {
+            kth_nn_distances.push_back(bf.KthNearestDistance(query_curves,
+              query_curves_lengths, query_curves_offsets, i, input_info.recall_k));
+          }
+        }
+        const metric::Report report = metric::Evaluate(bf_nn_results,
+                                       approx_nn_results, kth_nn_distances,
+                                       input_info.recall_k, search_seconds);
+        try {
+          metric::WriteReport(input_info.report_file, report);
+        } catch (const std::exception& e) {
+          utils::report::ReportError(utils::INVALID_OUTPUT);
+        }
+        stop = high_resolution_clock::now();
+        total_time = duration_cast<duration<double>>(stop - start);
+        std::cout << "Writing evaluation report completed successfully."
+                  << std::endl;
+        std::cout << "Time elapsed: " << total_time.count() << " seconds"
+                  << std::endl;
+        std::cout << "\nRecall@1: " << report.recall_at_1 << std::endl;
+        std::cout << "Recall@" << report.k << ": " << report.recall_at_k << std::endl;
+        std::cout << "Latency p50: " << report.latency.Percentile(0.5)
+                  << " seconds, p99: " << report.latency.Percentile(0.99)
+                  << " seconds" << std::endl;
+        std::cout << "QPS: " << report.qps << std::endl;
+      }
+    }
 
     /* Writing results to the output file */
     start = high_resolution_clock::now();
     std::cout << "\nWriting results to the output file.." << std::endl;
     exit_code = utils::io::WriteFile<T,U>(input_info.output_file,
-      query_curves_ids, bf_nn_results, approx_nn_results, status);
+      query_curves_ids, bf_nn_results, approx_nn_results, input_info.format,
+      status);
     if (exit_code != utils::SUCCESS) {
       utils::report::ReportError(status);
     }
@@ -315,7 +463,17 @@ int main(int argc, char **argv) {
     std::cout << "Time elapsed: " << total_time.count() << " seconds"
               << std::endl;
 
-    /* Ask user if he want to repeat with a different query file */
+    /* Continue with the next query file of the arguments, or ask user if he
+       want to repeat with a different query file */
+    if (next_query < input_info.query_files.size()) {
+      input_info.query_file = input_info.query_files[next_query];
+      input_info.output_file = input_info.output_files[next_query++];
+      input_buffer = "y";
+      continue;
+    }
+    if (input_info.batch) {
+      break;
+    }
     do {
       std::cout << "\nDo you want to provide a different query file (y/n)? : ";
       std::cin >> input_buffer;
@@ -7,13 +7,17 @@ void utils::ShowUsage(const std::string &program_name,
   std::cerr << "usage: " << program_name << " [--help] [-d INPUT FILE]"
             << " [-q QUERY FILE] [--k_hypercube INT] [-M INT]"
             << " [--probes INT] [-L_grid INT] [-o OUTPUT FILE]"
+            << " [--band INT] [--traversals_cache FILE]"
+            << " [--cubes INT] [--save_index FILE] [--load_index FILE]"
+            << " [--r_samples INT] [--report FILE] [--recall_k INT] [--format FORMAT] [--no_exact] [--batch]"
             << "\n\n"
             << "optional arguments:\n"
             << "  --help\tshow this help message and exit\n"
             << "  -d\tdefine the input file\n"
-            << "  -q\tdefine the query file\n"
+            << "  -q\tdefine a query file, repeat -q and -o to search several"
+            << " query files with the same index\n"
             << "  --k_hypercube\tdefine the number of reduced dimensions (default = "
-                  << input_info.k_hypercube << ")\n"
+                  << input_info.k_hypercube << ", at most ceil(log2 N) + 4)\n"
             << "  -M\tdefine max number of candidate points to be checked (default = "
                   << input_info.M << ")\n"
             << "  --probes\tdefine max number of probes to be checked (default = "
@@ -21,6 +25,28 @@ void utils::ShowUsage(const std::string &program_name,
             << "  -L_vec\tdefine the number of LSH hash tables (default = "
                   << input_info.L_vec << ")\n"
             << "  -o\tdefine the output file\n"
+            << "  --band\tdefine the band of the cells with relevant traversals (default = "
+                  << input_info.band << ")\n"
+            << "  --traversals_cache\tload relevant traversals from and save them to a cache file\n"
+            << "  --cubes\tdefine the number of independent cubes of each HyperCube (default = "
+                  << static_cast<unsigned int>(input_info.cubes) << ")\n"
+            << "  --save_index\tsave the HyperCubes and the seed of the"
+            << " projection to a snapshot file\n"
+            << "  --load_index\tload the HyperCubes and the projection from a"
+            << " snapshot file instead of building them\n"
+            << "  --r_samples\tdefine the number of dataset curves sampled to estimate R,"
+            << " 0 to average the exact NN distances of the queries (default = "
+                  << input_info.r_samples << ")\n"
+            << "  --report\twrite recall, Af and latency percentiles and QPS to a"
+            << " JSON file, or a CSV file if FILE ends in .csv\n"
+            << "  --recall_k\tdefine k of the recall at k of the report (default = "
+                  << input_info.recall_k << ")\n"
+            << "  --format\tdefine the output file format: text, or csv, jsonl and"
+            << " binary written by a buffered writer (default = "
+                  << input_info.format << ")\n"
+            << "  --no_exact\tskip exact Nearest Neighbor, no Af, recall or"
+            << " report is computed\n"
+            << "  --batch\tnever read stdin, exit after the last query file\n"
             << std::endl;
   exit(EXIT_FAILURE);
 }
@@ -36,10 +62,23 @@ void utils::InputInfo::Print(void) {
             << static_cast<unsigned int>(Q) << std::endl;
   std::cout << "Number of reduced dimensions: "
             << static_cast<unsigned int>(k_hypercube) << std::endl;
+  std::cout << "Number of cubes per HyperCube: "
+            << static_cast<unsigned int>(cubes) << std::endl;
   std::cout << "Number of candidate probes to be checked: "
             << static_cast<unsigned int>(probes) << std::endl;
   std::cout << "Number of candidate points to be checked: "
             << static_cast<unsigned int>(M) << std::endl;
   std::cout << "Number of HyperCube structures: "
             << static_cast<unsigned int>(L_vec) << std::endl;
+  std::cout << "Traversals band: " << band << std::endl;
+  std::cout << "Traversals cache: "
+            << (traversals_cache.empty() ? "none" : traversals_cache)
+            << std::endl;
+  std::cout << "Curves sampled to estimate R: " << r_samples << std::endl;
+  std::cout << "Report file: "
+            << (report_file.empty() ? "none" : report_file) << std::endl;
+  std::cout << "Recall at k: " << recall_k << std::endl;
+  std::cout << "Output format: " << format << std::endl;
+  std::cout << "Exact NN: " << (no_exact ? "no" : "yes") << std::endl;
+  std::cout << "Batch: " << (batch ? "yes" : "no") << std::endl;
 }
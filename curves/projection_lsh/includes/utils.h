@@ -21,7 +21,9 @@ namespace utils {
     INVALID_OUTPUT,
     DATASET_ERROR,
     QUERY_ERROR,
-    MEMORY_ERROR
+    MEMORY_ERROR,
+    INVALID_FORMAT,
+    MISSING_OUTPUT
   } ExitCode;
   /**
     InputInfo - Group all input parameters of curve_grid_lsh in a struct
@@ -35,6 +37,17 @@ namespace utils {
     uint32_t N;                  // number of dataset curves
     uint32_t Q;                  // number of query curves
     float e = 0.5;               // error
+    uint32_t band = 4;           // band of the cells with relevant traversals
+    std::string traversals_cache;// relevant traversals cache file, empty for none
+    bool shared_hash = false;    // one hash family and table for all traversals
+    uint32_t r_samples = 0;      // dataset curves sampled to estimate R, 0 for exact NN
+    std::string report_file;     // evaluation report, CSV if it ends in .csv else JSON
+    uint32_t recall_k = 10;      // rank of the recall at k of the report
+    std::string format = "text"; // output file format: text, csv, jsonl or binary
+    std::vector<std::string> query_files;  // query files of the arguments
+    std::vector<std::string> output_files; // output file of each query file
+    bool no_exact = false;       // skip exact NN, so no Af, recall or report
+    bool batch = false;          // never read stdin, exit after the last query file
     void Print(void);            // print method of the InputInfo struct
   };
   /** \brief ShowUsage - Prints the usage of the program
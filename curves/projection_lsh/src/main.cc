@@ -1,8 +1,11 @@
 #include <algorithm>
 #include <chrono>
 #include <cmath>
+#include <fstream>
 #include <iostream>
 #include <iterator>
+#include <limits>
+#include <memory>
 #include <random>
 #include <string>
 #include <tuple>
@@ -11,8 +14,13 @@
 
 #include "../../../core/hash/hash_function.h"
 #include "../../../core/metric/metric.h"
+#include "../../../core/metric/report.h"
 #include "../../../core/search/brute_force.h"
 #include "../../../core/search/lsh.h"
+#include "../../../core/utils/counters.h"
+#include "../../../core/utils/estimate.h"
+#include "../../../core/utils/parallel.h"
+#include "../../../core/utils/timing.h"
 #include "../../../core/utils/utils.h"
 
 #include "../../core/vectorization/vectorization.h"
@@ -65,46 +73,104 @@ int main(int argc, char **argv) {
     default:
       break;
   }
-  do {
-    /* Preprocessing input file to get number of dataset curves */
-    auto start = high_resolution_clock::now();
-    std::cout << "\nGetting number of dataset curves.." << std::endl;
-    exit_code = utils::io::GetDataCurves(input_info.input_file,
-                                          input_info.N, status);
-    if (exit_code != utils::SUCCESS) {
-      utils::report::ReportError(status);
-    }
-    auto stop = high_resolution_clock::now();
-    duration <double> total_time = duration_cast<duration<double>>(stop - start);
-    std::cout << "Getting number of dataset curves completed successfully."
-              << std::endl;
-    std::cout << "Time elapsed: " << total_time.count() << " seconds"
-              << std::endl;
+  /* Preprocessing input file to get number of dataset curves */
+  auto start = high_resolution_clock::now();
+  std::cout << "\nGetting number of dataset curves.." << std::endl;
+  exit_code = utils::io::GetDataCurves(input_info.input_file,
+                                       input_info.N, status);
+  if (exit_code != utils::SUCCESS) {
+    utils::report::ReportError(status);
+  }
+  auto stop = high_resolution_clock::now();
+  duration <double> total_time = duration_cast<duration<double>>(stop - start);
+  std::cout << "Getting number of dataset curves completed successfully."
+            << std::endl;
+  std::cout << "Time elapsed: " << total_time.count() << " seconds"
+            << std::endl;
 
-    /*
-      Read dataset and create 1D vector of pairs which stores sequentially each
-      curve of lenth m_i. Also create 1D vector that stores curves' ids and
-      curves' length. 1D vector of curves representation support cache efficiency
-      and as a result, faster computations
-    */
-    start = high_resolution_clock::now();
-    std::cout << "\nReading input file.." << std::endl;
-    std::vector<std::pair<T,T>> dataset_curves;
-    std::vector<U> dataset_curves_ids(input_info.N);
-    std::vector<int> dataset_curves_lengths(input_info.N);
-    std::vector<int> dataset_curves_offsets(input_info.N);
-    exit_code = utils::io::ReadFile<T,U>(input_info.input_file, input_info.N,
-      dataset_curves, dataset_curves_ids, dataset_curves_lengths,
-      dataset_curves_offsets, status);
-    if (exit_code != utils::SUCCESS) {
-      utils::report::ReportError(status);
+  /*
+    Read dataset and create 1D vector of pairs which stores sequentially each
+    curve of lenth m_i. Also create 1D vector that stores curves' ids and
+    curves' length. 1D vector of curves representation support cache efficiency
+    and as a result, faster computations
+  */
+  start = high_resolution_clock::now();
+  std::cout << "\nReading input file.." << std::endl;
+  std::vector<std::pair<T,T>> dataset_curves;
+  std::vector<U> dataset_curves_ids(input_info.N);
+  std::vector<int> dataset_curves_lengths(input_info.N);
+  std::vector<int> dataset_curves_offsets(input_info.N);
+  exit_code = utils::io::ReadFile<T,U>(input_info.input_file, input_info.N,
+    dataset_curves, dataset_curves_ids, dataset_curves_lengths,
+    dataset_curves_offsets, status);
+  if (exit_code != utils::SUCCESS) {
+    utils::report::ReportError(status);
+  }
+  stop = high_resolution_clock::now();
+  total_time = duration_cast<duration<double>>(stop - start);
+  std::cout << "Reading input file completed successfully." << std::endl;
+  std::cout << "Time elapsed: " << total_time.count() << " seconds"
+            << std::endl;
+  M = *max_element(dataset_curves_lengths.begin(), dataset_curves_lengths.end());
+
+  /* Create BruteForce class object, it is shared by every query file */
+  start = high_resolution_clock::now();
+  std::cout << "\nBuilding Brute Force.." << std::endl;
+  search::curves::BruteForce<T,U> bf{dataset_curves, dataset_curves_ids,
+                                     dataset_curves_lengths,
+                                     dataset_curves_offsets};
+  stop = high_resolution_clock::now();
+  total_time = duration_cast<duration<double>>(stop - start);
+  std::cout << "Building Brute Force completed successfully." << std::endl;
+  std::cout << "Time elapsed: " << total_time.count() << " seconds"
+            << std::endl;
+
+  /* Create Random Projection class object, dataset curves are vectorized once */
+  start = high_resolution_clock::now();
+  std::cout << "\nBuilding Random Projection.." << std::endl;
+  K = 2 * (-1) * log2(input_info.e) / (input_info.e * input_info.e);
+  vectorization::Projection<T,U> rp{dataset_curves, dataset_curves_offsets,
+                                    dataset_curves_lengths, dataset_curves_ids,
+                                    input_info.N, K, input_info.band};
+  if (!input_info.traversals_cache.empty() &&
+      std::ifstream(input_info.traversals_cache).good()) {
+    try {
+      rp.LoadTraversals(input_info.traversals_cache);
+    } catch (const std::exception& e) {
+      std::cout << "\n" << e.what() << ", computing relevant traversals"
+                << std::endl;
     }
-    stop = high_resolution_clock::now();
-    total_time = duration_cast<duration<double>>(stop - start);
-    std::cout << "Reading input file completed successfully." << std::endl;
-    std::cout << "Time elapsed: " << total_time.count() << " seconds"
-              << std::endl;
-    M = *max_element(dataset_curves_lengths.begin(), dataset_curves_lengths.end());
+  }
+  stop = high_resolution_clock::now();
+  total_time = duration_cast<duration<double>>(stop - start);
+  std::cout << "Building Random Projection completed successfully." << std::endl;
+  std::cout << "Time elapsed: " << total_time.count() << " seconds"
+            << std::endl;
+
+  start = high_resolution_clock::now();
+  std::cout << "\nVectorizing dataset curves using Random Projection method.."
+            << std::endl;
+  rp.Vectorize();
+  stop = high_resolution_clock::now();
+  total_time = duration_cast<duration<double>>(stop - start);
+  std::cout << "Vectorizing dataset curves using Random Projection method completed."
+            << std::endl;
+  std::cout << "Time elapsed: " << total_time.count() << " seconds"
+            << std::endl;
+
+  /* Start the threads of the shared pool and calibrate the query timer
+     before any query is timed */
+  utils::parallel::SharedPool();
+  utils::QueryTiming::Calibrate();
+
+  /* LSH structures are built for the first query file and searched by the
+     rest. In shared mode all traversals are tenants of one LSH, grouped by j */
+  std::unordered_map<int,std::vector<search::curves::LSH<T,U>>> lsh_structures;
+  std::unique_ptr<search::curves::SharedLSH<T,U>> shared_lsh;
+  std::unordered_map<int,std::vector<uint32_t>> lsh_tenants;
+  bool built = false;
+  size_t next_query = 1;
+  do {
     /* Preprocessing query file to get number of query curves */
     start = high_resolution_clock::now();
     std::cout << "\nGetting number of query curves.." << std::endl;
@@ -142,63 +208,37 @@ int main(int argc, char **argv) {
     /* Print input info */
     input_info.Print();
 
-    /* Create BruteForce class object and a vector to store exact-NN results */
-    start = high_resolution_clock::now();
-    std::cout << "\nBuilding Brute Force.." << std::endl;
-    std::vector<std::tuple<T,U,double>> bf_nn_results(input_info.Q);
-    search::curves::BruteForce<T,U> bf{dataset_curves, dataset_curves_ids,
-                                        dataset_curves_lengths,
-                                        dataset_curves_offsets};
-    stop = high_resolution_clock::now();
-    total_time = duration_cast<duration<double>>(stop - start);
-    std::cout << "Building Brute Force completed successfully." << std::endl;
-    std::cout << "Time elapsed: " << total_time.count() << " seconds"
-              << std::endl;
-
-    /* Executing Exact Nearest Neighbor using BruteForce */
-    start = high_resolution_clock::now();
-    std::cout << "\nExecuting Nearest Neighbor using Brute Force.." << std::endl;
-    for (size_t i = 0; i < input_info.Q; ++i) {
-      bf_nn_results[i] = bf.NearestNeighbor(query_curves, query_curves_lengths,
-                                            query_curves_offsets, i);
+    /* Executing Exact Nearest Neighbor using BruteForce, unless skipped */
+    std::vector<std::tuple<T,U,double>> bf_nn_results(input_info.Q,
+      std::make_tuple(std::numeric_limits<T>::max(), U{},
+                      utils::timing::kNotTimed));
+    if (!input_info.no_exact) {
+      start = high_resolution_clock::now();
+      std::cout << "\nExecuting Nearest Neighbor using Brute Force.." << std::endl;
+      for (size_t i = 0; i < input_info.Q; ++i) {
+        bf_nn_results[i] = bf.NearestNeighbor(query_curves, query_curves_lengths,
+                                              query_curves_offsets, i);
+      }
+      stop = high_resolution_clock::now();
+      total_time = duration_cast<duration<double>>(stop - start);
+      std::cout << "Executing Nearest Neighbor using Brute Force completed successfully."
+                << std::endl;
+      std::cout << "Time elapsed: " << total_time.count() << " seconds"
+                << std::endl;
     }
-    stop = high_resolution_clock::now();
-    total_time = duration_cast<duration<double>>(stop - start);
-    std::cout << "Executing Nearest Neighbor using Brute Force completed successfully."
-              << std::endl;
-    std::cout << "Time elapsed: " << total_time.count() << " seconds"
-              << std::endl;
-
-    /* Create Random Projection class object and a vector to store exact-NN results */
-    start = high_resolution_clock::now();
-    std::cout << "\nBuilding Random Projection.." << std::endl;
-    K = 2 * (-1) * log2(input_info.e) / (input_info.e * input_info.e);
-    std::vector<std::tuple<T,U,double>> rp_nn_results(input_info.Q);
-    vectorization::Projection<T,U> rp{dataset_curves, dataset_curves_offsets,
-                                      dataset_curves_lengths, dataset_curves_ids,
-                                      input_info.N, K};
-    stop = high_resolution_clock::now();
-    total_time = duration_cast<duration<double>>(stop - start);
-    std::cout << "Building Random Projection completed successfully." << std::endl;
-    std::cout << "Time elapsed: " << total_time.count() << " seconds"
-              << std::endl;
-
-    start = high_resolution_clock::now();
-    std::cout << "\nVectorizing dataset curves using Random Projection method.."
-              << std::endl;
-    rp.Vectorize();
-    stop = high_resolution_clock::now();
-    total_time = duration_cast<duration<double>>(stop - start);
-    std::cout << "Vectorizing dataset curves using Random Projection method completed."
-              << std::endl;
-    std::cout << "Time elapsed: " << total_time.count() << " seconds"
-              << std::endl;
 
     start = high_resolution_clock::now();
     std::cout << "\nVectorizing query curves using Random Projection method.."
               << std::endl;
     rp.Vectorize(input_info.Q, query_curves, query_curves_lengths,
-                 query_curves_offsets, query_curves_ids);
+                 query_curves_offsets);
+    if (!input_info.traversals_cache.empty()) {
+      try {
+        rp.SaveTraversals(input_info.traversals_cache);
+      } catch (const std::exception& e) {
+        std::cout << "\n" << e.what() << std::endl;
+      }
+    }
     stop = high_resolution_clock::now();
     total_time = duration_cast<duration<double>>(stop - start);
     std::cout << "Vectorizing dataset curves using Random Projection method completed."
@@ -206,101 +246,165 @@ int main(int argc, char **argv) {
     std::cout << "Time elapsed: " << total_time.count() << " seconds"
               << std::endl;
 
-    /* Comptuing window parameter as k * R used by LSH and HyperCube */
-    start = high_resolution_clock::now();
-    std::cout << "\nComputing window parameter.." << std::endl;
-    r = utils::ComputeParameterR(bf_nn_results);
-    stop = high_resolution_clock::now();
-    total_time = duration_cast<duration<double>>(stop - start);
-    std::cout << "Computing window parameter completed successfully."
-              << std::endl;
-    std::cout << "Time elapsed: " << total_time.count() << " seconds"
-              << std::endl;
-
-    std::unordered_map<std::tuple<int,int,int>,
-        std::vector<double>> vectors = rp.GetVectors();
-    const std::unordered_map<std::tuple<int,int,int>,
-        std::vector<int>>& vectors_length = rp.GetVectorsLengths();
-    const std::unordered_map<std::tuple<int,int,int>,
-        std::vector<int>>& vectors_offsets = rp.GetVectorsOffsets();
-    const std::unordered_map<std::tuple<int,int,int>,
-        std::vector<U>>& vectors_ids = rp.GetVectorsIds();
-
-    std::unordered_map<U,
-        std::vector<double>> qvectors = rp.qGetVectors();
-    const std::unordered_map<U,
-        std::vector<int>>& qvectors_length = rp.qGetVectorsLengths();
-    const std::unordered_map<U,
-        std::vector<int>>& qvectors_offsets = rp.qGetVectorsOffsets();
-    const std::unordered_map<U,
-        std::vector<U>>& qvectors_ids = rp.qGetVectorsIds();
-
-    /* Bulding LSH structures */
-    start = high_resolution_clock::now();
-    std::cout << "\nBuilding LSH structures.." << std::endl;
-    std::unordered_map<int,std::vector<search::curves::LSH<T,U>>> lsh_structures;
-    for (auto& bucket:vectors) {
-      std::tuple<int,int,int> key = std::make_tuple(std::get<0>(bucket.first),
-                                                    std::get<1>(bucket.first),
-                                                    std::get<2>(bucket.first));
+    if (!built) {
+      /* Comptuing window parameter as k * R used by LSH and HyperCube */
+      start = high_resolution_clock::now();
+      std::cout << "\nComputing window parameter.." << std::endl;
+      if (input_info.r_samples > 0 || input_info.no_exact) {
+        uint32_t samples;
+        std::tie(r, samples) = utils::EstimateParameterR(dataset_curves,
+          dataset_curves_lengths, dataset_curves_offsets,
+          input_info.r_samples > 0 ? input_info.r_samples : utils::kRSamples);
+        std::cout << "Estimated R from " << samples << " sampled curves"
+                  << std::endl;
+      } else {
+        r = utils::ComputeParameterR(bf_nn_results);
+      }
+      stop = high_resolution_clock::now();
+      total_time = duration_cast<duration<double>>(stop - start);
+      std::cout << "Computing window parameter completed successfully."
+                << std::endl;
+      std::cout << "Time elapsed: " << total_time.count() << " seconds"
+                << std::endl;
 
-      lsh_structures[std::get<1>(bucket.first)]
-        .push_back(search::curves::LSH<T,U>(input_info.K_vec, 1, K,
-                                            bucket.second.size() / K, factor * r,
-                                            dataset_curves,
-                                            vectors_ids.at(key),
-                                            vectors_length.at(key),
-                                            vectors_offsets.at(key),
-                                            bucket.second));
+      /* Bulding LSH structures */
+      start = high_resolution_clock::now();
+      std::cout << "\nBuilding LSH structures.." << std::endl;
+      if (input_info.shared_hash) {
+        shared_lsh.reset(new search::curves::SharedLSH<T,U>(input_info.K_vec, 1,
+                                                            K, factor * r,
+                                                            dataset_curves));
+      }
+      for (uint32_t s = 0; s < rp.GetSlots(); ++s) {
+        if (shared_lsh) {
+          lsh_tenants[std::get<1>(rp.GetSlot(s))]
+            .push_back(shared_lsh->Add(rp.GetVectors(s).size() / K,
+                                       rp.GetVectorsIds(s),
+                                       rp.GetVectorsLengths(s),
+                                       rp.GetVectorsOffsets(s),
+                                       utils::RaggedView<double>(
+                                         rp.GetVectors(s).data(), K)));
+          continue;
+        }
+        lsh_structures[std::get<1>(rp.GetSlot(s))]
+          .push_back(search::curves::LSH<T,U>(input_info.K_vec, 1,
+                                              rp.GetVectors(s).size() / K, factor * r,
+                                              dataset_curves,
+                                              rp.GetVectorsIds(s),
+                                              rp.GetVectorsLengths(s),
+                                              rp.GetVectorsOffsets(s),
+                                              utils::RaggedView<double>(
+                                                rp.GetVectors(s).data(), K)));
+      }
+      stop = high_resolution_clock::now();
+      total_time = duration_cast<duration<double>>(stop - start);
+      std::cout << "Building LSH structures completed successfully."
+                << std::endl;
+      std::cout << "Time elapsed: " << total_time.count() << " seconds"
+                << std::endl;
+      built = true;
     }
-    stop = high_resolution_clock::now();
-    total_time = duration_cast<duration<double>>(stop - start);
-    std::cout << "Building LSH structures completed successfully."
-              << std::endl;
-    std::cout << "Time elapsed: " << total_time.count() << " seconds"
-              << std::endl;
 
+    /* Counting the work of the queries, if built with COUNTERS=1 */
+    utils::SearchCounters::Reset();
     /* Executing approximate Nearest Neighbor using LSH */
     start = high_resolution_clock::now();
     std::cout << "\nExecuting Nearest Neighbor using LSH.." << std::endl;
     std::vector<std::tuple<T,U,double>> approx_nn_results(input_info.Q);
     for (size_t i = 0; i < input_info.Q; ++i) {
       U id = query_curves_ids[i];
+      if (shared_lsh) {
+        approx_nn_results[i] = search::curves::projection_search(*shared_lsh,
+                                                    lsh_tenants, query_curves,
+                                                    rp.qGetVectorsLengths(i),
+                                                    rp.qGetVectorsOffsets(i),
+                                                    rp.qGetVectors(i),
+                                                    query_curves_lengths[i]-1,
+                                                    M, id);
+        continue;
+      }
       approx_nn_results[i] = search::curves::projection_search(lsh_structures,
                                                   query_curves,
-                                                  qvectors_length,
-                                                  qvectors_offsets,
-                                                  qvectors,
+                                                  rp.qGetVectorsLengths(i),
+                                                  rp.qGetVectorsOffsets(i),
+                                                  rp.qGetVectors(i),
                                                   query_curves_lengths[i]-1, M,
                                                   id);
     }
     stop = high_resolution_clock::now();
     total_time = duration_cast<duration<double>>(stop - start);
+    const double search_seconds = total_time.count();
     std::cout << "Executing Nearest Neighbor using LSH completed successfully."
               << std::endl;
     std::cout << "Time elapsed: " << total_time.count() << " seconds"
               << std::endl;
 
-    /* Compute Max and Average ratio lsh_nn_results / bf_nn_results */
-    start = high_resolution_clock::now();
-    std::cout << "\nCalculating evaluation metric.." << std::endl;
-    std::tuple<double,double,int> metric_res{};
-    metric_res = metric::EvaluationMetric(bf_nn_results, approx_nn_results);
-    stop = high_resolution_clock::now();
-    total_time = duration_cast<duration<double>>(stop - start);
-    std::cout << "Calculating evaluation metric completed successfully."
-              << std::endl;
-    std::cout << "Time elapsed: " << total_time.count() << " seconds"
-              << std::endl;
-    std::cout << "\nMax Af: " << std::get<0>(metric_res) << std::endl;
-    std::cout << "Average Af: " << std::get<1>(metric_res) << std::endl;
-    std::cout << "Not found: " << std::get<2>(metric_res) << std::endl;
+    /* Without exact NN there is nothing to compare the results against */
+    if (input_info.no_exact) {
+      std::cout << "\nExact Nearest Neighbor skipped, no Af is computed"
+                << std::endl;
+      std::cout << "Not found: " << std::count_if(approx_nn_results.begin(),
+        approx_nn_results.end(), [](const std::tuple<T,U,double>& result) {
+          return std::get<0>(result) == std::numeric_limits<T>::max();
+        }) << std::endl;
+      utils::counters::Print<utils::SearchCounters>();
+    } else {
+      /* Compute Max and Average ratio lsh_nn_results / bf_nn_results */
+      start = high_resolution_clock::now();
+      std::cout << "\nCalculating evaluation metric.." << std::endl;
+      std::tuple<double,double,int> metric_res{};
+      metric_res = metric::EvaluationMetric(bf_nn_results, approx_nn_results);
+      stop = high_resolution_clock::now();
+      total_time = duration_cast<duration<double>>(stop - start);
+      std::cout << "Calculating evaluation metric completed successfully."
+                << std::endl;
+      std::cout << "Time elapsed: " << total_time.count() << " seconds"
+                << std::endl;
+      std::cout << "\nMax Af: " << std::get<0>(metric_res) << std::endl;
+      std::cout << "Average Af: " << std::get<1>(metric_res) << std::endl;
+      std::cout << "Not found: " << std::get<2>(metric_res) << std::endl;
+      utils::counters::Print<utils::SearchCounters>();
+
+      /* Writing recall, Af and latency percentiles to the report file */
+      if (!input_info.report_file.empty()) {
+        start = high_resolution_clock::now();
+        std::cout << "\nWriting evaluation report.." << std::endl;
+        std::vector<T> kth_nn_distances;
+        if (input_info.recall_k > 1) {
+          for (size_t i = 0; i < input_info.Q; ++i) {
+            kth_nn_distances.push_back(bf.KthNearestDistance(query_curves,
+              query_curves_lengths, query_curves_offsets, i, input_info.recall_k));
+          }
+        }
+        const metric::Report report = metric::Evaluate(bf_nn_results,
+                                       approx_nn_results, kth_nn_distances,
+                                       input_info.recall_k, search_seconds);
+        try {
+          metric::WriteReport(input_info.report_file, report);
+        } catch (const std::exception& e) {
+          utils::report::ReportError(utils::INVALID_OUTPUT);
+        }
+        stop = high_resolution_clock::now();
+        total_time = duration_cast<duration<double>>(stop - start);
+        std::cout << "Writing evaluation report completed successfully."
+                  << std::endl;
+        std::cout << "Time elapsed: " << total_time.count() << " seconds"
+                  << std::endl;
+        std::cout << "\nRecall@1: " << report.recall_at_1 << std::endl;
+        std::cout << "Recall@" << report.k << ": " << report.recall_at_k << std::endl;
+        std::cout << "Latency p50: " << report.latency.Percentile(0.5)
+                  << " seconds, p99: " << report.latency.Percentile(0.99)
+                  << " seconds" << std::endl;
+        std::cout << "QPS: " << report.qps << std::endl;
+      }
+    }
 
     /* Writing results to the output file */
     start = high_resolution_clock::now();
     std::cout << "\nWriting results to the output file.." << std::endl;
     exit_code = utils::io::WriteFile<T,U>(input_info.output_file,
-      query_curves_ids, bf_nn_results, approx_nn_results, status);
+      query_curves_ids, bf_nn_results, approx_nn_results, input_info.format,
+      status);
     if (exit_code != utils::SUCCESS) {
       utils::report::ReportError(status);
     }
@@ -310,7 +414,17 @@ int main(int argc, char **argv) {
               << std::endl;
     std::cout << "Time elapsed: " << total_time.count() << " seconds"
               << std::endl;
-    /* Ask user if he want to repeat with a different query file */
+    /* Continue with the next query file of the arguments, or ask user if he
+       want to repeat with a different query file */
+    if (next_query < input_info.query_files.size()) {
+      input_info.query_file = input_info.query_files[next_query];
+      input_info.output_file = input_info.output_files[next_query++];
+      input_buffer = "y";
+      continue;
+    }
+    if (input_info.batch) {
+      break;
+    }
     do {
       std::cout << "\nDo you want to provide a different query file (y/n)? : ";
       std::cin >> input_buffer;
@@ -6,11 +6,14 @@ void utils::ShowUsage(const std::string &program_name,
   const struct InputInfo &input_info) {
   std::cerr << "usage: " << program_name << " [-help] [-d INPUT FILE]"
             << " [-q QUERY FILE] [-k_vec INT] [-L_grid INT] [-o OUTPUT FILE]"
+            << " [--band INT] [--traversals_cache FILE] [--shared_hash]"
+            << " [--r_samples INT] [--report FILE] [--recall_k INT] [--format FORMAT] [--no_exact] [--batch]"
             << "\n\n"
             << "optional arguments:\n"
             << "  -help\tshow this help message and exit\n"
             << "  -d\tdefine the input file\n"
-            << "  -q\tdefine the query file\n"
+            << "  -q\tdefine a query file, repeat -q and -o to search several"
+            << " query files with the same index\n"
             << "  -k_vec\tdefine the number of LSH hash functions (default = "
                   << input_info.K_vec << ")\n"
             << "  -L_vec\tdefine the number of LSH hash tables (default = "
@@ -18,6 +21,23 @@ void utils::ShowUsage(const std::string &program_name,
             << "  -e\tdefine error (default = "
                   << input_info.e << ")\n"
             << "  -o\tdefine the output file\n"
+            << "  --band\tdefine the band of the cells with relevant traversals (default = "
+                  << input_info.band << ")\n"
+            << "  --traversals_cache\tload relevant traversals from and save them to a cache file\n"
+            << "  --shared_hash\tshare one hash family and table between the LSH of all traversals\n"
+            << "  --r_samples\tdefine the number of dataset curves sampled to estimate R,"
+            << " 0 to average the exact NN distances of the queries (default = "
+                  << input_info.r_samples << ")\n"
+            << "  --report\twrite recall, Af and latency percentiles and QPS to a"
+            << " JSON file, or a CSV file if FILE ends in .csv\n"
+            << "  --recall_k\tdefine k of the recall at k of the report (default = "
+                  << input_info.recall_k << ")\n"
+            << "  --format\tdefine the output file format: text, or csv, jsonl and"
+            << " binary written by a buffered writer (default = "
+                  << input_info.format << ")\n"
+            << "  --no_exact\tskip exact Nearest Neighbor, no Af, recall or"
+            << " report is computed\n"
+            << "  --batch\tnever read stdin, exit after the last query file\n"
             << std::endl;
   exit(EXIT_FAILURE);
 }
@@ -37,4 +57,17 @@ void utils::InputInfo::Print(void) {
             << static_cast<unsigned int>(Q) << std::endl;
   std::cout << "Error parameter: "
             << static_cast<double>(e) << std::endl;
+  std::cout << "Traversals band: " << band << std::endl;
+  std::cout << "Traversals cache: "
+            << (traversals_cache.empty() ? "none" : traversals_cache)
+            << std::endl;
+  std::cout << "Shared hash family: "
+            << (shared_hash ? "yes" : "no") << std::endl;
+  std::cout << "Curves sampled to estimate R: " << r_samples << std::endl;
+  std::cout << "Report file: "
+            << (report_file.empty() ? "none" : report_file) << std::endl;
+  std::cout << "Recall at k: " << recall_k << std::endl;
+  std::cout << "Output format: " << format << std::endl;
+  std::cout << "Exact NN: " << (no_exact ? "no" : "yes") << std::endl;
+  std::cout << "Batch: " << (batch ? "yes" : "no") << std::endl;
 }
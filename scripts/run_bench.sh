@@ -0,0 +1,6 @@
+cd ../bench
+make
+cd build/
+./bench --json ../../results/bench.json
+cd ..
+make clean
@@ -0,0 +1,21 @@
+# Queries longer than every dataset curve: the grid queries have up to 221
+# points and the projection dataset curves at most 10, so the query vectors
+# are cut to the dimension of the dataset vectors before they are hashed.
+# Objects are rebuilt, as the Makefiles do not track the headers
+status=0
+cd ../curves/grid_lsh
+make clean
+make
+cd build/
+./curve_grid_lsh -d ../../../datasets/curves/trajectories_projection_dataset.txt -q ../../../datasets/curves/trajectories_grid_query.txt --k_vec 4 --L_grid 4 -o /dev/null --batch > /dev/null || status=1
+cd ..
+make clean
+cd ../grid_hypercube
+make clean
+make
+cd build/
+./curve_grid_hypercube -d ../../../datasets/curves/trajectories_projection_dataset.txt -q ../../../datasets/curves/trajectories_grid_query.txt --k_hypercube 3 -M 10 --probes 2 --L_grid 4 -o /dev/null --batch > /dev/null || status=1
+cd ..
+make clean
+[ $status = 0 ] && echo "PASS: long queries" || echo "FAIL: long queries"
+exit $status
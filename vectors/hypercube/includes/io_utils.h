@@ -6,6 +6,8 @@
 #include <tuple>
 #include <vector>
 
+#include "../../../core/utils/results.h"
+
 namespace utils {
   namespace io {
     /** \brief ReadFile - Reads file provided by user and
@@ -45,17 +47,43 @@ namespace utils {
       @par std::string &file_name - Pass by reference the path to the output file
       @par std::vector<std::tuple<T,U,double>> &exact - Results from Brute Force
       @par std::vector<std::tuple<T,U,double>> &approx - Results from HyperCube
-      @par std::vector<std::vector<std::pair<T,U>>> &radius_nn - Results from radius NN
+      @par std::vector<std::vector<std::pair<T,U>>> &radius_nn - Results from approximate radius NN
+      @par const std::string& format - text, or csv, jsonl and binary written
+        by utils::results::Writer with the radius NN of each query as its
+        neighbors
       @par ExitCode &statues - enumerated ExitCode provided from namespace utils
       return: SUCCESS or FAIL
     */
     template <typename T, typename U>
     int WriteFile(std::string &file_name, std::vector<std::tuple<T,U,double>> &exact,
       std::vector<std::tuple<T,U,double>> &approx, const double R,
-      std::vector<std::vector<std::pair<T,U>>> &radius_nn, utils::ExitCode &status) {
+      std::vector<std::vector<std::pair<T,U>>> &radius_nn,
+      const std::string& format, utils::ExitCode &status) {
+
+      utils::results::Format results_format;
+      if (!utils::results::ParseFormat(format, results_format)) {
+        status = INVALID_FORMAT;
+        return FAIL;
+      }
+      if (results_format != utils::results::TEXT) {
+        try {
+          utils::results::Writer<T,U> writer(file_name, results_format);
+          for (size_t i = 0; i < exact.size(); ++i) {
+            writer.Write(i, approx[i], exact[i], radius_nn[i]);
+          }
+          writer.Close();
+        } catch (const std::exception& e) {
+          status = INVALID_OUTPUT;
+          return FAIL;
+        }
+        return SUCCESS;
+      }
 
       // Open file
+      // a large buffer and no flush per line, it outlives the stream
+      std::vector<char> buffer(utils::results::kBufferSize);
       std::ofstream outfile;
+      outfile.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
       outfile.open(file_name);
       // Check if file is opened
       if (outfile.is_open()) {
@@ -63,22 +91,22 @@ namespace utils {
         int N = exact.size();
         /* Print info for each query */
         for (size_t i = 0; i < N; ++i) {
-          outfile << "Query: " << i << std::endl;
-          outfile << "Nearest neighbor: " << std::get<1>(approx[i]) << std::endl;
-          outfile << "distanceHyperCube: " <<  std::get<0>(approx[i]) << std::endl;
-          outfile << "distanceTrue: " <<  std::get<0>(exact[i]) << std::endl;
-          outfile << "tHyperCube: " <<  std::get<2>(approx[i]) << " seconds" << std::endl;
-          outfile << "tTrue: " <<  std::get<2>(exact[i]) << " seconds" << std::endl;
+          outfile << "Query: " << i << '\n';
+          outfile << "Nearest neighbor: " << std::get<1>(approx[i]) << '\n';
+          outfile << "distanceHyperCube: " <<  std::get<0>(approx[i]) << '\n';
+          outfile << "distanceTrue: " <<  std::get<0>(exact[i]) << '\n';
+          outfile << "tHyperCube: " <<  std::get<2>(approx[i]) << " seconds" << '\n';
+          outfile << "tTrue: " <<  std::get<2>(exact[i]) << " seconds" << '\n';
           if (R != 0.0) {
-            outfile << R << "-near neighbors: " << std::endl;
+            outfile << R << "-near neighbors: " << '\n';
             for (int j = 0; j < radius_nn[i].size(); ++j) {
-              outfile << std::get<1>(radius_nn[i][j]) << std::endl;
+              outfile << std::get<1>(radius_nn[i][j]) << '\n';
             }
             if (!radius_nn[i].size()) {
-              outfile << "No " << R << "-near neighbors found" << std::endl;
+              outfile << "No " << R << "-near neighbors found" << '\n';
             }
           }
-          outfile << std::endl;
+          outfile << '\n';
         }
 
       } else {
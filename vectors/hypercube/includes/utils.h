@@ -18,9 +18,14 @@ namespace utils {
     INVALID_DATASET,
     INVALID_QUERY,
     INVALID_OUTPUT,
+    INVALID_INDEX,
     DATASET_ERROR,
     QUERY_ERROR,
-    MEMORY_ERROR
+    MEMORY_ERROR,
+    INVALID_CONFIG,
+    INVALID_FORMAT,
+    MISSING_OUTPUT,
+    INVALID_TUNE
   } ExitCode;
   /**
     InputInfo - Group all input parameters of LSH in a struct
@@ -30,12 +35,31 @@ namespace utils {
     std::string input_file;      // name of the relative path to the input file
     std::string query_file;      // name of the relative path to the query file
     std::string output_file;     // name of the relative path to the output file
+    std::string load_index_file; // HyperCube snapshot to be loaded instead of built
+    std::string save_index_file; // path to save the HyperCube snapshot
     uint8_t M = 10;              // max number of HyperCube's candidate points to be checked
     uint8_t probes = 2;          // max number of HyperCube's verteces to be checked
     uint16_t k = 3;              // reduces dimensional space
+    uint8_t cubes = 1;           // number of independent cubes sharing probes and M
+    bool margin_probes = false;  // probe vertices by query margins instead of hamming distance
+    bool window_sampling = false;// sample a window of large vertices instead of random points
+    bool projection_hash = false;// one random projection per cube bit instead of amplified hashing
     uint16_t D;                  // dimension of the space
     uint32_t N;                  // number of dataset points
     uint32_t Q;                  // number of query points
+    uint32_t r_samples = 0;      // dataset points sampled to estimate R, 0 for exact NN
+    std::string report_file;     // evaluation report, CSV if it ends in .csv else JSON
+    uint32_t recall_k = 10;      // rank of the recall at k of the report
+    std::string format = "text"; // output file format: text, csv, jsonl or binary
+    std::vector<std::string> query_files;  // query files of the arguments
+    std::vector<std::string> output_files; // output file of each query file
+    bool no_exact = false;       // skip exact NN, so no Af, recall or report
+    bool batch = false;          // never read stdin, exit after the last query file
+    double radius = 0;           // radius of range search, 0 to ask unless batch
+    double w = 5;                // window size as a multiple of R
+    std::string config_file;     // tuned parameters to be loaded, empty for none
+    std::string tune_file;       // tune parameters and save them to this file
+    float recall = 0.9;          // recall target of tuning
     void Print(void);            // print method of the InputInfo struct
   };
   /** \brief ShowUsage - Prints the usage of the program
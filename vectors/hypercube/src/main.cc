@@ -3,7 +3,10 @@
 #include <cmath>
 #include <iostream>
 #include <iterator>
+#include <limits>
+#include <memory>
 #include <random>
+#include <stdexcept>
 #include <string>
 #include <tuple>
 #include <utility>
@@ -11,8 +14,14 @@
 
 #include "../../../core/hash/hash_function.h"
 #include "../../../core/metric/metric.h"
+#include "../../../core/metric/report.h"
 #include "../../../core/search/brute_force.h"
 #include "../../../core/search/hypercube.h"
+#include "../../../core/search/tuner.h"
+#include "../../../core/utils/config.h"
+#include "../../../core/utils/counters.h"
+#include "../../../core/utils/estimate.h"
+#include "../../../core/utils/timing.h"
 #include "../../../core/utils/utils.h"
 
 #include "../includes/args_utils.h"
@@ -29,7 +38,7 @@ int main(int argc, char **argv) {
   utils::InputInfo input_info;
   utils::ExitCode status;
   std::string input_buffer;
-  double radius = 0.0;
+  double radius;
   int exit_code;
 
   /* Get arguments */
@@ -111,6 +120,39 @@ int main(int argc, char **argv) {
   std::cout << "Time elapsed: " << total_time.count() << " seconds"
             << std::endl;
 
+  /* Load tuned parameters, they override the ones of the arguments */
+  if (!input_info.config_file.empty()) {
+    try {
+      utils::Config config(input_info.config_file);
+      input_info.k = config.Get<unsigned int>("K", input_info.k, 1,
+        std::numeric_limits<uint16_t>::max());
+      input_info.cubes = config.Get<unsigned int>("L", input_info.cubes, 1,
+        std::numeric_limits<uint8_t>::max());
+      input_info.probes = config.Get<unsigned int>("probes", input_info.probes,
+        1, std::numeric_limits<uint8_t>::max());
+      input_info.M = config.Get<unsigned int>("M", input_info.M, 1,
+        std::numeric_limits<uint8_t>::max());
+      input_info.w = config.Get<double>("w", input_info.w,
+        std::numeric_limits<double>::min(), std::numeric_limits<double>::max());
+    } catch (const std::exception& e) {
+      std::cout << "\n" << e.what() << std::endl;
+      utils::report::ReportError(utils::INVALID_CONFIG);
+    }
+  }
+  /* Create BruteForce class object, it is shared by every query file */
+  start = high_resolution_clock::now();
+  std::cout << "\nBuilding Brute Force.." << std::endl;
+  search::vectors::BruteForce<T,U> bf{input_info.N, input_info.D,
+                                      dataset_points, dataset_ids};
+  stop = high_resolution_clock::now();
+  total_time = duration_cast<duration<double>>(stop - start);
+  std::cout << "Building Brute Force completed successfully." << std::endl;
+  std::cout << "Time elapsed: " << total_time.count() << " seconds"
+            << std::endl;
+
+  /* HyperCube is built for the first query file and searched by the rest */
+  std::unique_ptr<search::vectors::HyperCube<T,U>> cube;
+  size_t next_query = 1;
   do {
     /* Preprocessing query file */
     start = high_resolution_clock::now();
@@ -147,137 +189,253 @@ int main(int argc, char **argv) {
     /* Print input info */
     input_info.Print();
 
-    /* Create BruteForce class object and a vector to store exact-NN results */
-    start = high_resolution_clock::now();
-    std::cout << "\nBuilding Brute Force.." << std::endl;
-    std::vector<std::tuple<T,U,double>> bf_nn_results(input_info.Q);
-    search::vectors::BruteForce<T,U> bf{input_info.N, input_info.D,
-                                        dataset_points, dataset_ids};
-    stop = high_resolution_clock::now();
-    total_time = duration_cast<duration<double>>(stop - start);
-    std::cout << "Building Brute Force completed successfully." << std::endl;
-    std::cout << "Time elapsed: " << total_time.count() << " seconds"
-              << std::endl;
-
-    /* Executing Exact Nearest Neighbor using BruteForce */
-    start = high_resolution_clock::now();
-    std::cout << "\nExecuting Nearest Neighbor using Brute Force.." << std::endl;
-    for (size_t i = 0; i < input_info.Q; ++i) {
-      bf_nn_results[i] = bf.NearestNeighbor(query_points, i);
+    /* Executing Exact Nearest Neighbor using BruteForce, unless skipped */
+    std::vector<std::tuple<T,U,double>> bf_nn_results(input_info.Q,
+      std::make_tuple(std::numeric_limits<T>::max(), U{},
+                      utils::timing::kNotTimed));
+    if (!input_info.no_exact) {
+      start = high_resolution_clock::now();
+      std::cout << "\nExecuting Nearest Neighbor using Brute Force.." << std::endl;
+      for (size_t i = 0; i < input_info.Q; ++i) {
+        bf_nn_results[i] = bf.NearestNeighbor(query_points, i);
+      }
+      stop = high_resolution_clock::now();
+      total_time = duration_cast<duration<double>>(stop - start);
+      std::cout << "Executing Nearest Neighbor using Brute Force completed successfully."
+                << std::endl;
+      std::cout << "Time elapsed: " << total_time.count() << " seconds"
+                << std::endl;
     }
-    stop = high_resolution_clock::now();
-    total_time = duration_cast<duration<double>>(stop - start);
-    std::cout << "Executing Nearest Neighbor using Brute Force completed successfully."
-              << std::endl;
-    std::cout << "Time elapsed: " << total_time.count() << " seconds"
-              << std::endl;
 
-    /* Computing window */
-    start = high_resolution_clock::now();
-    std::cout << "\nComputing window parameter.." << std::endl;
-    double r = utils::ComputeParameterR(bf_nn_results);
-    stop = high_resolution_clock::now();
-    total_time = duration_cast<duration<double>>(stop - start);
-    std::cout << "Computing window completed successfully." << std::endl;
-    std::cout << "Time elapsed: " << total_time.count() << " seconds" << std::endl;
+    if (!cube) {
+      /* Computing window */
+      start = high_resolution_clock::now();
+      std::cout << "\nComputing window parameter.." << std::endl;
+      double r;
+      if (input_info.r_samples > 0 || input_info.no_exact) {
+        uint32_t samples;
+        std::tie(r, samples) = utils::EstimateParameterR(
+          utils::RaggedView<T>(dataset_points, input_info.D), input_info.N,
+          input_info.r_samples > 0 ? input_info.r_samples : utils::kRSamples);
+        std::cout << "Estimated R from " << samples << " sampled points"
+                  << std::endl;
+      } else {
+        r = utils::ComputeParameterR(bf_nn_results);
+      }
+      stop = high_resolution_clock::now();
+      total_time = duration_cast<duration<double>>(stop - start);
+      std::cout << "Computing window completed successfully." << std::endl;
+      std::cout << "Time elapsed: " << total_time.count() << " seconds" << std::endl;
 
-    /* Creating HyperCube class object and a vector to store approx-NN results */
-    start = high_resolution_clock::now();
-    std::vector<std::tuple<T,U,double>> cube_nn_results(input_info.Q);
-    std::cout << "\nBuilding HyperCube.." << std::endl;
-    std::vector<std::tuple<T,U,double>> hypercube_nn_results(input_info.Q);
-    search::vectors::HyperCube<T,U> cube{input_info.k, input_info.M, input_info.D,
-                                         input_info.N, input_info.probes, r,
-                                         dataset_points, dataset_ids};
+      /* Tuning parameters on a sample of the dataset for the recall target */
+      if (!input_info.tune_file.empty()) {
+        start = high_resolution_clock::now();
+        std::cout << "\nTuning HyperCube parameters.." << std::endl;
+        search::tuner::Configuration chosen;
+        try {
+          chosen = search::tuner::Tune<T,U>(
+            search::tuner::Grid({3, 5, 7, 9}, {input_info.cubes}, {2, 5, 10},
+                                {1, 2, 4, 8}, {10, 50, 200}),
+            dataset_points, dataset_ids, input_info.D, input_info.N,
+            input_info.recall, true, input_info.tune_file,
+            [&](const search::tuner::Configuration& c, const uint32_t S,
+                const double sample_r, const std::vector<T>& sample_points,
+                const std::vector<U>& sample_ids) {
+            return std::unique_ptr<search::vectors::HyperCube<T,U>>(
+              new search::vectors::HyperCube<T,U>(c.K, c.M, input_info.D, S,
+                c.probes, sample_r, sample_points, sample_ids,
+                input_info.margin_probes ? search::MARGIN_ORDER
+                                         : search::HAMMING_ORDER,
+                input_info.window_sampling ? search::WINDOW_SAMPLING
+                                           : search::RANDOM_SAMPLING,
+                input_info.projection_hash ? search::PROJECTION_HASH
+                                           : search::AMPLIFIED_HASH,
+                c.L, c.w));
+          });
+        } catch (const std::exception& e) {
+          std::cout << "\n" << e.what() << std::endl;
+          utils::report::ReportError(utils::INVALID_CONFIG);
+        }
+        input_info.k = chosen.K;
+        input_info.probes = chosen.probes;
+        input_info.M = chosen.M;
+        input_info.w = chosen.w;
+        stop = high_resolution_clock::now();
+        total_time = duration_cast<duration<double>>(stop - start);
+        std::cout << "Tuning HyperCube parameters completed successfully."
+                  << std::endl;
+        std::cout << "Time elapsed: " << total_time.count() << " seconds"
+                  << std::endl;
+      }
 
-    stop = high_resolution_clock::now();
-    total_time = duration_cast<duration<double>>(stop - start);
-    std::cout << "Building HyperCube completed successfully." << std::endl;
-    std::cout << "Time elapsed: " << total_time.count() << " seconds"
-              << std::endl;
+      /* Creating HyperCube class object */
+      start = high_resolution_clock::now();
+      search::ProbeOrder order = input_info.margin_probes ? search::MARGIN_ORDER
+                                                          : search::HAMMING_ORDER;
+      search::Sampling sampling = input_info.window_sampling ? search::WINDOW_SAMPLING
+                                                             : search::RANDOM_SAMPLING;
+      search::CubeHash hash = input_info.projection_hash ? search::PROJECTION_HASH
+                                                         : search::AMPLIFIED_HASH;
+      if (!input_info.load_index_file.empty()) {
+        std::cout << "\nLoading HyperCube.." << std::endl;
+        try {
+          cube.reset(new search::vectors::HyperCube<T,U>(
+            input_info.load_index_file, input_info.M, input_info.probes,
+            dataset_points, dataset_ids, order, sampling));
+        } catch (const std::exception& e) {
+          std::cout << "\n" << e.what() << std::endl;
+          utils::report::ReportError(utils::INVALID_INDEX);
+        }
+      } else {
+        std::cout << "\nBuilding HyperCube.." << std::endl;
+        if (!search::ValidCubeDimensions(input_info.k, input_info.N)) {
+          utils::report::ReportError(utils::INVALID_k);
+        }
+        cube.reset(new search::vectors::HyperCube<T,U>(input_info.k, input_info.M,
+                                               input_info.D, input_info.N,
+                                               input_info.probes, r,
+                                               dataset_points, dataset_ids,
+                                               order, sampling, hash,
+                                               input_info.cubes, input_info.w));
+      }
+      if (!input_info.save_index_file.empty()) {
+        try {
+          cube->Save(input_info.save_index_file);
+        } catch (const std::exception& e) {
+          std::cout << "\n" << e.what() << std::endl;
+          utils::report::ReportError(utils::INVALID_INDEX);
+        }
+      }
+      stop = high_resolution_clock::now();
+      total_time = duration_cast<duration<double>>(stop - start);
+      std::cout << "Building HyperCube completed successfully." << std::endl;
+      std::cout << "Time elapsed: " << total_time.count() << " seconds"
+                << std::endl;
+    }
 
+    /* Vector to store approx-NN results */
+    std::vector<std::tuple<T,U,double>> cube_nn_results(input_info.Q);
+
+    /* Counting the work of the queries, if built with COUNTERS=1 */
+    utils::SearchCounters::Reset();
     /* Executing approximate Nearest Neighbor using HyperCube */
     start = high_resolution_clock::now();
     std::cout << "\nExecuting Nearest Neighbor using HyperCube.." << std::endl;
     for (size_t i = 0; i < input_info.Q; ++i) {
-      cube_nn_results[i] = cube.NearestNeighbor(query_points, i);
+      cube_nn_results[i] = cube->NearestNeighbor(query_points, i);
     }
     stop = high_resolution_clock::now();
     total_time = duration_cast<duration<double>>(stop - start);
+    const double search_seconds = total_time.count();
     std::cout << "Executing Nearest Neighbor using HyperCube completed successfully."
               << std::endl;
     std::cout << "Time elapsed: " << total_time.count() << " seconds"
               << std::endl;
 
-    /* Read radius if user select to run range search */
-    do {
+    /* Read radius if user select to run range search, unless it is given */
+    radius = input_info.radius;
+    input_buffer = radius > 0 ? "y" : "n";
+    while (!input_info.batch && radius == 0) {
       std::cout << "\nDo you want to run range search? (y/n)? : ";
       std::cin >> input_buffer;
-      if (input_buffer != "y" && input_buffer != "n") {
-        std::cout << "Wrong input! Try again." << std::endl;
+      if (input_buffer == "y" || input_buffer == "n") {
+        break;
       }
-    } while (input_buffer != "y" && input_buffer != "n");
+      std::cout << "Wrong input! Try again." << std::endl;
+    }
     /* Define vectors to store radius NN results */
-    std::vector<std::vector<std::pair<T,U>>> bf_radius_nn_results(input_info.Q);
     std::vector<std::vector<std::pair<T,U>>> cube_radius_nn_results(input_info.Q);
     /* Check input */
     if (input_buffer != "n") {
-      std::cout << "Provide the radius: ";
-      std::cin >> input_buffer;
-      try {
-        radius = stoi(input_buffer);
-      } catch (...) {
-        return EXIT_FAILURE;
+      if (radius == 0) {
+        std::cout << "Provide the radius: ";
+        std::cin >> input_buffer;
+        try {
+          radius = stoi(input_buffer);
+        } catch (...) {
+          return EXIT_FAILURE;
+        }
       }
-      /* Executing Radius Nearest Neighbor using BruteForce*/
+      /* Executing Radius Nearest Neighbor using HyperCube*/
       start = high_resolution_clock::now();
-      std::cout << "\nExecuting Radius Nearest Neighbor using Brute Force.."
+      std::cout << "\nExecuting Radius Nearest Neighbor using HyperCube.."
                 << std::endl;
       for (size_t i = 0; i < input_info.Q; ++i) {
-        bf_radius_nn_results[i] = bf.RadiusNearestNeighbor(query_points, i, radius);
+        cube_radius_nn_results[i] = cube->RadiusNearestNeighbor(query_points, i, radius);
       }
       stop = high_resolution_clock::now();
       total_time = duration_cast<duration<double>>(stop - start);
-      std::cout << "Executing Radius Nearest Neighbor using Brute Force completed successfully."
+      std::cout << "Executing Radius Nearest Neighbor using HyperCube completed successfully."
                 << std::endl;
       std::cout << "Time elapsed: " << total_time.count() << " seconds"
                 << std::endl;
+    }
 
-      /* Executing Radius Nearest Neighbor using HyperCube*/
-      start = high_resolution_clock::now();
-      std::cout << "\nExecuting Radius Nearest Neighbor using HyperCube.."
+    /* Without exact NN there is nothing to compare the results against */
+    if (input_info.no_exact) {
+      std::cout << "\nExact Nearest Neighbor skipped, no Af is computed"
                 << std::endl;
-      for (size_t i = 0; i < input_info.Q; ++i) {
-        cube_radius_nn_results[i] = cube.RadiusNearestNeighbor(query_points, i, radius);
-      }
+      std::cout << "Not found: " << std::count_if(cube_nn_results.begin(),
+        cube_nn_results.end(), [](const std::tuple<T,U,double>& result) {
+          return std::get<0>(result) == std::numeric_limits<T>::max();
+        }) << std::endl;
+      utils::counters::Print<utils::SearchCounters>();
+    } else {
+      /* Compute Max and Average ratio cube_nn_results / bf_nn_results */
+      start = high_resolution_clock::now();
+      std::cout << "\nCalculating evaluation metric.." << std::endl;
+      std::tuple<double,double,int> metric_res{};
+      metric_res = metric::EvaluationMetric(bf_nn_results, cube_nn_results);
       stop = high_resolution_clock::now();
       total_time = duration_cast<duration<double>>(stop - start);
-      std::cout << "Executing Radius Nearest Neighbor using HyperCube completed successfully."
+      std::cout << "Calculating evaluation metric completed successfully."
                 << std::endl;
       std::cout << "Time elapsed: " << total_time.count() << " seconds"
                 << std::endl;
-    }
+      std::cout << "\nMax Af: " << std::get<0>(metric_res) << std::endl;
+      std::cout << "Average Af: " << std::get<1>(metric_res) << std::endl;
+      std::cout << "Not found: " << std::get<2>(metric_res) << std::endl;
+      utils::counters::Print<utils::SearchCounters>();
 
-    /* Compute Max and Average ratio cube_nn_results / bf_nn_results */
-    start = high_resolution_clock::now();
-    std::cout << "\nCalculating evaluation metric.." << std::endl;
-    std::tuple<double,double,int> metric_res{};
-     metric_res = metric::EvaluationMetric(bf_nn_results, cube_nn_results);
-    stop = high_resolution_clock::now();
-    total_time = duration_cast<duration<double>>(stop - start);
-    std::cout << "Calculating evaluation metric completed successfully."
-              << std::endl;
-    std::cout << "Time elapsed: " << total_time.count() << " seconds"
-              << std::endl;
-    std::cout << "\nMax Af: " << std::get<0>(metric_res) << std::endl;
-    std::cout << "Average Af: " << std::get<1>(metric_res) << std::endl;
-    std::cout << "Not found: " << std::get<2>(metric_res) << std::endl;
+      /* Writing recall, Af and latency percentiles to the report file */
+      if (!input_info.report_file.empty()) {
+        start = high_resolution_clock::now();
+        std::cout << "\nWriting evaluation report.." << std::endl;
+        std::vector<T> kth_nn_distances;
+        if (input_info.recall_k > 1) {
+          for (size_t i = 0; i < input_info.Q; ++i) {
+            kth_nn_distances.push_back(bf.KthNearestDistance(query_points, i,
+                                                              input_info.recall_k));
+          }
+        }
+        const metric::Report report = metric::Evaluate(bf_nn_results,
+                                       cube_nn_results, kth_nn_distances,
+                                       input_info.recall_k, search_seconds);
+        try {
+          metric::WriteReport(input_info.report_file, report);
+        } catch (const std::exception& e) {
+          utils::report::ReportError(utils::INVALID_OUTPUT);
+        }
+        stop = high_resolution_clock::now();
+        total_time = duration_cast<duration<double>>(stop - start);
+        std::cout << "Writing evaluation report completed successfully."
+                  << std::endl;
+        std::cout << "Time elapsed: " << total_time.count() << " seconds"
+                  << std::endl;
+        std::cout << "\nRecall@1: " << report.recall_at_1 << std::endl;
+        std::cout << "Recall@" << report.k << ": " << report.recall_at_k << std::endl;
+        std::cout << "Latency p50: " << report.latency.Percentile(0.5)
+                  << " seconds, p99: " << report.latency.Percentile(0.99)
+                  << " seconds" << std::endl;
+        std::cout << "QPS: " << report.qps << std::endl;
+      }
+    }
 
     /* Writing results to the output file */
     start = high_resolution_clock::now();
     std::cout << "\nWriting results to the output file.." << std::endl;
     exit_code = utils::io::WriteFile<T,U>(input_info.output_file, bf_nn_results,
-      cube_nn_results, radius, bf_radius_nn_results, status);
+      cube_nn_results, radius, cube_radius_nn_results, input_info.format, status);
     if (exit_code != utils::SUCCESS) {
       utils::report::ReportError(status);
     }
@@ -288,7 +446,17 @@ int main(int argc, char **argv) {
     std::cout << "Time elapsed: " << total_time.count() << " seconds"
               << std::endl;
 
-    /* Ask user if he want to repeat with a different query file */
+    /* Continue with the next query file of the arguments, or ask user if he
+       want to repeat with a different query file */
+    if (next_query < input_info.query_files.size()) {
+      input_info.query_file = input_info.query_files[next_query];
+      input_info.output_file = input_info.output_files[next_query++];
+      input_buffer = "y";
+      continue;
+    }
+    if (input_info.batch) {
+      break;
+    }
     do {
       std::cout << "\nDo you want to provide a different query file (y/n)? : ";
       std::cin >> input_buffer;
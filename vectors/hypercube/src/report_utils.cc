@@ -26,6 +26,9 @@ void utils::report::ReportError(const utils::ExitCode &code) {
     case INVALID_OUTPUT:
       std::cout << "\n[ERROR]: " << "Invalid output file name" << std::endl;
       break;
+    case INVALID_INDEX:
+      std::cout << "\n[ERROR]: " << "Invalid HyperCube snapshot" << std::endl;
+      break;
     case DATASET_ERROR:
       std::cout << "\n[ERROR]: " << "Invalid dataset file format" << std::endl;
       break;
@@ -35,6 +38,21 @@ void utils::report::ReportError(const utils::ExitCode &code) {
     case MEMORY_ERROR:
       std::cout << "\n[ERROR]: " << "System ran out of memory" << std::endl;
       break;
+    case INVALID_CONFIG:
+      std::cout << "\n[ERROR]: " << "Invalid config file" << std::endl;
+      break;
+    case INVALID_FORMAT:
+      std::cout << "\n[ERROR]: " << "Invalid output format, expected text,"
+                << " csv, jsonl or binary" << std::endl;
+      break;
+    case MISSING_OUTPUT:
+      std::cout << "\n[ERROR]: " << "Every query file needs an output file"
+                << std::endl;
+      break;
+    case INVALID_TUNE:
+      std::cout << "\n[ERROR]: " << "--tune can not be used with --load_index,"
+                << " whose snapshot fixes k and w" << std::endl;
+      break;
     default:
       abort();
   }
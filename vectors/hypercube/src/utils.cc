@@ -11,18 +11,53 @@ void utils::ShowUsage(const std::string& program_name,
   const struct InputInfo& input_info) {
   std::cerr << "usage: " << program_name << " [--help] [-d INPUT FILE]"
             << " [-q QUERY FILE] [-k INT] [-M INT] [--probes INT] [-o OUTPUT FILE]"
+            << " [--save_index FILE] [--load_index FILE] [--margin_probes]"
+            << " [--window_sampling] [--projection_hash]"
+            << " [--cubes INT]"
+            << " [--r_samples INT] [--report FILE] [--recall_k INT] [--format FORMAT] [--radius FLOAT] [--no_exact] [--batch] [--window FLOAT] [--config FILE]"
+            << " [--tune FILE] [--recall FLOAT]"
             << "\n\n"
             << "optional arguments:\n"
             << "  -help\tshow this help message and exit\n"
             << "  -d\tdefine the input file\n"
-            << "  -q\tdefine the query file\n"
+            << "  -q\tdefine a query file, repeat -q and -o to search several"
+            << " query files with the same index\n"
             << "  -k\tdefine the number of reduced dimensions (default = "
-                  << input_info.k << ")\n"
+                  << input_info.k << ", at most ceil(log2 N) + 4)\n"
             << "  -M\tdefine max number of candidate points to be checked (default = "
                   << input_info.M << ")\n"
             << "  --probes\tdefine max number of probes to be checked (default = "
                   << input_info.probes << ")\n"
             << "  -o\tdefine the output file\n"
+            << "  --save_index\tsave the HyperCube to a snapshot file\n"
+            << "  --load_index\tload the HyperCube from a snapshot file instead of building it\n"
+            << "  --margin_probes\tprobe vertices in increasing query margin instead of hamming distance\n"
+            << "  --window_sampling\tcheck a random window of each large vertex instead of random points\n"
+            << "  --projection_hash\tcompute each cube bit from a single random projection\n"
+            << "  --cubes\tdefine the number of independent cubes (default = "
+                  << static_cast<unsigned int>(input_info.cubes) << ")\n"
+            << "  --r_samples\tdefine the number of dataset points sampled to estimate R,"
+            << " 0 to average the exact NN distances of the queries (default = "
+                  << input_info.r_samples << ")\n"
+            << "  --report\twrite recall, Af and latency percentiles and QPS to a"
+            << " JSON file, or a CSV file if FILE ends in .csv\n"
+            << "  --recall_k\tdefine k of the recall at k of the report (default = "
+                  << input_info.recall_k << ")\n"
+            << "  --format\tdefine the output file format: text, or csv, jsonl and"
+            << " binary written by a buffered writer (default = "
+                  << input_info.format << ")\n"
+            << "  --radius\tdefine the radius of range search instead of asking"
+            << " for it\n"
+            << "  --no_exact\tskip exact Nearest Neighbor, no Af, recall or"
+            << " report is computed\n"
+            << "  --batch\tnever read stdin, exit after the last query file\n"
+            << "  --window\tdefine the window size as a multiple of R (default = "
+                  << input_info.w << ")\n"
+            << "  --config\tload parameters from a config file written by --tune\n"
+            << "  --tune\ttune parameters for the recall target on a sample of the"
+            << " dataset and save them to a config file, not with --load_index\n"
+            << "  --recall\tdefine the recall target of tuning (default = "
+                  << input_info.recall << ")\n"
             << std::endl;
   exit(EXIT_FAILURE);
 }
@@ -42,4 +77,25 @@ void utils::InputInfo::Print(void) {
             << static_cast<unsigned int>(D) << std::endl;
   std::cout << "Number of reduced dimensions: "
             << static_cast<unsigned int>(k) << std::endl;
+  std::cout << "Number of cubes: "
+            << static_cast<unsigned int>(cubes) << std::endl;
+  std::cout << "Probe order: "
+            << (margin_probes ? "margin" : "hamming") << std::endl;
+  std::cout << "Candidate sampling: "
+            << (window_sampling ? "window" : "random") << std::endl;
+  std::cout << "Cube hash: "
+            << (projection_hash ? "projection" : "amplified") << std::endl;
+  std::cout << "Points sampled to estimate R: " << r_samples << std::endl;
+  std::cout << "Report file: "
+            << (report_file.empty() ? "none" : report_file) << std::endl;
+  std::cout << "Recall at k: " << recall_k << std::endl;
+  std::cout << "Output format: " << format << std::endl;
+  std::cout << "Exact NN: " << (no_exact ? "no" : "yes") << std::endl;
+  std::cout << "Batch: " << (batch ? "yes" : "no") << std::endl;
+  std::cout << "Window size: " << w << " * R" << std::endl;
+  std::cout << "Config file: "
+            << (config_file.empty() ? "none" : config_file) << std::endl;
+  std::cout << "Tuning: "
+            << (tune_file.empty() ? "no" : "for recall " + std::to_string(recall))
+            << std::endl;
 }
@@ -18,7 +18,10 @@ namespace utils {
     INVALID_OUTPUT,
     DATASET_ERROR,
     QUERY_ERROR,
-    MEMORY_ERROR
+    MEMORY_ERROR,
+    INVALID_CONFIG,
+    INVALID_FORMAT,
+    MISSING_OUTPUT
   } ExitCode;
   /**
     InputInfo - Group all input parameters of LSH in a struct
@@ -32,6 +35,19 @@ namespace utils {
     uint32_t N;                  // number of dataset points
     uint32_t Q;                  // number of query points
     uint16_t D;                  // dimension of the space
+    uint32_t r_samples = 0;      // dataset points sampled to estimate R, 0 for exact NN
+    std::string report_file;     // evaluation report, CSV if it ends in .csv else JSON
+    uint32_t recall_k = 10;      // rank of the recall at k of the report
+    std::string format = "text"; // output file format: text, csv, jsonl or binary
+    std::vector<std::string> query_files;  // query files of the arguments
+    std::vector<std::string> output_files; // output file of each query file
+    bool no_exact = false;       // skip exact NN, so no Af, recall or report
+    bool batch = false;          // never read stdin, exit after the last query file
+    double radius = 0;           // radius of range search, 0 to ask unless batch
+    double w = 2;                // window size as a multiple of R
+    std::string config_file;     // tuned parameters to be loaded, empty for none
+    std::string tune_file;       // tune parameters and save them to this file
+    float recall = 0.9;          // recall target of tuning
     void Print(void);            // print method of the InputInfo struct
   };
   /** \brief ShowUsage - Prints the usage of the program
@@ -6,6 +6,8 @@
 #include <string>
 #include <string.h>
 
+#include "../../../core/utils/results.h"
+
 #include "../includes/utils.h"
 #include "../includes/args_utils.h"
 
@@ -70,13 +72,24 @@ int utils::args::ReadArguments(int argc, char **argv,
     }
   }
 
-  const char * const short_opts = "d:q:k:L:o:";
+  const char * const short_opts = "d:q:k:L:o:r:W:f:T:R:E:K:F:a:nB";
   const option long_opts[] = {
            {"input", required_argument, nullptr, 'd'},
            {"query", required_argument, nullptr, 'q'},
            {"k", optional_argument, nullptr, 'k'},
            {"L", optional_argument, nullptr, 'L'},
            {"help", required_argument, nullptr, 'o'},
+           {"r_samples", required_argument, nullptr, 'r'},
+           {"report", required_argument, nullptr, 'E'},
+           {"recall_k", required_argument, nullptr, 'K'},
+           {"format", required_argument, nullptr, 'F'},
+           {"radius", required_argument, nullptr, 'a'},
+           {"no_exact", no_argument, nullptr, 'n'},
+           {"batch", no_argument, nullptr, 'B'},
+           {"window", required_argument, nullptr, 'W'},
+           {"config", required_argument, nullptr, 'f'},
+           {"tune", required_argument, nullptr, 'T'},
+           {"recall", required_argument, nullptr, 'R'},
            {nullptr, no_argument, nullptr, 0}
    };
 
@@ -94,7 +107,7 @@ int utils::args::ReadArguments(int argc, char **argv,
         break;
       }
       case 'q' : {
-        input_info.query_file = optarg;
+        input_info.query_files.push_back(optarg);
         break;
       }
       case 'k': {
@@ -116,7 +129,56 @@ int utils::args::ReadArguments(int argc, char **argv,
         break;
       }
       case 'o': {
-        input_info.output_file = optarg;
+        input_info.output_files.push_back(optarg);
+        break;
+      }
+      case 'r': {
+        input_info.r_samples = atoi(optarg);
+        break;
+      }
+      case 'E': {
+        input_info.report_file = optarg;
+        break;
+      }
+      case 'K': {
+        input_info.recall_k = std::max(atoi(optarg), 1);
+        break;
+      }
+      case 'F': {
+        utils::results::Format format;
+        if (!utils::results::ParseFormat(optarg, format)) {
+          status = INVALID_FORMAT;
+          return FAIL;
+        }
+        input_info.format = optarg;
+        break;
+      }
+      case 'a': {
+        input_info.radius = atof(optarg);
+        break;
+      }
+      case 'n': {
+        input_info.no_exact = true;
+        break;
+      }
+      case 'B': {
+        input_info.batch = true;
+        break;
+      }
+      case 'W': {
+        input_info.w = atof(optarg);
+        break;
+      }
+      case 'f': {
+        input_info.config_file = optarg;
+        break;
+      }
+      case 'T': {
+        input_info.tune_file = optarg;
+        break;
+      }
+      case 'R': {
+        input_info.recall = atof(optarg);
         break;
       }
       case '?':
@@ -125,5 +187,14 @@ int utils::args::ReadArguments(int argc, char **argv,
         abort();
     }
   }
+  /* the first query file is searched first, the rest by main */
+  if (input_info.query_files.size() != input_info.output_files.size()) {
+    status = MISSING_OUTPUT;
+    return FAIL;
+  }
+  if (!input_info.query_files.empty()) {
+    input_info.query_file = input_info.query_files[0];
+    input_info.output_file = input_info.output_files[0];
+  }
   return SUCCESS;
 }
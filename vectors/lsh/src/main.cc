@@ -3,6 +3,8 @@
 #include <cmath>
 #include <iostream>
 #include <iterator>
+#include <limits>
+#include <memory>
 #include <random>
 #include <string>
 #include <tuple>
@@ -11,8 +13,14 @@
 
 #include "../../../core/hash/hash_function.h"
 #include "../../../core/metric/metric.h"
+#include "../../../core/metric/report.h"
 #include "../../../core/search/brute_force.h"
 #include "../../../core/search/lsh.h"
+#include "../../../core/search/tuner.h"
+#include "../../../core/utils/config.h"
+#include "../../../core/utils/counters.h"
+#include "../../../core/utils/estimate.h"
+#include "../../../core/utils/timing.h"
 #include "../../../core/utils/utils.h"
 
 #include "../includes/args_utils.h"
@@ -29,7 +37,7 @@ int main(int argc, char **argv) {
   utils::InputInfo input_info;
   utils::ExitCode status;
   std::string input_buffer;
-  double radius = 0.0;
+  double radius;
   int exit_code;
 
   /* Get arguments */
@@ -111,6 +119,35 @@ int main(int argc, char **argv) {
   std::cout << "Time elapsed: " << total_time.count() << " seconds"
             << std::endl;
 
+  /* Load tuned parameters, they override the ones of the arguments */
+  if (!input_info.config_file.empty()) {
+    try {
+      utils::Config config(input_info.config_file);
+      input_info.K = config.Get<unsigned int>("K", input_info.K, 1,
+        std::numeric_limits<uint8_t>::max());
+      input_info.L = config.Get<unsigned int>("L", input_info.L, 1,
+        std::numeric_limits<uint8_t>::max());
+      input_info.w = config.Get<double>("w", input_info.w,
+        std::numeric_limits<double>::min(), std::numeric_limits<double>::max());
+    } catch (const std::exception& e) {
+      std::cout << "\n" << e.what() << std::endl;
+      utils::report::ReportError(utils::INVALID_CONFIG);
+    }
+  }
+  /* Create BruteForce class object, it is shared by every query file */
+  start = high_resolution_clock::now();
+  std::cout << "\nBuilding Brute Force.." << std::endl;
+  search::vectors::BruteForce<T,U> bf{input_info.N, input_info.D,
+                                      dataset_points, dataset_ids};
+  stop = high_resolution_clock::now();
+  total_time = duration_cast<duration<double>>(stop - start);
+  std::cout << "Building Brute Force completed successfully." << std::endl;
+  std::cout << "Time elapsed: " << total_time.count() << " seconds"
+            << std::endl;
+
+  /* LSH is built for the first query file and searched by the rest */
+  std::unique_ptr<search::vectors::LSH<T,U>> lsh;
+  size_t next_query = 1;
   do {
     /* Preprocessing query file */
     start = high_resolution_clock::now();
@@ -148,133 +185,214 @@ int main(int argc, char **argv) {
     /* Print input info */
     input_info.Print();
 
-    /* Create BruteForce class object and a vector to store exact-NN results */
-    start = high_resolution_clock::now();
-    std::cout << "\nBuilding Brute Force.." << std::endl;
-    std::vector<std::tuple<T,U,double>> bf_nn_results(input_info.Q);
-    search::vectors::BruteForce<T,U> bf{input_info.N, input_info.D,
-                                        dataset_points, dataset_ids};
-    stop = high_resolution_clock::now();
-    total_time = duration_cast<duration<double>>(stop - start);
-    std::cout << "Building Brute Force completed successfully." << std::endl;
-    std::cout << "Time elapsed: " << total_time.count() << " seconds"
-              << std::endl;
-
-    /* Executing Exact Nearest Neighbor using BruteForce */
-    start = high_resolution_clock::now();
-    std::cout << "\nExecuting Nearest Neighbor using Brute Force.." << std::endl;
-    for (size_t i = 0; i < input_info.Q; ++i) {
-      bf_nn_results[i] = bf.NearestNeighbor(query_points, i);
+    /* Executing Exact Nearest Neighbor using BruteForce, unless skipped */
+    std::vector<std::tuple<T,U,double>> bf_nn_results(input_info.Q,
+      std::make_tuple(std::numeric_limits<T>::max(), U{},
+                      utils::timing::kNotTimed));
+    if (!input_info.no_exact) {
+      start = high_resolution_clock::now();
+      std::cout << "\nExecuting Nearest Neighbor using Brute Force.." << std::endl;
+      for (size_t i = 0; i < input_info.Q; ++i) {
+        bf_nn_results[i] = bf.NearestNeighbor(query_points, i);
+      }
+      stop = high_resolution_clock::now();
+      total_time = duration_cast<duration<double>>(stop - start);
+      std::cout << "Executing Nearest Neighbor using Brute Force completed successfully."
+                << std::endl;
+      std::cout << "Time elapsed: " << total_time.count() << " seconds"
+                << std::endl;
     }
-    stop = high_resolution_clock::now();
-    total_time = duration_cast<duration<double>>(stop - start);
-    std::cout << "Executing Nearest Neighbor using Brute Force completed successfully."
-              << std::endl;
-    std::cout << "Time elapsed: " << total_time.count() << " seconds"
-              << std::endl;
 
-    /* Computing window */
-    start = high_resolution_clock::now();
-    std::cout << "\nComputing window parameter.." << std::endl;
-    double r = utils::ComputeParameterR(bf_nn_results);
-    stop = high_resolution_clock::now();
-    total_time = duration_cast<duration<double>>(stop - start);
-    std::cout << "Computing window parameter completed successfully." << std::endl;
-    std::cout << "Time elapsed: " << total_time.count() << " seconds"
-              << std::endl;
+    if (!lsh) {
+      /* Computing window */
+      start = high_resolution_clock::now();
+      std::cout << "\nComputing window parameter.." << std::endl;
+      double r;
+      if (input_info.r_samples > 0 || input_info.no_exact) {
+        uint32_t samples;
+        std::tie(r, samples) = utils::EstimateParameterR(
+          utils::RaggedView<T>(dataset_points, input_info.D), input_info.N,
+          input_info.r_samples > 0 ? input_info.r_samples : utils::kRSamples);
+        std::cout << "Estimated R from " << samples << " sampled points"
+                  << std::endl;
+      } else {
+        r = utils::ComputeParameterR(bf_nn_results);
+      }
+      stop = high_resolution_clock::now();
+      total_time = duration_cast<duration<double>>(stop - start);
+      std::cout << "Computing window parameter completed successfully." << std::endl;
+      std::cout << "Time elapsed: " << total_time.count() << " seconds"
+                << std::endl;
 
-    /* Creating LSH class object and a vector to store approx-NN results */
-    start = high_resolution_clock::now();
-    std::cout << "\nBuilding LSH.." << std::endl;
+      /* Tuning parameters on a sample of the dataset for the recall target */
+      if (!input_info.tune_file.empty()) {
+        start = high_resolution_clock::now();
+        std::cout << "\nTuning LSH parameters.." << std::endl;
+        search::tuner::Configuration chosen;
+        try {
+          chosen = search::tuner::Tune<T,U>(
+            search::tuner::Grid({2, 3, 4, 6, 8}, {1, 2, 4, 6, 8}, {1, 2, 4, 8},
+                                {0}, {0}),
+            dataset_points, dataset_ids, input_info.D, input_info.N,
+            input_info.recall, false, input_info.tune_file,
+            [&](const search::tuner::Configuration& c, const uint32_t S,
+                const double sample_r, const std::vector<T>& sample_points,
+                const std::vector<U>& sample_ids) {
+            return std::unique_ptr<search::vectors::LSH<T,U>>(
+              new search::vectors::LSH<T,U>((uint8_t) c.K, c.L, input_info.D,
+                                            S, sample_r, sample_points,
+                                            sample_ids, c.w));
+          });
+        } catch (const std::exception& e) {
+          std::cout << "\n" << e.what() << std::endl;
+          utils::report::ReportError(utils::INVALID_CONFIG);
+        }
+        input_info.K = chosen.K;
+        input_info.L = chosen.L;
+        input_info.w = chosen.w;
+        stop = high_resolution_clock::now();
+        total_time = duration_cast<duration<double>>(stop - start);
+        std::cout << "Tuning LSH parameters completed successfully."
+                  << std::endl;
+        std::cout << "Time elapsed: " << total_time.count() << " seconds"
+                  << std::endl;
+      }
+
+      /* Creating LSH class object */
+      start = high_resolution_clock::now();
+      std::cout << "\nBuilding LSH.." << std::endl;
+      lsh.reset(new search::vectors::LSH<T,U>(input_info.K, input_info.L,
+        input_info.D, input_info.N, r, dataset_points, dataset_ids,
+        input_info.w));
+      stop = high_resolution_clock::now();
+      total_time = duration_cast<duration<double>>(stop - start);
+      std::cout << "Building LSH completed successfully." << std::endl;
+      std::cout << "Time elapsed: " << total_time.count() << " seconds"
+                << std::endl;
+    }
+
+    /* Vector to store approx-NN results */
     std::vector<std::tuple<T,U,double>> lsh_nn_results(input_info.Q);
-    search::vectors::LSH<T,U> lsh{input_info.K, input_info.L, input_info.D,
-                         input_info.N, r, dataset_points, dataset_ids};
-    stop = high_resolution_clock::now();
-    total_time = duration_cast<duration<double>>(stop - start);
-    std::cout << "Building LSH completed successfully." << std::endl;
-    std::cout << "Time elapsed: " << total_time.count() << " seconds"
-              << std::endl;
 
+    /* Counting the work of the queries, if built with COUNTERS=1 */
+    utils::SearchCounters::Reset();
     /* Executing approximate Nearest Neighbor using LSH */
     start = high_resolution_clock::now();
     std::cout << "\nExecuting Nearest Neighbor using LSH.." << std::endl;
     for (size_t i = 0; i < input_info.Q; ++i) {
-      lsh_nn_results[i] = lsh.NearestNeighbor(query_points, i);
+      lsh_nn_results[i] = lsh->NearestNeighbor(query_points, i);
     }
     stop = high_resolution_clock::now();
     total_time = duration_cast<duration<double>>(stop - start);
+    const double search_seconds = total_time.count();
     std::cout << "Executing Nearest Neighbor using LSH completed successfully."
               << std::endl;
     std::cout << "Time elapsed: " << total_time.count() << " seconds"
               << std::endl;
 
-    /* Read radius if user select to run range search */
-    do {
+    /* Read radius if user select to run range search, unless it is given */
+    radius = input_info.radius;
+    input_buffer = radius > 0 ? "y" : "n";
+    while (!input_info.batch && radius == 0) {
       std::cout << "\nDo you want to run range search (y/n)? : ";
       std::cin >> input_buffer;
-      if (input_buffer != "y" && input_buffer != "n") {
-        std::cout << "Wrong input! Try again." << std::endl;
+      if (input_buffer == "y" || input_buffer == "n") {
+        break;
       }
-    } while (input_buffer != "y" && input_buffer != "n");
+      std::cout << "Wrong input! Try again." << std::endl;
+    }
     /* Define vectors to store radius NN results */
-    std::vector<std::vector<std::pair<T,U>>> bf_radius_nn_results(input_info.Q);
     std::vector<std::vector<std::pair<T,U>>> lsh_radius_nn_results(input_info.Q);
     /* Check input */
     if (input_buffer != "n") {
-      std::cout << "Provide the radius: ";
-      std::cin >> input_buffer;
-      try {
-        radius = stoi(input_buffer);
-      } catch (...) {
-        return EXIT_FAILURE;
+      if (radius == 0) {
+        std::cout << "Provide the radius: ";
+        std::cin >> input_buffer;
+        try {
+          radius = stoi(input_buffer);
+        } catch (...) {
+          return EXIT_FAILURE;
+        }
       }
-      /* Executing Radius Nearest Neighbor using BruteForce*/
+      /* Executing Radius Nearest Neighbor using LSH*/
       start = high_resolution_clock::now();
-      std::cout << "\nExecuting Radius Nearest Neighbor using Brute Force.."
-                << std::endl;
+      std::cout << "\nExecuting Radius Nearest Neighbor using LSH.." << std::endl;
       for (size_t i = 0; i < input_info.Q; ++i) {
-        bf_radius_nn_results[i] = bf.RadiusNearestNeighbor(query_points, i, radius);
+        lsh_radius_nn_results[i] = lsh->RadiusNearestNeighbor(query_points, i, radius);
       }
       stop = high_resolution_clock::now();
       total_time = duration_cast<duration<double>>(stop - start);
-      std::cout << "Executing Radius Nearest Neighbor using Brute Force completed successfully."
+      std::cout << "Executing Radius Nearest Neighbor using LSH completed successfully."
                 << std::endl;
-      std::cout << "Time elapsed: " << total_time.count() << " seconds" << std::endl;
+      std::cout << "Time elapsed: " << total_time.count() << " seconds"
+                << std::endl;
+    }
 
-      /* Executing Radius Nearest Neighbor using LSH*/
+    /* Without exact NN there is nothing to compare the results against */
+    if (input_info.no_exact) {
+      std::cout << "\nExact Nearest Neighbor skipped, no Af is computed"
+                << std::endl;
+      std::cout << "Not found: " << std::count_if(lsh_nn_results.begin(),
+        lsh_nn_results.end(), [](const std::tuple<T,U,double>& result) {
+          return std::get<0>(result) == std::numeric_limits<T>::max();
+        }) << std::endl;
+      utils::counters::Print<utils::SearchCounters>();
+    } else {
+      /* Compute Max and Average ratio lsh_nn_results / bf_nn_results */
       start = high_resolution_clock::now();
-      std::cout << "\nExecuting Radius Nearest Neighbor using LSH.." << std::endl;
-      for (size_t i = 0; i < input_info.Q; ++i) {
-        lsh_radius_nn_results[i] = lsh.RadiusNearestNeighbor(query_points, i, radius);
-      }
+      std::cout << "\nCalculating evaluation metric.." << std::endl;
+      std::tuple<double,double,int> metric_res{};
+      metric_res = metric::EvaluationMetric(bf_nn_results, lsh_nn_results);
       stop = high_resolution_clock::now();
       total_time = duration_cast<duration<double>>(stop - start);
-      std::cout << "Executing Radius Nearest Neighbor using LSH completed successfully."
+      std::cout << "Calculating evaluation metric completed successfully."
                 << std::endl;
       std::cout << "Time elapsed: " << total_time.count() << " seconds"
                 << std::endl;
-    }
+      std::cout << "\nMax Af: " << std::get<0>(metric_res) << std::endl;
+      std::cout << "Average Af: " << std::get<1>(metric_res) << std::endl;
+      std::cout << "Not found: " << std::get<2>(metric_res) << std::endl;
+      utils::counters::Print<utils::SearchCounters>();
 
-    /* Compute Max and Average ratio lsh_nn_results / bf_nn_results */
-    start = high_resolution_clock::now();
-    std::cout << "\nCalculating evaluation metric.." << std::endl;
-    std::tuple<double,double,int> metric_res{};
-    metric_res = metric::EvaluationMetric(bf_nn_results, lsh_nn_results);
-    stop = high_resolution_clock::now();
-    total_time = duration_cast<duration<double>>(stop - start);
-    std::cout << "Calculating evaluation metric completed successfully."
-              << std::endl;
-    std::cout << "Time elapsed: " << total_time.count() << " seconds"
-              << std::endl;
-    std::cout << "\nMax Af: " << std::get<0>(metric_res) << std::endl;
-    std::cout << "Average Af: " << std::get<1>(metric_res) << std::endl;
-    std::cout << "Not found: " << std::get<2>(metric_res) << std::endl;
+      /* Writing recall, Af and latency percentiles to the report file */
+      if (!input_info.report_file.empty()) {
+        start = high_resolution_clock::now();
+        std::cout << "\nWriting evaluation report.." << std::endl;
+        std::vector<T> kth_nn_distances;
+        if (input_info.recall_k > 1) {
+          for (size_t i = 0; i < input_info.Q; ++i) {
+            kth_nn_distances.push_back(bf.KthNearestDistance(query_points, i,
+                                                              input_info.recall_k));
+          }
+        }
+        const metric::Report report = metric::Evaluate(bf_nn_results,
+                                       lsh_nn_results, kth_nn_distances,
+                                       input_info.recall_k, search_seconds);
+        try {
+          metric::WriteReport(input_info.report_file, report);
+        } catch (const std::exception& e) {
+          utils::report::ReportError(utils::INVALID_OUTPUT);
+        }
+        stop = high_resolution_clock::now();
+        total_time = duration_cast<duration<double>>(stop - start);
+        std::cout << "Writing evaluation report completed successfully."
+                  << std::endl;
+        std::cout << "Time elapsed: " << total_time.count() << " seconds"
+                  << std::endl;
+        std::cout << "\nRecall@1: " << report.recall_at_1 << std::endl;
+        std::cout << "Recall@" << report.k << ": " << report.recall_at_k << std::endl;
+        std::cout << "Latency p50: " << report.latency.Percentile(0.5)
+                  << " seconds, p99: " << report.latency.Percentile(0.99)
+                  << " seconds" << std::endl;
+        std::cout << "QPS: " << report.qps << std::endl;
+      }
+    }
 
     /* Writing results to the output file */
     start = high_resolution_clock::now();
     std::cout << "\nWriting results to the output file.." << std::endl;
     exit_code = utils::io::WriteFile<T,U>(input_info.output_file, bf_nn_results,
-      lsh_nn_results, radius, bf_radius_nn_results, status);
+      lsh_nn_results, radius, lsh_radius_nn_results, input_info.format, status);
     if (exit_code != utils::SUCCESS) {
       utils::report::ReportError(status);
     }
@@ -285,7 +403,17 @@ int main(int argc, char **argv) {
     std::cout << "Time elapsed: " << total_time.count() << " seconds"
               << std::endl;
 
-    /* Ask user if he want to repeat with a different query file */
+    /* Continue with the next query file of the arguments, or ask user if he
+       want to repeat with a different query file */
+    if (next_query < input_info.query_files.size()) {
+      input_info.query_file = input_info.query_files[next_query];
+      input_info.output_file = input_info.output_files[next_query++];
+      input_buffer = "y";
+      continue;
+    }
+    if (input_info.batch) {
+      break;
+    }
     do {
       std::cout << "\nDo you want to provide a different query file (y/n)? : ";
       std::cin >> input_buffer;
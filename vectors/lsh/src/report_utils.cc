@@ -34,6 +34,17 @@ void utils::report::ReportError(const utils::ExitCode &code) {
     case MEMORY_ERROR:
       std::cout << "\n[ERROR]: " << "System ran out of memory" << std::endl;
       break;
+    case INVALID_CONFIG:
+      std::cout << "\n[ERROR]: " << "Invalid config file" << std::endl;
+      break;
+    case INVALID_FORMAT:
+      std::cout << "\n[ERROR]: " << "Invalid output format, expected text,"
+                << " csv, jsonl or binary" << std::endl;
+      break;
+    case MISSING_OUTPUT:
+      std::cout << "\n[ERROR]: " << "Every query file needs an output file"
+                << std::endl;
+      break;
     default:
       abort();
   }
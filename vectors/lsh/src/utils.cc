@@ -1,4 +1,5 @@
 #include <iostream>
+#include <string>
 
 #include "../includes/utils.h"
 
@@ -6,16 +7,41 @@ void utils::ShowUsage(const std::string &program_name,
   const struct InputInfo &input_info) {
   std::cerr << "usage: " << program_name << " [--help] [-d INPUT FILE]"
             << " [-q QUERY FILE] [-k INT] [-L INT] [-o OUTPUT FILE]"
+            << " [--r_samples INT] [--report FILE] [--recall_k INT] [--format FORMAT] [--radius FLOAT] [--no_exact] [--batch] [--window FLOAT] [--config FILE]"
+            << " [--tune FILE] [--recall FLOAT]"
             << "\n\n"
             << "optional arguments:\n"
             << "  -help\tshow this help message and exit\n"
             << "  -d\tdefine the input file\n"
-            << "  -q\tdefine the query file\n"
+            << "  -q\tdefine a query file, repeat -q and -o to search several"
+            << " query files with the same index\n"
             << "  -k\tdefine the number of LSH hash functions (default = "
                   << input_info.K << ")\n"
             << "  -L\tdefine the number of LSH hash tables (default = "
                   << input_info.L << ")\n"
             << "  -o\tdefine the output file\n"
+            << "  --r_samples\tdefine the number of dataset points sampled to estimate R,"
+            << " 0 to average the exact NN distances of the queries (default = "
+                  << input_info.r_samples << ")\n"
+            << "  --report\twrite recall, Af and latency percentiles and QPS to a"
+            << " JSON file, or a CSV file if FILE ends in .csv\n"
+            << "  --recall_k\tdefine k of the recall at k of the report (default = "
+                  << input_info.recall_k << ")\n"
+            << "  --format\tdefine the output file format: text, or csv, jsonl and"
+            << " binary written by a buffered writer (default = "
+                  << input_info.format << ")\n"
+            << "  --radius\tdefine the radius of range search instead of asking"
+            << " for it\n"
+            << "  --no_exact\tskip exact Nearest Neighbor, no Af, recall or"
+            << " report is computed\n"
+            << "  --batch\tnever read stdin, exit after the last query file\n"
+            << "  --window\tdefine the window size as a multiple of R (default = "
+                  << input_info.w << ")\n"
+            << "  --config\tload parameters from a config file written by --tune\n"
+            << "  --tune\ttune parameters for the recall target on a sample of the"
+            << " dataset and save them to a config file\n"
+            << "  --recall\tdefine the recall target of tuning (default = "
+                  << input_info.recall << ")\n"
             << std::endl;
   exit(EXIT_FAILURE);
 }
@@ -35,4 +61,17 @@ void utils::InputInfo::Print(void) {
             << static_cast<unsigned int>(Q) << std::endl;
   std::cout << "Space dimension: "
             << static_cast<unsigned int>(D) << std::endl;
+  std::cout << "Points sampled to estimate R: " << r_samples << std::endl;
+  std::cout << "Report file: "
+            << (report_file.empty() ? "none" : report_file) << std::endl;
+  std::cout << "Recall at k: " << recall_k << std::endl;
+  std::cout << "Output format: " << format << std::endl;
+  std::cout << "Exact NN: " << (no_exact ? "no" : "yes") << std::endl;
+  std::cout << "Batch: " << (batch ? "yes" : "no") << std::endl;
+  std::cout << "Window size: " << w << " * R" << std::endl;
+  std::cout << "Config file: "
+            << (config_file.empty() ? "none" : config_file) << std::endl;
+  std::cout << "Tuning: "
+            << (tune_file.empty() ? "no" : "for recall " + std::to_string(recall))
+            << std::endl;
 }